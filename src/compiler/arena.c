@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <assert.h>
+
+#include "arena.h"
+
+/*
+ * A one-off compile never frees most of what it allocates, and the process
+ * exit takes it all back. A compile server runs compile after compile in the
+ * same process, so there the parse tree, the IR and the symbols of a compile
+ * are allocated from an arena instead, which is emptied once the compile is
+ * done.
+ *
+ * arena_use selects the arena that arena_allocate takes memory from. With no
+ * arena in use it is malloc, and arena_free is free. With one, arena_free
+ * does nothing, since the memory comes back when the arena is reset. An
+ * object must be freed with the same arena in use as when it was allocated,
+ * and only one thread may allocate while an arena is in use.
+ *
+ * Resetting keeps the chunks, up to ARENA_MAX_KEPT bytes of them, so that
+ * the next compile finds its memory already mapped.
+ */
+
+struct arena_chunk {
+  struct arena_chunk *next;
+  size_t size;
+  max_align_t data[];
+};
+
+#define ARENA_ALIGNMENT (sizeof(max_align_t))
+
+static struct arena *arena_current;
+
+void arena_initialize(struct arena *arena) {
+  arena->first = arena->current = NULL;
+  arena->next = arena->end = NULL;
+  arena->used = arena->peak = 0;
+}
+
+/*
+ * arena_reset - make all of the memory of the arena free again
+ */
+void arena_reset(struct arena *arena) {
+  struct arena_chunk *chunk, *next, **link = &arena->first;
+  size_t kept = 0;
+
+  for (chunk = arena->first; NULL != chunk; chunk = next) {
+    next = chunk->next;
+    if (kept + chunk->size <= ARENA_MAX_KEPT) {
+      kept += chunk->size;
+      *link = chunk;
+      link = &chunk->next;
+    } else {
+      free(chunk);
+    }
+  }
+  *link = NULL;
+
+  arena->current = arena->first;
+  if (NULL != arena->first) {
+    arena->next = (char *)arena->first->data;
+    arena->end = arena->next + arena->first->size;
+  } else {
+    arena->next = arena->end = NULL;
+  }
+  arena->used = 0;
+}
+
+void arena_destroy(struct arena *arena) {
+  struct arena_chunk *chunk, *next;
+
+  assert(arena_current != arena);
+  for (chunk = arena->first; NULL != chunk; chunk = next) {
+    next = chunk->next;
+    free(chunk);
+  }
+  arena_initialize(arena);
+}
+
+/*
+ * arena_use - allocate from arena from now on, or with malloc when it is NULL
+ */
+void arena_use(struct arena *arena) {
+  arena_current = arena;
+}
+
+/* Move on to a chunk with room for size bytes, reusing a kept one when it is big enough. */
+static void arena_grow(struct arena *arena, size_t size) {
+  struct arena_chunk *chunk = NULL != arena->current ? arena->current->next : arena->first;
+
+  if (NULL == chunk || chunk->size < size) {
+    chunk = malloc(sizeof(struct arena_chunk) + (size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE));
+    assert(NULL != chunk);
+    chunk->size = size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+    if (NULL != arena->current) {
+      chunk->next = arena->current->next;
+      arena->current->next = chunk;
+    } else {
+      chunk->next = arena->first;
+      arena->first = chunk;
+    }
+  }
+  arena->current = chunk;
+  arena->next = (char *)chunk->data;
+  arena->end = arena->next + chunk->size;
+}
+
+void *arena_allocate(size_t size) {
+  struct arena *arena = arena_current;
+  void *pointer;
+
+  if (NULL == arena) {
+    pointer = malloc(size);
+    assert(NULL != pointer);
+    return pointer;
+  }
+
+  size = (size + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+  if ((size_t)(arena->end - arena->next) < size) {
+    arena_grow(arena, size);
+  }
+  pointer = arena->next;
+  arena->next += size;
+  arena->used += size;
+  if (arena->used > arena->peak) {
+    arena->peak = arena->used;
+  }
+  return pointer;
+}
+
+void arena_free(void *pointer) {
+  if (NULL == arena_current) {
+    free(pointer);
+  }
+}
+
+void arena_print_statistics(FILE *output, struct arena *arena) {
+  struct arena_chunk *chunk;
+  size_t size = 0;
+
+  for (chunk = arena->first; NULL != chunk; chunk = chunk->next) {
+    size += chunk->size;
+  }
+  fprintf(output, "arena: %lu bytes used, peak %lu, %lu bytes in chunks\n",
+          (unsigned long)arena->used, (unsigned long)arena->peak, (unsigned long)size);
+}
@@ -0,0 +1,36 @@
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#define ARENA_CHUNK_SIZE (1ul << 20)
+#define ARENA_MAX_KEPT (64ul << 20)
+
+struct arena_chunk;
+
+/*
+ * A region that parse trees, IR and symbols are carved out of while it is
+ * in use, and that is emptied all at once between compiles. Its chunks are
+ * kept for the next compile.
+ */
+struct arena {
+  struct arena_chunk *first;
+  struct arena_chunk *current;
+  char *next;
+  char *end;
+  size_t used;
+  size_t peak;
+};
+
+void arena_initialize(struct arena *arena);
+void arena_reset(struct arena *arena);
+void arena_destroy(struct arena *arena);
+
+void arena_use(struct arena *arena);
+void *arena_allocate(size_t size);
+void arena_free(void *pointer);
+
+void arena_print_statistics(FILE *output, struct arena *arena);
+
+#endif /* _ARENA_H */
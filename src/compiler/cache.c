@@ -0,0 +1,574 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+#include "cache.h"
+
+/*
+ * The compile cache is a directory of entries named by the hex form of a
+ * 64-bit key. The key is a hash over the identity of the compiler binary,
+ * every flag that changes the output, and the input bytes. Each entry holds
+ * those bytes themselves, which a hit must match, then the text written to
+ * stdout by the stages that ran (the stage dumps and any diagnostics), the
+ * exit status, and the contents of the output file when one was produced.
+ *
+ * The compiler is identified by a hash of its own executable file, so any
+ * rebuild that could change the output starts a fresh set of entries. A
+ * compiler that cannot read its executable does not use the cache.
+ *
+ * Entries are written to a temporary file and renamed into place, so readers
+ * never see a partial entry. Readers bump an entry's modification time on a
+ * hit, and eviction removes the least recently modified entries once the
+ * directory grows past its size limit. Hit and miss counters live in a small
+ * text file updated under an flock.
+ */
+
+#define CACHE_MAGIC "E95CACHE"
+#define CACHE_KEY_LENGTH 16
+#define CACHE_STALE_SECONDS 3600
+
+struct cache_entry_header {
+  char magic[8];
+  unsigned long long key;
+  unsigned long long identity_length;
+  unsigned long long flags_length;
+  unsigned long long input_length;
+  unsigned long long dump_length;
+  unsigned long long output_length;
+  int status;
+  int has_output;
+};
+
+struct cache_file {
+  char name[CACHE_KEY_LENGTH + 1];
+  off_t size;
+  struct timespec mtime;
+};
+
+/**********************
+ * KEYS AND FILENAMES *
+ **********************/
+
+struct cache_identity {
+  unsigned char bytes[sizeof(unsigned long long)];
+  size_t length;
+};
+
+/* 64-bit FNV-1a, continued from a previous hash value. */
+static unsigned long long cache_hash(unsigned long long hash, char const *bytes, size_t length) {
+  size_t i;
+  for (i = 0; i < length; i++) {
+    hash ^= (unsigned char)bytes[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+/*
+ * cache_identify_compiler - hash this compiler's executable file
+ *
+ * The file is hashed a word at a time, as FNV-1a does a byte at a time, and
+ * with the file's length, so that hashing it costs little next to a compile.
+ * It is done once per process. Returns NULL when the file cannot be read.
+ */
+static struct cache_identity const *cache_identify_compiler(void) {
+  static struct cache_identity identity;
+  static bool identified = false;
+  unsigned long long hash = 0xcbf29ce484222325ull, word, length = 0;
+  char buffer[65536];
+  ssize_t count, i;
+  int fd;
+
+  if (identified) {
+    return 0 == identity.length ? NULL : &identity;
+  }
+  identified = true;
+
+  fd = open("/proc/self/exe", O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+  while (0 < (count = read(fd, buffer, sizeof(buffer)))) {
+    for (i = 0; i + (ssize_t)sizeof(word) <= count; i += sizeof(word)) {
+      memcpy(&word, buffer + i, sizeof(word));
+      hash = (hash ^ word) * 0x100000001b3ull;
+    }
+    hash = cache_hash(hash, buffer + i, count - i);
+    length += count;
+  }
+  close(fd);
+  if (0 != count) {
+    return NULL;
+  }
+
+  hash = cache_hash(hash, (char const *)&length, sizeof(length));
+  memcpy(identity.bytes, &hash, sizeof(hash));
+  identity.length = sizeof(hash);
+  return &identity;
+}
+
+/*
+ * cache_key - hash the bytes that determine a compile's output
+ *
+ * Returns 0, which no entry is named by, when the compiler cannot identify
+ * itself.
+ */
+unsigned long long cache_key(char const *flags, char const *input, size_t length) {
+  struct cache_identity const *identity = cache_identify_compiler();
+  unsigned long long hash = 0xcbf29ce484222325ull;
+
+  if (NULL == identity) {
+    return 0;
+  }
+
+  /* Include the terminating NULs so that the fields cannot run together. */
+  hash = cache_hash(hash, (char const *)identity->bytes, identity->length);
+  hash = cache_hash(hash, flags, strlen(flags) + 1);
+  hash = cache_hash(hash, input, length);
+  return 0 == hash ? 1 : hash;
+}
+
+static void cache_path(char *path, size_t size, struct cache *cache, char const *name) {
+  snprintf(path, size, "%s/%s", cache->directory, name);
+}
+
+static bool cache_is_entry_name(char const *name) {
+  int i;
+  for (i = 0; i < CACHE_KEY_LENGTH; i++) {
+    if (!((name[i] >= '0' && name[i] <= '9') || (name[i] >= 'a' && name[i] <= 'f'))) {
+      return false;
+    }
+  }
+  return '\0' == name[CACHE_KEY_LENGTH];
+}
+
+/****************
+ * FILE HELPERS *
+ ****************/
+
+static bool cache_write_all(int fd, char const *bytes, size_t length) {
+  while (length > 0) {
+    ssize_t written = write(fd, bytes, length);
+    if (written < 0) {
+      if (EINTR == errno) {
+        continue;
+      }
+      return false;
+    }
+    bytes += written;
+    length -= written;
+  }
+  return true;
+}
+
+static bool cache_read_all(int fd, char *bytes, size_t length) {
+  while (length > 0) {
+    ssize_t count = read(fd, bytes, length);
+    if (count < 0 && EINTR == errno) {
+      continue;
+    } else if (count <= 0) {
+      return false;
+    }
+    bytes += count;
+    length -= count;
+  }
+  return true;
+}
+
+/* Whether the next length bytes of fd are the same as bytes. */
+static bool cache_read_matches(int fd, char const *bytes, size_t length) {
+  char buffer[65536];
+  while (length > 0) {
+    size_t chunk = length < sizeof(buffer) ? length : sizeof(buffer);
+    if (!cache_read_all(fd, buffer, chunk) || 0 != memcmp(buffer, bytes, chunk)) {
+      return false;
+    }
+    bytes += chunk;
+    length -= chunk;
+  }
+  return true;
+}
+
+/* Copy length bytes from the current offset of fd to the stream output. */
+static bool cache_copy_to_stream(int fd, FILE *output, unsigned long long length) {
+  char buffer[65536];
+  while (length > 0) {
+    size_t chunk = length < sizeof(buffer) ? length : sizeof(buffer);
+    if (!cache_read_all(fd, buffer, chunk) || chunk != fwrite(buffer, 1, chunk, output)) {
+      return false;
+    }
+    length -= chunk;
+  }
+  return true;
+}
+
+/* Append the whole of the file named name to fd, returning the byte count. */
+static bool cache_append_file(int fd, char const *name, unsigned long long *length) {
+  char buffer[65536];
+  size_t count;
+  FILE *input = fopen(name, "r");
+  if (NULL == input) {
+    return false;
+  }
+  *length = 0;
+  while (0 < (count = fread(buffer, 1, sizeof(buffer), input))) {
+    if (!cache_write_all(fd, buffer, count)) {
+      fclose(input);
+      return false;
+    }
+    *length += count;
+  }
+  fclose(input);
+  return true;
+}
+
+/**************
+ * STATISTICS *
+ **************/
+
+static int cache_lock_statistics(struct cache *cache, unsigned long long *hits, unsigned long long *misses) {
+  char path[4096], text[64];
+  ssize_t count;
+  int fd;
+
+  cache_path(path, sizeof(path), cache, "stats");
+  fd = open(path, O_RDWR | O_CREAT, 0666);
+  if (fd < 0) {
+    return -1;
+  }
+  flock(fd, LOCK_EX);
+
+  *hits = *misses = 0;
+  count = pread(fd, text, sizeof(text) - 1, 0);
+  if (count > 0) {
+    text[count] = '\0';
+    sscanf(text, "hits %llu misses %llu", hits, misses);
+  }
+  return fd;
+}
+
+static void cache_count(struct cache *cache, bool hit) {
+  unsigned long long hits, misses;
+  char text[64];
+  int length;
+  int fd = cache_lock_statistics(cache, &hits, &misses);
+  if (fd < 0) {
+    return;
+  }
+
+  if (hit) {
+    hits++;
+  } else {
+    misses++;
+  }
+  length = snprintf(text, sizeof(text), "hits %llu misses %llu\n", hits, misses);
+  if (0 == ftruncate(fd, 0)) {
+    pwrite(fd, text, length, 0);
+  }
+  flock(fd, LOCK_UN);
+  close(fd);
+}
+
+/************
+ * EVICTION *
+ ************/
+
+static int cache_compare_age(void const *left, void const *right) {
+  struct cache_file const *l = left, *r = right;
+  if (l->mtime.tv_sec != r->mtime.tv_sec) {
+    return l->mtime.tv_sec < r->mtime.tv_sec ? -1 : 1;
+  }
+  if (l->mtime.tv_nsec != r->mtime.tv_nsec) {
+    return l->mtime.tv_nsec < r->mtime.tv_nsec ? -1 : 1;
+  }
+  return strcmp(l->name, r->name);
+}
+
+/*
+ * cache_list - collect the entries in the cache directory
+ *
+ * Stale temporary files left behind by crashed compiles are removed along
+ * the way. The caller frees the returned array.
+ */
+static struct cache_file *cache_list(struct cache *cache, int *count, unsigned long long *total) {
+  struct cache_file *files = NULL;
+  int capacity = 0;
+  struct dirent *dirent;
+  struct stat info;
+  char path[4096];
+  time_t now = time(NULL);
+  DIR *dir = opendir(cache->directory);
+
+  *count = 0;
+  *total = 0;
+  if (NULL == dir) {
+    return NULL;
+  }
+  while (NULL != (dirent = readdir(dir))) {
+    cache_path(path, sizeof(path), cache, dirent->d_name);
+    if (0 != stat(path, &info) || !S_ISREG(info.st_mode)) {
+      continue;
+    }
+    if (0 == strncmp(dirent->d_name, "tmp.", 4)) {
+      if (now - info.st_mtime > CACHE_STALE_SECONDS) {
+        unlink(path);
+      }
+      continue;
+    }
+    if (!cache_is_entry_name(dirent->d_name)) {
+      continue;
+    }
+    if (*count == capacity) {
+      capacity = capacity ? capacity * 2 : 64;
+      files = realloc(files, capacity * sizeof(struct cache_file));
+      assert(NULL != files);
+    }
+    strcpy(files[*count].name, dirent->d_name);
+    files[*count].size = info.st_size;
+    files[*count].mtime = info.st_mtim;
+    *total += info.st_size;
+    (*count)++;
+  }
+  closedir(dir);
+  return files;
+}
+
+/* Remove least recently used entries until the cache fits in max_size. */
+static void cache_evict(struct cache *cache) {
+  struct cache_file *files;
+  unsigned long long total;
+  char path[4096];
+  int i, count, fd;
+
+  cache_path(path, sizeof(path), cache, "lock");
+  fd = open(path, O_RDWR | O_CREAT, 0666);
+  if (fd < 0) {
+    return;
+  }
+  flock(fd, LOCK_EX);
+
+  files = cache_list(cache, &count, &total);
+  if (total > cache->max_size) {
+    qsort(files, count, sizeof(struct cache_file), cache_compare_age);
+    for (i = 0; i < count && total > cache->max_size; i++) {
+      cache_path(path, sizeof(path), cache, files[i].name);
+      if (0 == unlink(path)) {
+        total -= files[i].size;
+      }
+    }
+  }
+  free(files);
+
+  flock(fd, LOCK_UN);
+  close(fd);
+}
+
+/*****************
+ * CACHE LOOKUPS *
+ *****************/
+
+void cache_initialize(struct cache *cache, char const *directory, unsigned long max_size,
+                      char const *flags, char const *input, size_t length) {
+  cache->directory = strdup(directory);
+  assert(NULL != cache->directory);
+  cache->max_size = max_size;
+  cache->key = cache_key(flags, input, length);
+  cache->flags = flags;
+  cache->input = input;
+  cache->input_length = length;
+  cache->saved_stdout = -1;
+  cache->capture_fd = -1;
+
+  mkdir(directory, 0777);
+}
+
+/* The compiler, flags and input whose output an entry holds, which follow its header. */
+static bool cache_write_source(struct cache *cache, int fd) {
+  struct cache_identity const *identity = cache_identify_compiler();
+  return cache_write_all(fd, (char const *)identity->bytes, identity->length)
+      && cache_write_all(fd, cache->flags, strlen(cache->flags) + 1)
+      && cache_write_all(fd, cache->input, cache->input_length);
+}
+
+static bool cache_read_source_matches(struct cache *cache, int fd, struct cache_entry_header *header) {
+  struct cache_identity const *identity = cache_identify_compiler();
+  return header->identity_length == identity->length
+      && header->flags_length == strlen(cache->flags) + 1
+      && header->input_length == cache->input_length
+      && cache_read_matches(fd, (char const *)identity->bytes, identity->length)
+      && cache_read_matches(fd, cache->flags, header->flags_length)
+      && cache_read_matches(fd, cache->input, cache->input_length);
+}
+
+void cache_destroy(struct cache *cache) {
+  free(cache->directory);
+  cache->directory = NULL;
+}
+
+/*
+ * cache_lookup - replay a cached compile
+ *
+ * An entry is a hit only when the compiler, flags and input it was made from
+ * are the same as this compile's, not merely their hash. On a hit the cached
+ * stage dumps are written to stdout, the cached output file is written to
+ * output_name and the exit status of the original compile is stored in
+ * status.
+ */
+bool cache_lookup(struct cache *cache, char const *output_name, int *status) {
+  struct cache_entry_header header;
+  char path[4096], name[CACHE_KEY_LENGTH + 1];
+  FILE *output;
+  bool ok;
+  int fd;
+
+  if (0 == cache->key) {
+    return false;
+  }
+  snprintf(name, sizeof(name), "%016llx", cache->key);
+  cache_path(path, sizeof(path), cache, name);
+  fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    cache_count(cache, false);
+    return false;
+  }
+
+  if (!cache_read_all(fd, (char *)&header, sizeof(header))
+      || 0 != memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic))
+      || header.key != cache->key
+      || !cache_read_source_matches(cache, fd, &header)) {
+    close(fd);
+    cache_count(cache, false);
+    return false;
+  }
+
+  ok = cache_copy_to_stream(fd, stdout, header.dump_length);
+  if (ok && header.has_output) {
+    output = fopen(output_name, "w");
+    ok = NULL != output && cache_copy_to_stream(fd, output, header.output_length);
+    if (NULL != output) {
+      fclose(output);
+    }
+  }
+  if (!ok) {
+    fprintf(stdout, "Could not replay cache entry %s: %s\n", path, strerror(errno));
+  }
+
+  /* Mark the entry as recently used. */
+  futimens(fd, NULL);
+  close(fd);
+
+  cache_count(cache, true);
+  *status = ok ? header.status : 1;
+  return true;
+}
+
+/*
+ * cache_begin_capture - start recording stdout for a new cache entry
+ *
+ * stdout is redirected into a temporary file in the cache directory. Space
+ * for the entry header is reserved at the start of the file, and the bytes
+ * the key was made from follow it.
+ */
+bool cache_begin_capture(struct cache *cache) {
+  if (0 == cache->key) {
+    return false;
+  }
+  fflush(stdout);
+
+  cache_path(cache->capture_name, sizeof(cache->capture_name), cache, "tmp.XXXXXX");
+  cache->capture_fd = mkstemp(cache->capture_name);
+  if (cache->capture_fd < 0) {
+    return false;
+  }
+  fchmod(cache->capture_fd, 0644);
+  cache->saved_stdout = dup(STDOUT_FILENO);
+  if (cache->saved_stdout < 0
+      || sizeof(struct cache_entry_header) != lseek(cache->capture_fd, sizeof(struct cache_entry_header), SEEK_SET)
+      || !cache_write_source(cache, cache->capture_fd)
+      || dup2(cache->capture_fd, STDOUT_FILENO) < 0) {
+    if (cache->saved_stdout >= 0) {
+      close(cache->saved_stdout);
+    }
+    close(cache->capture_fd);
+    unlink(cache->capture_name);
+    cache->capture_fd = -1;
+    return false;
+  }
+  return true;
+}
+
+/*
+ * cache_end_capture - restore stdout and publish the new cache entry
+ *
+ * The captured text is echoed to the real stdout. When output_name is not
+ * NULL the output file it names is stored with the entry.
+ */
+void cache_end_capture(struct cache *cache, int status, char const *output_name) {
+  struct cache_identity const *identity = cache_identify_compiler();
+  struct cache_entry_header header;
+  char path[4096], name[CACHE_KEY_LENGTH + 1];
+  off_t end, start;
+  bool ok;
+
+  assert(cache->capture_fd >= 0);
+
+  fflush(stdout);
+  end = lseek(cache->capture_fd, 0, SEEK_END);
+  dup2(cache->saved_stdout, STDOUT_FILENO);
+  close(cache->saved_stdout);
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+  header.key = cache->key;
+  header.identity_length = identity->length;
+  header.flags_length = strlen(cache->flags) + 1;
+  header.input_length = cache->input_length;
+  start = sizeof(header) + header.identity_length + header.flags_length + header.input_length;
+  header.dump_length = end - start;
+  header.status = status;
+  header.has_output = NULL != output_name;
+
+  lseek(cache->capture_fd, start, SEEK_SET);
+  ok = cache_copy_to_stream(cache->capture_fd, stdout, header.dump_length);
+  fflush(stdout);
+
+  if (ok && header.has_output) {
+    lseek(cache->capture_fd, 0, SEEK_END);
+    ok = cache_append_file(cache->capture_fd, output_name, &header.output_length);
+  }
+  ok = ok && sizeof(header) == pwrite(cache->capture_fd, &header, sizeof(header), 0);
+  close(cache->capture_fd);
+  cache->capture_fd = -1;
+
+  snprintf(name, sizeof(name), "%016llx", cache->key);
+  cache_path(path, sizeof(path), cache, name);
+  if (!ok || 0 != rename(cache->capture_name, path)) {
+    unlink(cache->capture_name);
+    return;
+  }
+  cache_evict(cache);
+}
+
+void cache_print_statistics(FILE *output, struct cache *cache) {
+  struct cache_file *files;
+  unsigned long long hits, misses, total;
+  int count;
+  int fd = cache_lock_statistics(cache, &hits, &misses);
+  if (fd >= 0) {
+    flock(fd, LOCK_UN);
+    close(fd);
+  }
+
+  files = cache_list(cache, &count, &total);
+  free(files);
+  fprintf(output, "cache: %llu hits, %llu misses, %d entries, %llu of %lu bytes\n",
+          hits, misses, count, total, cache->max_size);
+}
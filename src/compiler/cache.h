@@ -0,0 +1,37 @@
+#ifndef _CACHE_H
+#define _CACHE_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define CACHE_DEFAULT_MAX_SIZE (64ul * 1024 * 1024)
+
+struct cache {
+  char *directory;
+  unsigned long max_size;
+  unsigned long long key;
+
+  /* What the key was made from, which a hit must match. */
+  char const *flags;
+  char const *input;
+  size_t input_length;
+
+  /* State used while capturing the output of a cache miss. */
+  int saved_stdout;
+  int capture_fd;
+  char capture_name[4096];
+};
+
+unsigned long long cache_key(char const *flags, char const *input, size_t length);
+
+void cache_initialize(struct cache *cache, char const *directory, unsigned long max_size,
+                      char const *flags, char const *input, size_t length);
+void cache_destroy(struct cache *cache);
+bool cache_lookup(struct cache *cache, char const *output_name, int *status);
+bool cache_begin_capture(struct cache *cache);
+void cache_end_capture(struct cache *cache, int status, char const *output_name);
+
+void cache_print_statistics(FILE *output, struct cache *cache);
+
+#endif /* _CACHE_H */
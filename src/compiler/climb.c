@@ -0,0 +1,361 @@
+/*
+ * climb.c
+ *
+ * A hand-written parser for the same language as parser.y, built instead of
+ * the bison parser with "make PARSER=climb". Statements are parsed by
+ * recursive descent and binary expressions by precedence climbing, so an
+ * operand costs one call whatever the number of precedence levels, where the
+ * bison rule cascade makes a unit reduction for every level.
+ *
+ * The parser builds the same trees, with the same locations, as parser.y and
+ * reports syntax errors at the same tokens. Errors are recovered from as the
+ * "error SEMICOLON" rule does, by discarding tokens up to the next semicolon.
+ *
+ * The parser also counts the symbols the bison parser would hold on its
+ * stack, so that input nested too deeply for that stack is rejected with the
+ * same "memory exhausted" error, at the same token, instead of running out
+ * of C stack. Each parsing function leaves the one symbol its rule reduces
+ * to on the count, as a shift and a reduction would.
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+typedef void* yyscan_t;
+#endif
+
+#include "compiler.h"
+#include "parser.tab.h"
+#ifdef SCANNER_SIMD
+#include "lexer.h"
+#else
+#include "scanner.yy.h"
+#endif
+#include "node.h"
+#include "parser.h"
+
+/* The number of states the bison parser's stack holds at most, as parser.tab.c defines it. */
+#ifndef YYMAXDEPTH
+#define YYMAXDEPTH 10000
+#endif
+
+struct climb_operator {
+  int token;
+  int precedence;
+  enum node_binary_operation operation;
+};
+
+static struct climb_operator const climb_operators[] = {
+  { VBAR,            1, BINOP_BITWISE_OR },
+  { CARET,           2, BINOP_BITWISE_XOR },
+  { AMPERSAND,       3, BINOP_BITWISE_AND },
+  { LESS_LESS,       4, BINOP_LEFT_SHIFT },
+  { GREATER_GREATER, 4, BINOP_RIGHT_SHIFT },
+  { PLUS,            5, BINOP_ADDITION },
+  { MINUS,           5, BINOP_SUBTRACTION },
+  { ASTERISK,        6, BINOP_MULTIPLICATION },
+  { SLASH,           6, BINOP_DIVISION },
+  { 0,               0, 0 }
+};
+
+static struct climb_operator const climb_assignments[] = {
+  { EQUAL,                 0, BINOP_ASSIGN },
+  { ASTERISK_EQUAL,        0, BINOP_ASSIGN_MULTIPLICATION },
+  { SLASH_EQUAL,           0, BINOP_ASSIGN_DIVISION },
+  { PLUS_EQUAL,            0, BINOP_ASSIGN_ADDITION },
+  { MINUS_EQUAL,           0, BINOP_ASSIGN_SUBTRACTION },
+  { LESS_LESS_EQUAL,       0, BINOP_ASSIGN_LEFT_SHIFT },
+  { GREATER_GREATER_EQUAL, 0, BINOP_ASSIGN_RIGHT_SHIFT },
+  { AMPERSAND_EQUAL,       0, BINOP_ASSIGN_BITWISE_AND },
+  { CARET_EQUAL,           0, BINOP_ASSIGN_BITWISE_XOR },
+  { VBAR_EQUAL,            0, BINOP_ASSIGN_BITWISE_OR },
+  { 0,                     0, 0 }
+};
+
+struct climb {
+  yyscan_t scanner;
+  int *error_count;
+  struct parser_stream *stream;
+
+  /* The lookahead token, its value and location. */
+  int token;
+  YYSTYPE value;
+  YYLTYPE location;
+
+  /* The location of the last token consumed. */
+  YYLTYPE last;
+  bool aborted;
+
+  /* The number of symbols on the bison parser's stack, and whether it would have been exhausted. */
+  int depth;
+  bool exhausted;
+};
+
+static void climb_advance(struct climb *climb) {
+  climb->last = climb->location;
+  climb->token = yylex(&climb->value, &climb->location, climb->scanner);
+  if (climb->token < 0) {
+    /* Like bison, treat a scanning error as the end of the input. */
+    climb->token = 0;
+  }
+}
+
+/*
+ * Consume the lookahead as bison shifts it. Its stack holds a state for
+ * each symbol and one below them, and the shift fails when that fills the
+ * stack.
+ */
+static bool climb_shift(struct climb *climb) {
+  if (climb->depth + 2 >= YYMAXDEPTH) {
+    compiler_print_error(climb->location, "memory exhausted");
+    (*climb->error_count)++;
+    climb->aborted = climb->exhausted = true;
+    return false;
+  }
+  climb->depth++;
+  climb_advance(climb);
+  return true;
+}
+
+/* Replace the symbols of a rule on the stack by the one it reduces to. */
+static void climb_reduce(struct climb *climb, int symbols) {
+  climb->depth -= symbols - 1;
+}
+
+static struct node *climb_error(struct climb *climb) {
+  compiler_print_error(climb->location, "syntax error");
+  (*climb->error_count)++;
+  return NULL;
+}
+
+static struct climb_operator const *climb_find(struct climb_operator const *operators, int token) {
+  struct climb_operator const *operator;
+  for (operator = operators; 0 != operator->token; operator++) {
+    if (token == operator->token) {
+      return operator;
+    }
+  }
+  return operator;
+}
+
+static struct climb_operator const *climb_operator(int token) {
+  return climb_find(climb_operators, token);
+}
+
+static struct node *climb_expression(struct climb *climb);
+
+static struct node *climb_primary(struct climb *climb) {
+  struct node *primary;
+
+  switch (climb->token) {
+    case IDENTIFIER:
+    case NUMBER:
+      primary = climb->value;
+      return climb_shift(climb) ? primary : NULL;
+
+    case LEFT_PAREN:
+      if (!climb_shift(climb)) {
+        return NULL;
+      }
+      primary = climb_expression(climb);
+      if (NULL == primary) {
+        return NULL;
+      }
+      if (RIGHT_PAREN != climb->token) {
+        return climb_error(climb);
+      }
+      if (!climb_shift(climb)) {
+        return NULL;
+      }
+      climb_reduce(climb, 3);
+      return primary;
+
+    default:
+      return climb_error(climb);
+  }
+}
+
+/*
+ * The actions in parser.y use the location of the last token read. Bison
+ * reduces a postfix ++ or -- as soon as it is shifted, so that node takes
+ * the location of the operator. Every other operation is reduced only after
+ * reading the token that follows its operand, to see whether a postfix
+ * operator comes next, and takes the location of that token.
+ */
+static struct node *climb_unary(struct climb *climb) {
+  enum node_binary_operation operation;
+  struct node *operand;
+  YYLTYPE location;
+
+  if (PLUS_PLUS == climb->token || MINUS_MINUS == climb->token) {
+    operation = PLUS_PLUS == climb->token ? BINOP_ASSIGN_ADDITION : BINOP_ASSIGN_SUBTRACTION;
+    location = climb->location;
+    if (!climb_shift(climb)) {
+      return NULL;
+    }
+    operand = climb_unary(climb);
+    if (NULL == operand) {
+      return NULL;
+    }
+    climb_reduce(climb, 2);
+    return node_increment(climb->location, location, operation, operand);
+  }
+
+  operand = climb_primary(climb);
+  while (NULL != operand && (PLUS_PLUS == climb->token || MINUS_MINUS == climb->token)) {
+    operation = PLUS_PLUS == climb->token ? BINOP_POST_INCREMENT : BINOP_POST_DECREMENT;
+    if (!climb_shift(climb)) {
+      return NULL;
+    }
+    climb_reduce(climb, 2);
+    operand = node_increment(climb->last, climb->last, operation, operand);
+  }
+  return operand;
+}
+
+/*
+ * climb_binary - extend left with the operators of at least min_precedence
+ *
+ * Operators of the same precedence are folded into left in a loop, giving
+ * left-associative trees, and only a higher-precedence operator on the right
+ * makes a recursive call. Left is already on the stack.
+ */
+static struct node *climb_binary(struct climb *climb, struct node *left, int min_precedence) {
+  struct climb_operator const *operator;
+  struct node *right;
+
+  for (operator = climb_operator(climb->token);
+       0 != operator->token && operator->precedence >= min_precedence;
+       operator = climb_operator(climb->token)) {
+    if (!climb_shift(climb)) {
+      return NULL;
+    }
+    right = climb_unary(climb);
+    while (NULL != right && climb_operator(climb->token)->precedence > operator->precedence) {
+      right = climb_binary(climb, right, operator->precedence + 1);
+    }
+    if (NULL == right) {
+      return NULL;
+    }
+    climb_reduce(climb, 3);
+    left = node_binary_operation(climb->location, operator->operation, left, right);
+  }
+  return left;
+}
+
+/* An assignment takes a unary expression on the left and no assignment on the right. */
+static struct node *climb_expression(struct climb *climb) {
+  struct climb_operator const *assignment;
+  struct node *left, *right;
+
+  left = climb_unary(climb);
+  if (NULL == left) {
+    return NULL;
+  }
+  assignment = climb_find(climb_assignments, climb->token);
+  if (0 == assignment->token) {
+    return climb_binary(climb, left, 1);
+  }
+
+  if (!climb_shift(climb)) {
+    return NULL;
+  }
+  right = climb_unary(climb);
+  if (NULL != right) {
+    right = climb_binary(climb, right, 1);
+  }
+  if (NULL == right) {
+    return NULL;
+  }
+  climb_reduce(climb, 3);
+  return node_binary_operation(climb->location, assignment->operation, left, right);
+}
+
+static struct node *climb_statement(struct climb *climb) {
+  struct node *expression = climb_expression(climb);
+
+  if (NULL != expression) {
+    if (SEMICOLON == climb->token) {
+      if (!climb_shift(climb)) {
+        return NULL;
+      }
+      return node_expression_statement(climb->last, expression);
+    }
+    climb_error(climb);
+  }
+  if (climb->exhausted) {
+    return NULL;
+  }
+
+  /* Recover by discarding tokens up to and including the next semicolon. */
+  while (SEMICOLON != climb->token) {
+    if (0 == climb->token) {
+      climb->aborted = true;
+      return NULL;
+    }
+    climb_advance(climb);
+  }
+  climb_advance(climb);
+  return node_null_statement(climb->last);
+}
+
+static struct node *climb_program(struct climb *climb) {
+  struct node *statement_list = NULL, *statement;
+
+  /* Like bison's, the location before the first token has no text. */
+  climb->location.offset = climb->location.length = 0;
+  climb->aborted = climb->exhausted = false;
+  climb->depth = 0;
+  climb_advance(climb);
+
+  do {
+    statement = climb_statement(climb);
+    if (climb->aborted) {
+      return NULL;
+    }
+
+    /* Every statement is reduced into the statement list, the one symbol below the next. */
+    climb->depth = 1;
+    if (NULL == climb->stream) {
+      statement_list = node_statement_list(climb->last, statement_list, statement);
+    } else {
+      climb->stream->handler(statement, climb->stream->context);
+    }
+  } while (0 != climb->token);
+
+  return statement_list;
+}
+
+struct node *parser_create_tree(int *error_count, yyscan_t scanner) {
+  struct climb climb;
+  struct node *parse_tree;
+
+  climb.scanner = scanner;
+  climb.error_count = error_count;
+  climb.stream = NULL;
+  parse_tree = climb_program(&climb);
+  if (climb.aborted || *error_count > 0) {
+    return NULL;
+  }
+  return parse_tree;
+}
+
+int parser_stream_statements(int *error_count, yyscan_t scanner,
+                             parser_statement_handler handler, void *context) {
+  struct parser_stream stream;
+  struct climb climb;
+
+  stream.handler = handler;
+  stream.context = context;
+  climb.scanner = scanner;
+  climb.error_count = error_count;
+  climb.stream = &stream;
+  climb_program(&climb);
+  if (climb.exhausted) {
+    fprintf(stdout, "Parser ran out of memory.\n");
+    return 2;
+  }
+  return climb.aborted ? 1 : 0;
+}
@@ -1,9 +1,14 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include <unistd.h>
 #include <limits.h>
+#include <errno.h>
 #include <stdarg.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 #include "compiler.h"
 #include "parser.h"
@@ -12,15 +17,67 @@
 #include "symbol.h"
 #include "type.h"
 #include "ir.h"
+#include "emit.h"
 #include "mips.h"
+#include "x86.h"
+#include "elf.h"
+#include "cache.h"
+#include "image.h"
+#include "flat.h"
+#include "simplify.h"
+#include "range.h"
+#include "location.h"
+#include "queue.h"
+#include "profile.h"
+#include "arena.h"
+#include "server.h"
+#include "incremental.h"
 
 extern int errno;
 
+static void compiler_wait_for_back_end(void);
+static int compiler_listen(char const *path, int workers);
+
+/*
+ * A worker of a compile server allocates the trees, IR and symbols of each
+ * compile from its arena, and scans every compile with the same scanner.
+ * Streaming compiles free as they go, and the pipeline allocates from two
+ * threads, so they use malloc.
+ */
+static struct {
+  bool serving;
+  struct arena arena;
+  yyscan_t scanner;
+  bool print_statistics;
+} compiler_server;
+
+static void compiler_start_scanner(yyscan_t *scanner, FILE *input) {
+  if (!compiler_server.serving) {
+    scanner_initialize(scanner, input);
+  } else if (NULL == compiler_server.scanner) {
+    scanner_initialize(&compiler_server.scanner, input);
+    *scanner = compiler_server.scanner;
+  } else {
+    scanner_restart(compiler_server.scanner, input);
+    *scanner = compiler_server.scanner;
+  }
+}
+
+static void compiler_finish_scanner(yyscan_t *scanner) {
+  if (!compiler_server.serving) {
+    scanner_destroy(scanner);
+  }
+}
+
 void compiler_print_error(YYLTYPE location, const char *format, ...) {
+  struct location_lines lines;
   va_list ap;
+
+  compiler_wait_for_back_end();
+  lines = location_find_lines(location);
   fprintf(stdout, "Error (%d, %d) to (%d, %d): ",
-          location.first_line, location.first_column,
-          location.last_line, location.last_column);
+          lines.first_line, lines.first_column,
+          lines.last_line, lines.last_column);
   va_start(ap, format);
   vfprintf(stdout, format, ap);
   va_end(ap);
@@ -32,54 +89,751 @@ static void print_errors_from_pass(char *pass, int error_count) {
           pass, error_count, (error_count == 1 ? "error" : "errors"));
 }
 
-/**
- * Launches the compiler.
- * 
- * The following describes the arguments to the program:
- * compiler [-s (scanner|parser|symbol|type|ir|mips)] [-o outputfile] [inputfile|stdin]
+/*
+ * compiler_read_all - read the whole of input into a NUL terminated buffer
  *
- * -s : the name of the stage to stop after. Defaults to
- *      runs all of the stages.
- * -o : the name of the output file. Defaults to "output.s"      
+ * Side-effects:
+ *   Memory is allocated on the heap.
+ */
+static char *compiler_read_all(FILE *input, size_t *length) {
+  size_t capacity = 65536, count;
+  char *buffer = malloc(capacity);
+  assert(NULL != buffer);
+
+  *length = 0;
+  while (0 < (count = fread(buffer + *length, 1, capacity - *length - 1, input))) {
+    *length += count;
+    if (*length + 1 == capacity) {
+      capacity *= 2;
+      buffer = realloc(buffer, capacity);
+      assert(NULL != buffer);
+    }
+  }
+  buffer[*length] = '\0';
+  return buffer;
+}
+
+/*
+ * compiler_read_input - read the whole of input, as compiler_read_all does,
+ * and close it
+ */
+static char *compiler_read_input(FILE *input, size_t *length) {
+  char *buffer = compiler_read_all(input, length);
+
+  if (stdin != input) {
+    fclose(input);
+  }
+  return buffer;
+}
+
+/*
+ * The machines code can be printed for. Each target prints the IR of a
+ * program as a whole or a section at a time, and may have statistics of its
+ * own to print.
+ */
+struct compiler_target {
+  char const *name;
+  char const *banner;
+  void (*print_program)(struct emit_buffer *output, struct ir_section *section);
+  void (*print_prologue)(struct emit_buffer *output);
+  void (*print_section)(struct emit_buffer *output, struct ir_section *section);
+  void (*print_epilogue)(struct emit_buffer *output);
+  void (*print_statistics)(FILE *output);
+};
+
+static struct compiler_target const compiler_targets[] = {
+  { "mips", "================== MIPS ==================\n",
+    mips_print_program, mips_print_prologue, mips_print_section, mips_print_epilogue, NULL },
+  { "x86-64", "================= X86-64 =================\n",
+    x86_print_program, x86_print_prologue, x86_print_section, x86_print_epilogue, x86_print_statistics }
+};
+
+static struct compiler_target const *compiler_find_target(char const *name) {
+  size_t i;
+
+  for (i = 0; i < sizeof(compiler_targets) / sizeof(compiler_targets[0]); i++) {
+    if (0 == strcmp(name, compiler_targets[i].name)) {
+      return &compiler_targets[i];
+    }
+  }
+  return NULL;
+}
+
+struct compiler_options {
+  char *stage;
+  struct compiler_target const *target;
+  char output_name[NAME_MAX + 1];
+  char *read_image;
+  char *write_image;
+  bool stream;
+  bool pipeline;
+  bool incremental;
+  bool through_ir;
+  char const *flags;
+  bool compact;
+  bool object;
+  bool big_endian;
+  char *disassemble;
+  int optimization;
+  bool profile_generate;
+  char *profile_use;
+  struct profile *profile;
+  bool print_statistics;
+};
+
+static int compiler_check_image_output(int error_count) {
+  if (error_count > 0) {
+    print_errors_from_pass("Image output", error_count);
+    return 1;
+  }
+  return 0;
+}
+
+/*
+ * compiler_write_object - write the object file once all the code is encoded
+ */
+static int compiler_write_object(struct elf_object *object, struct compiler_options *options, bool *wrote_output) {
+  if (object->error_count > 0) {
+    elf_destroy(object);
+    print_errors_from_pass("Object output", object->error_count);
+    return 1;
+  }
+  if (!elf_write(object, options->output_name)) {
+    fprintf(stdout, "Could not write output file %s: %s\n", options->output_name, strerror(errno));
+    elf_destroy(object);
+    remove(options->output_name);
+    return 1;
+  }
+  elf_destroy(object);
+  *wrote_output = true;
+  return 0;
+}
+
+/*
+ * compiler_tree_to_mips - whether the code is printed straight from the
+ * typed tree, without generating IR
  *
- * You should pass the name of the file to process or redirect stdin.
+ * Only -O0 does, since the optimizations after the tree work on the IR, and
+ * only for assembly output without profile counters. Incremental compiles
+ * keep the IR of their statements, so they go through it as well.
  */
-int main(int argc, char **argv) {
-  FILE *output;
-  struct symbol_table symbol_table;
-  char *stage, output_name[NAME_MAX + 1];
-  int opt;
-  yyscan_t scanner;
-  struct node *parse_tree;
+static bool compiler_tree_to_mips(struct compiler_options *options) {
+  return &compiler_targets[0] == options->target && 0 == options->optimization && !options->through_ir && !options->object && !options->profile_generate
+         && !options->incremental && 0 == strcmp("mips", options->stage);
+}
+
+/* Print the program of tree when it is not NULL, and of ir otherwise. */
+static void compiler_print_code(struct emit_buffer *output, struct compiler_options *options, struct node *tree,
+                                struct ir_section *ir) {
+  if (NULL != tree) {
+    mips_print_tree(output, tree);
+  } else {
+    options->target->print_program(output, ir);
+  }
+  emit_string(output, "\n\n");
+}
+
+/*
+ * compiler_run_from_ir - run the stages that follow IR generation
+ *
+ * When tree is not NULL, the code is printed from it instead of from ir,
+ * which is NULL.
+ */
+static int compiler_run_from_ir(struct ir_section *ir, struct node *tree, struct compiler_options *options,
+                                bool *wrote_output) {
+  struct emit_buffer output;
+  struct elf_object object;
+
+  fputs(options->target->banner, stdout);
+  fflush(stdout);
+  emit_attach(&output, STDOUT_FILENO);
+  compiler_print_code(&output, options, tree, ir);
+  emit_close(&output);
+
+  if (options->object) {
+    elf_initialize(&object, options->big_endian);
+    elf_add_section(&object, ir);
+    return compiler_write_object(&object, options, wrote_output);
+  }
+
+  if (!emit_open(&output, options->output_name)) {
+    fprintf(stdout, "Could not open output file %s: %s", options->output_name, strerror(errno));
+    return 1;
+  }
+  compiler_print_code(&output, options, tree, ir);
+  if (!emit_close(&output)) {
+    fprintf(stdout, "Could not write output file %s: %s\n", options->output_name, strerror(errno));
+    remove(options->output_name);
+    return 1;
+  }
+  *wrote_output = true;
+
+  if (options->print_statistics) {
+    if (NULL != tree) {
+      mips_print_statistics(stderr);
+    } else if (NULL != options->target->print_statistics) {
+      options->target->print_statistics(stderr);
+    }
+  }
+  return 0;
+}
+
+/*
+ * compiler_run_from_tree - run the stages that follow type checking
+ *
+ * A tree loaded from an image lives in the image's mapping, and its nodes
+ * cannot be freed.
+ */
+static int compiler_run_from_tree(struct node *parse_tree, bool from_image, struct compiler_options *options,
+                                  bool *wrote_output) {
   int error_count;
 
-  strncpy(output_name, "output.s", NAME_MAX + 1);
-  stage = "mips";
-  while (-1 != (opt = getopt(argc, argv, "o:s:"))) {
-    switch (opt) {
-      case 'o':
-        strncpy(output_name, optarg, NAME_MAX);
-        break;
-      case 's':
-        stage = optarg;
-        break;
+  if (options->optimization >= 1) {
+    simplify_statement_list(parse_tree, !from_image);
+    if (options->print_statistics) {
+      simplify_print_statistics(stderr);
+    }
+  }
+  if (options->optimization >= 2) {
+    simplify_balance_statement_list(parse_tree, options->profile);
+    if (options->print_statistics) {
+      simplify_print_balance_statistics(stderr);
+      if (NULL != options->profile) {
+        profile_print_statistics(stderr, options->profile);
+      }
     }
   }
 
-  /* Figure out whether we're using stdin/stdout or file in/file out. */
-  if (optind >= argc) {
-    scanner_initialize(&scanner, stdin);
-  } else if (optind == argc - 1) {
-    scanner_initialize(&scanner, fopen(argv[optind], "r"));
+  if (compiler_tree_to_mips(options)) {
+    return compiler_run_from_ir(NULL, parse_tree, options, wrote_output);
+  }
+
+  error_count = ir_generate_for_statement_list(parse_tree);
+  if (error_count > 0) {
+    print_errors_from_pass("IR generation", error_count);
+    return 1;
+  }
+  if (options->optimization >= 1) {
+    range_narrow_section(parse_tree->ir);
+  }
+  if (options->print_statistics) {
+    ir_print_statistics(stderr);
+    if (options->optimization >= 1) {
+      range_print_statistics(stderr);
+    }
+  }
+  fprintf(stdout, "=================== IR ===================\n");
+  ir_print_section(stdout, parse_tree->ir);
+  if (0 == strcmp("ir", options->stage)) {
+    if (NULL != options->write_image) {
+      return compiler_check_image_output(image_write_ir(options->write_image, parse_tree->ir));
+    }
+    return 0;
+  }
+
+  return compiler_run_from_ir(parse_tree->ir, NULL, options, wrote_output);
+}
+
+/*
+ * compiler_run_from_image - resume the compiler from the stage after the
+ * one that wrote the image
+ */
+static int compiler_run_from_image(struct compiler_options *options, bool *wrote_output) {
+  struct image image;
+  char *image_stage;
+  int status;
+
+  if (0 != image_load(options->read_image, &image)) {
+    print_errors_from_pass("Image input", 1);
+    return 1;
+  }
+
+  image_stage = IMAGE_TREE == image.kind ? "type" : "ir";
+  if (0 == strcmp("scanner", options->stage) || 0 == strcmp("parser", options->stage)
+      || 0 == strcmp("symbol", options->stage) || 0 == strcmp(image_stage, options->stage)
+      || (IMAGE_IR == image.kind && 0 == strcmp("type", options->stage))) {
+    fprintf(stdout, "Cannot stop at stage %s when resuming after stage %s.\n", options->stage, image_stage);
+    image_unload(&image);
+    return 1;
+  }
+
+  if (IMAGE_TREE == image.kind) {
+    status = compiler_run_from_tree(image.tree, true, options, wrote_output);
   } else {
-    fprintf(stdout, "Expected 1 input file, found %d.\n", argc - optind);
+    status = compiler_run_from_ir(image.ir, NULL, options, wrote_output);
+  }
+  image_unload(&image);
+  return status;
+}
+
+/*
+ * In streaming mode every statement runs through all of the stages as soon
+ * as the parser reduces it, and is freed once its code has been printed, so
+ * memory use does not grow with the length of the program. No stage dumps
+ * are printed.
+ */
+struct compiler_stream {
+  struct symbol_table symbol_table;
+  struct compiler_options *options;
+  struct emit_buffer output;
+  struct elf_object object;
+  int *parser_error_count;
+  int symbol_error_count;
+  unsigned long statements;
+
+  /* In an incremental compile, the statement whose code is kept. */
+  struct incremental_statement *kept;
+};
+
+/* Generate the IR of a statement, print its code, then keep or free the IR. */
+static void compiler_stream_generate(struct compiler_stream *stream, struct node *statement) {
+  ir_generate_for_expression_statement(statement);
+  if (stream->options->optimization >= 1) {
+    range_narrow_section(statement->ir);
+  }
+  if (stream->options->object) {
+    elf_add_section(&stream->object, statement->ir);
+  } else {
+    stream->options->target->print_section(&stream->output, statement->ir);
+  }
+  if (NULL != stream->kept) {
+    stream->kept->ir = *statement->ir;
+    stream->kept->compiled = true;
+  } else {
+    ir_destroy_instructions(statement->ir);
+  }
+}
+
+/* Run the stages after parsing over one statement, then free it. */
+static void compiler_stream_compile(struct compiler_stream *stream, struct node *statement) {
+  /* After an error keep checking statements, but stop generating code. */
+  if (NODE_EXPRESSION_STATEMENT == statement->kind) {
+    stream->symbol_error_count += symbol_add_from_expression_statement(&stream->symbol_table, statement);
+    if (0 == stream->symbol_error_count) {
+      type_assign_in_expression_statement(statement);
+      if (stream->options->optimization >= 1) {
+        simplify_expression_statement(statement, true);
+      }
+      if (stream->options->optimization >= 2) {
+        simplify_balance_expression_statement(statement,
+                                              simplify_balance_temporaries(stream->options->profile,
+                                                                           stream->statements++));
+      }
+      if (compiler_tree_to_mips(stream->options)) {
+        mips_print_expression_statement(&stream->output, statement);
+      } else {
+        compiler_stream_generate(stream, statement);
+      }
+    }
+  }
+  node_destroy(statement);
+}
+
+/* After a parse error the statements are only freed. */
+static void compiler_stream_statement(struct node *statement, void *context) {
+  struct compiler_stream *stream = context;
+
+  if (0 == *stream->parser_error_count) {
+    compiler_stream_compile(stream, statement);
+  } else {
+    node_destroy(statement);
+  }
+}
+
+/*
+ * A pipelined compile is a streaming compile split across two threads. The
+ * scanner and parser run on the calling thread and hand each statement
+ * through a lock-free queue to a back end thread, which runs the rest of the
+ * stages in order. A NULL statement ends the queue.
+ *
+ * Errors must come out in the same order as they would without the
+ * pipeline, so before the front end reports one it waits for the back end
+ * to finish every statement already queued.
+ */
+#define COMPILER_PIPELINE_DEPTH 1024
+
+struct compiler_pipeline {
+  struct compiler_stream *stream;
+  struct queue queue;
+  pthread_t front_end;
+  unsigned long queued;
+  atomic_ulong completed;
+};
+
+static struct compiler_pipeline *compiler_running_pipeline;
+
+static void compiler_wait_for_back_end(void) {
+  struct compiler_pipeline *pipeline = compiler_running_pipeline;
+
+  if (NULL != pipeline && pthread_equal(pthread_self(), pipeline->front_end)) {
+    while (atomic_load_explicit(&pipeline->completed, memory_order_acquire) < pipeline->queued) {
+      sched_yield();
+    }
+  }
+}
+
+static void compiler_pipeline_statement(struct node *statement, void *context) {
+  struct compiler_pipeline *pipeline = context;
+
+  if (0 == *pipeline->stream->parser_error_count) {
+    pipeline->queued++;
+    queue_push(&pipeline->queue, statement);
+  } else {
+    node_destroy(statement);
+  }
+}
+
+static void *compiler_pipeline_back_end(void *context) {
+  struct compiler_pipeline *pipeline = context;
+  struct node *statement;
+
+  while (NULL != (statement = queue_pop(&pipeline->queue))) {
+    compiler_stream_compile(pipeline->stream, statement);
+    atomic_fetch_add_explicit(&pipeline->completed, 1, memory_order_release);
+  }
+  return NULL;
+}
+
+/*
+ * compiler_parse_pipelined - parse the statements of a streaming compile
+ * while a second thread compiles them
+ *
+ * Falls back to a single thread when the back end thread cannot be started.
+ * Returns the result of the parser.
+ */
+static int compiler_parse_pipelined(struct compiler_stream *stream, yyscan_t scanner) {
+  struct compiler_pipeline pipeline;
+  pthread_t back_end;
+  int result;
+
+  pipeline.stream = stream;
+  queue_initialize(&pipeline.queue, COMPILER_PIPELINE_DEPTH);
+  pipeline.front_end = pthread_self();
+  pipeline.queued = 0;
+  atomic_init(&pipeline.completed, 0);
+  if (0 != pthread_create(&back_end, NULL, compiler_pipeline_back_end, &pipeline)) {
+    queue_destroy(&pipeline.queue);
+    return parser_stream_statements(stream->parser_error_count, scanner, compiler_stream_statement, stream);
+  }
+
+  compiler_running_pipeline = &pipeline;
+  result = parser_stream_statements(stream->parser_error_count, scanner, compiler_pipeline_statement, &pipeline);
+  queue_push(&pipeline.queue, NULL);
+  pthread_join(back_end, NULL);
+  compiler_running_pipeline = NULL;
+
+  if (stream->options->print_statistics) {
+    queue_print_statistics(stderr, &pipeline.queue);
+  }
+  queue_destroy(&pipeline.queue);
+  return result;
+}
+
+/* Open the output of a streaming compile, and print what comes before the code. */
+static bool compiler_open_stream(struct compiler_stream *stream, struct compiler_options *options) {
+  if (options->object) {
+    elf_initialize(&stream->object, options->big_endian);
+  } else if (!emit_open(&stream->output, options->output_name)) {
+    fprintf(stdout, "Could not open output file %s: %s", options->output_name, strerror(errno));
+    return false;
+  } else {
+    options->target->print_prologue(&stream->output);
+  }
+  stream->options = options;
+  stream->symbol_error_count = 0;
+  stream->statements = 0;
+  stream->kept = NULL;
+  return true;
+}
+
+/*
+ * compiler_close_stream - finish the output of a streaming compile, given
+ * the result of its parser
+ *
+ * Returns the exit status of the compiler.
+ */
+static int compiler_close_stream(struct compiler_stream *stream, int result, bool *wrote_output) {
+  struct compiler_options *options = stream->options;
+  int error_count = *stream->parser_error_count;
+
+  if (0 != result || error_count > 0 || stream->symbol_error_count > 0) {
+    if (options->object) {
+      elf_destroy(&stream->object);
+    } else {
+      emit_close(&stream->output);
+      remove(options->output_name);
+    }
+    if (0 != result || error_count > 0) {
+      print_errors_from_pass("Parser", error_count);
+    } else {
+      print_errors_from_pass("Symbol table", stream->symbol_error_count);
+    }
+    return 1;
+  }
+
+  if (options->object) {
+    if (0 != compiler_write_object(&stream->object, options, wrote_output)) {
+      return 1;
+    }
+  } else {
+    options->target->print_epilogue(&stream->output);
+    emit_string(&stream->output, "\n\n");
+    if (!emit_close(&stream->output)) {
+      fprintf(stdout, "Could not write output file %s: %s\n", options->output_name, strerror(errno));
+      remove(options->output_name);
+      return 1;
+    }
+    *wrote_output = true;
+  }
+  if (options->print_statistics) {
+    if (options->optimization >= 1) {
+      simplify_print_statistics(stderr);
+    }
+    if (options->optimization >= 2) {
+      simplify_print_balance_statistics(stderr);
+      if (NULL != options->profile) {
+        profile_print_statistics(stderr, options->profile);
+      }
+    }
+    if (compiler_tree_to_mips(options)) {
+      mips_print_statistics(stderr);
+    } else {
+      ir_print_statistics(stderr);
+      if (NULL != options->target->print_statistics) {
+        options->target->print_statistics(stderr);
+      }
+    }
+    if (options->optimization >= 1) {
+      range_print_statistics(stderr);
+    }
+  }
+  return 0;
+}
+
+/*
+ * compiler_run_streaming - run every stage a statement at a time
+ *
+ * The output file is the same as the one written by compiler_run.
+ */
+static int compiler_run_streaming(FILE *input, struct compiler_options *options, bool *wrote_output) {
+  struct compiler_stream stream;
+  yyscan_t scanner;
+  int error_count, result;
+
+  if (!compiler_open_stream(&stream, options)) {
     return 1;
   }
+  symbol_initialize_table(&stream.symbol_table);
+  error_count = 0;
+  stream.parser_error_count = &error_count;
+
+  compiler_start_scanner(&scanner, input);
+  if (options->pipeline) {
+    result = compiler_parse_pipelined(&stream, scanner);
+  } else {
+    result = parser_stream_statements(&error_count, scanner, compiler_stream_statement, &stream);
+  }
+  compiler_finish_scanner(&scanner);
+  symbol_destroy_table(&stream.symbol_table);
+  return compiler_close_stream(&stream, result, wrote_output);
+}
+
+/*
+ * An incremental compile is a streaming compile that keeps its statements,
+ * so that the next one can reuse what the edits to the source left alone.
+ * See incremental.c. The workers of a compile server keep them from one
+ * compile to the next; a compiler run on its own has nothing to reuse.
+ */
+static struct incremental_program compiler_incremental;
+
+static struct incremental_checkpoint compiler_checkpoint(struct compiler_stream *stream) {
+  struct incremental_checkpoint checkpoint;
+
+  checkpoint.symbols = symbol_count(&stream->symbol_table);
+  checkpoint.ir = ir_get_position();
+  checkpoint.balanced = stream->statements;
+  return checkpoint;
+}
 
-  if (0 == strcmp("scanner", stage)) {
+/* Run the stages after parsing over a copy of the tree of a kept statement. */
+static void compiler_incremental_compile(struct compiler_stream *stream, struct incremental_statement *kept) {
+  kept->before = compiler_checkpoint(stream);
+  stream->kept = kept;
+  compiler_stream_compile(stream, node_copy_statement(kept->tree, (int32_t)(kept->offset - kept->parsed_offset)));
+  stream->kept = NULL;
+}
+
+/*
+ * Keep each statement parsed again. A statement with a parse error has no
+ * tree, so that it is parsed again by the next compile, and reports its
+ * error again. After a parse error the statements are only kept.
+ */
+static void compiler_incremental_statement(struct node *statement, void *context) {
+  struct compiler_stream *stream = context;
+  struct incremental_program *program = &compiler_incremental;
+  struct incremental_statement *last, *kept;
+  uint32_t offset, end;
+
+  last = 0 == program->count ? NULL : &program->statements[program->count - 1];
+  offset = NULL == last ? 0 : last->offset + last->length;
+  end = statement->location.offset + statement->location.length;
+  program->statistics.reparsed++;
+  if (NODE_EXPRESSION_STATEMENT != statement->kind) {
+    node_destroy(statement);
+    incremental_add(program, offset, end - offset, offset, NULL);
+  } else if (0 != *stream->parser_error_count) {
+    incremental_add(program, offset, end - offset, offset, statement);
+  } else {
+    kept = incremental_add(program, offset, end - offset, offset, statement);
+    compiler_incremental_compile(stream, kept);
+  }
+}
+
+/* Add the lines that begin between start and end to the lines of source, without scanning it. */
+static void compiler_add_lines(char const *source, size_t start, size_t end) {
+  char const *newline;
+
+  while (start < end && NULL != (newline = memchr(source + start, '\n', end - start))) {
+    start = (size_t)(newline - source) + 1;
+    location_add_line((uint32_t)start);
+  }
+}
+
+/*
+ * compiler_run_incremental - run a streaming compile that reuses what it
+ * can of the last incremental compile
+ *
+ * The output file is the same as the one a streaming compile through the IR
+ * writes, even at -O0. Only the text between the statements kept at the
+ * start and at the end of the source is scanned and parsed, unless it is
+ * blank. The code of the kept
+ * statements before the first that changed is printed again as it was.
+ */
+static int compiler_run_incremental(FILE *input, struct compiler_options *options, bool *wrote_output) {
+  struct incremental_program *program = &compiler_incremental;
+  struct incremental_statement *suffix, *kept;
+  struct incremental_checkpoint checkpoint;
+  struct incremental_plan plan;
+  struct compiler_stream stream;
+  yyscan_t scanner;
+  FILE *region = NULL;
+  size_t length, suffix_count, i;
+  int error_count = 0, result = 0, status;
+  uint32_t last;
+  bool parsed;
+  char *source;
+
+  source = compiler_read_all(input, &length);
+  if (!compiler_open_stream(&stream, options)) {
+    free(source);
+    return 1;
+  }
+  stream.parser_error_count = &error_count;
+
+  /* The counts of a profile are not part of the flags, so nothing is kept over them. */
+  if (NULL != options->profile) {
+    incremental_destroy(program);
+    incremental_initialize(program);
+  }
+  incremental_plan(program, options->flags, source, length, &plan);
+  suffix = incremental_begin(program, &plan, &suffix_count, &checkpoint);
+  stream.symbol_table = program->symbol_table;
+  ir_set_position(checkpoint.ir);
+  stream.statements = checkpoint.balanced;
+
+  /* Blank text after the statements kept at the start would only fail to parse on its own. */
+  if (0 == plan.start || !incremental_is_blank(source + plan.start, plan.end - plan.start)) {
+    region = fmemopen(source + plan.start, plan.end - plan.start, "r");
+    assert(NULL != region);
+    compiler_start_scanner(&scanner, region);
+    compiler_add_lines(source, 0, plan.start);
+    scanner_start_at(scanner, plan.start);
+  } else {
+    location_start_source();
+    compiler_add_lines(source, 0, plan.end);
+  }
+
+  for (i = 0; i < plan.reused; i++) {
+    if (options->object) {
+      elf_add_section(&stream.object, &program->statements[i].ir);
+    } else {
+      options->target->print_section(&stream.output, &program->statements[i].ir);
+    }
+    if (options->optimization >= 1) {
+      range_follow_section(&program->statements[i].ir);
+    }
+  }
+  for (i = plan.reused; i < plan.kept; i++) {
+    program->statistics.recompiled++;
+    compiler_incremental_compile(&stream, &program->statements[i]);
+  }
+
+  if (NULL != region) {
+    result = parser_stream_statements(&error_count, scanner, compiler_incremental_statement, &stream);
+    compiler_finish_scanner(&scanner);
+    fclose(region);
+  }
+  compiler_add_lines(source, plan.end, length);
+
+  /*
+   * The parser takes a character the scanner does not know for the end of
+   * the source, so the parse can stop short of the moved statements, which
+   * are then left out as they would be if they were parsed.
+   */
+  last = 0 == program->count ? 0 : program->statements[program->count - 1].offset
+                                    + program->statements[program->count - 1].length;
+  parsed = 0 == result && incremental_is_blank(source + last, plan.end - last);
+  for (i = 0; i < suffix_count; i++) {
+    if (!parsed) {
+      incremental_drop(&suffix[i]);
+      continue;
+    }
+    kept = incremental_add(program, suffix[i].offset, suffix[i].length, suffix[i].parsed_offset, suffix[i].tree);
+    if (0 == error_count) {
+      program->statistics.recompiled++;
+      compiler_incremental_compile(&stream, kept);
+    }
+  }
+  free(suffix);
+
+  program->complete = parsed;
+  program->symbol_table = stream.symbol_table;
+  checkpoint = compiler_checkpoint(&stream);
+  incremental_finish(program, source, length, &checkpoint);
+
+  status = compiler_close_stream(&stream, result, wrote_output);
+  if (0 == status && options->print_statistics) {
+    incremental_print_statistics(stderr, program);
+  }
+  return status;
+}
+
+/*
+ * compiler_run - run the stages of the compiler over input
+ *
+ * Returns the exit status of the compiler. wrote_output is set when the
+ * output file was written.
+ */
+static int compiler_run(FILE *input, struct compiler_options *options, bool *wrote_output) {
+  struct symbol_table symbol_table;
+  yyscan_t scanner;
+  struct node *parse_tree;
+  int error_count;
+
+  *wrote_output = false;
+  if (NULL != options->read_image) {
+    return compiler_run_from_image(options, wrote_output);
+  } else if (options->incremental) {
+    return compiler_run_incremental(input, options, wrote_output);
+  } else if (options->stream) {
+    return compiler_run_streaming(input, options, wrote_output);
+  }
+  compiler_start_scanner(&scanner, input);
+
+  if (0 == strcmp("scanner", options->stage)) {
     error_count = 0;
     scanner_print_tokens(stdout, &error_count, scanner);
-    scanner_destroy(&scanner);
+    compiler_finish_scanner(&scanner);
     if (error_count > 0) {
       print_errors_from_pass("Scanner", error_count);
       return 1;
@@ -90,17 +844,31 @@ int main(int argc, char **argv) {
 
   error_count = 0;
   parse_tree = parser_create_tree(&error_count, scanner);
-  scanner_destroy(&scanner);
+  compiler_finish_scanner(&scanner);
   if (NULL == parse_tree) {
     print_errors_from_pass("Parser", error_count);
     return 1;
   }
 
-  if (0 == strcmp("parser", stage)) {
+  if (0 == strcmp("parser", options->stage)) {
     node_print_statement_list(stdout, parse_tree);
     return 0;
   }
 
+  if (0 == strcmp("flat", options->stage)) {
+    struct flat_tree flat_tree;
+
+    flat_initialize(&flat_tree);
+    flat_add_statement_list(&flat_tree, parse_tree);
+    node_destroy(parse_tree);
+    flat_print_statement_list(stdout, &flat_tree, flat_tree.root);
+    if (options->print_statistics) {
+      flat_print_footprint(stderr, &flat_tree);
+    }
+    flat_destroy(&flat_tree);
+    return 0;
+  }
+
   symbol_initialize_table(&symbol_table);
   error_count = symbol_add_from_statement_list(&symbol_table, parse_tree);
   if (error_count > 0) {
@@ -109,7 +877,7 @@ int main(int argc, char **argv) {
   }
   fprintf(stdout, "================= SYMBOLS ================\n");
   symbol_print_table(stdout, &symbol_table);
-  if (0 == strcmp("symbol", stage)) {
+  if (0 == strcmp("symbol", options->stage)) {
     fprintf(stdout, "=============== PARSE TREE ===============\n");
     node_print_statement_list(stdout, parse_tree);
     return 0;
@@ -122,32 +890,443 @@ int main(int argc, char **argv) {
   }
   fprintf(stdout, "=============== PARSE TREE ===============\n");
   node_print_statement_list(stdout, parse_tree);
-  if (0 == strcmp("type", stage)) {
+  if (0 == strcmp("type", options->stage)) {
+    if (NULL != options->write_image) {
+      return compiler_check_image_output(image_write_tree(options->write_image, parse_tree, &symbol_table));
+    }
     return 0;
   }
 
-  error_count = ir_generate_for_statement_list(parse_tree);
-  if (error_count > 0) {
-    print_errors_from_pass("IR generation", error_count);
+  return compiler_run_from_tree(parse_tree, false, options, wrote_output);
+}
+
+/* Record a flag that changes the output of the compiler in flags. */
+static void compiler_add_flag(char *flags, size_t size, int opt, char const *arg) {
+  size_t length = strlen(flags);
+  snprintf(flags + length, size - length, "-%c%s ", opt, NULL == arg ? "" : arg);
+}
+
+static void compiler_destroy_profile(struct compiler_options *options) {
+  if (NULL != options->profile) {
+    profile_destroy(options->profile);
+    free(options->profile);
+    options->profile = NULL;
+  }
+}
+
+/*
+ * compiler_open_input - open the input file named on the command line, or
+ * stdin when none is
+ *
+ * A worker of a compile server reads the source its client sent instead.
+ * Prints an error and returns false when there is more than one input file
+ * or it cannot be opened.
+ */
+static bool compiler_open_input(int argc, char **argv, char const *source, size_t length, FILE **input) {
+  if (optind < argc - 1) {
+    fprintf(stdout, "Expected 1 input file, found %d.\n", argc - optind);
+    return false;
+  }
+
+  if (NULL != source) {
+    *input = fmemopen((void *)source, length, "r");
+    assert(NULL != *input);
+  } else if (optind >= argc) {
+    *input = stdin;
+  } else {
+    *input = fopen(argv[optind], "r");
+    if (NULL == *input) {
+      fprintf(stdout, "Could not open input file %s: %s\n", argv[optind], strerror(errno));
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * compiler_send - run the compile on the compile server listening on path
+ *
+ * The input is read here and sent along, so that the server need not be
+ * able to read stdin. Compiles that resume from an image or disassemble an
+ * object have no input.
+ */
+static int compiler_send(char const *path, int argc, char **argv, struct compiler_options *options) {
+  FILE *input;
+  char *source = NULL;
+  size_t length = 0;
+  int status;
+
+  if (NULL == options->read_image && NULL == options->disassemble) {
+    if (!compiler_open_input(argc, argv, NULL, 0, &input)) {
+      return 1;
+    }
+    source = compiler_read_input(input, &length);
+  }
+  status = server_send(path, argc, argv, source, length, options->print_statistics);
+  free(source);
+  return status;
+}
+
+/**
+ * Launches the compiler.
+ * 
+ * The following describes the arguments to the program:
+ * compiler [-s (scanner|parser|flat|symbol|type|ir|mips)] [-o outputfile]
+ *          [-T (mips|x86-64)] [-O level] [-w imagefile] [-f feature] [-c cachedir [-C cachesize] [-S]]
+ *          [-R socket] [-r imagefile | inputfile | stdin | -d objectfile]
+ * compiler -L socket [-j workers]
+ *
+ * -s : the name of the stage to stop after. Defaults to
+ *      runs all of the stages. The flat stage prints the parse tree from
+ *      its flattened, struct-of-arrays form.
+ * -o : the name of the output file. Defaults to "output.s"      
+ * -T : the machine to write assembly for. Defaults to mips, for spim.
+ *      x86-64 writes GNU assembler text for x86-64 Linux, whose main can be
+ *      linked with gcc and run natively, and -S prints how its temporaries
+ *      were allocated registers. The code is always printed from the IR,
+ *      the profile-generate counts are written to x86.profile by default,
+ *      compact changes nothing, and objects cannot be written. The last
+ *      stage is still called mips. Any other name is an error.
+ * -O : the optimization level. Defaults to 0, which optimizes nothing, and
+ *      prints the code straight from the typed parse tree in one pass,
+ *      without generating IR or printing the ir stage dump.
+ *        1 - simplify the typed parse tree before generating IR: fold
+ *            constants, merge the constants of + and * chains, and drop
+ *            identities such as x + 0 and x * 1.
+ *            Then follow the range of values each temporary can hold
+ *            through the IR, and drop the zero check of every divide by
+ *            something that cannot be zero, or turn the divide into a
+ *            shift or a constant when the ranges allow.
+ *        2 - also rebalance long chains of + and * so their terms can be
+ *            computed in parallel, keeping no more than eight values live
+ *            at once.
+ * -w : write a binary image of the compiler state after the last stage.
+ *      Only the type stage (the typed parse tree and symbol table) and the
+ *      ir stage (the IR instructions) can be written.
+ * -r : resume the compiler from an image written with -w instead of
+ *      compiling source. The stages after the one that wrote the image run.
+ * -f : enable a feature of the compiler. The features are:
+ *        stream - run every stage a statement at a time as the statements
+ *                 are parsed, freeing each one once its code is written.
+ *                 Memory use stays flat however long the program is. Only
+ *                 the output file is written, without stage dumps.
+ *        pipeline - stream, with the scanner and parser on one thread and
+ *                   the stages after them on another. The output is the
+ *                   same as with stream.
+ *        incremental - stream, keeping the statements for the next
+ *                  incremental compile with the same flags, which only
+ *                  scans and parses the statements edited since, and runs
+ *                  the stages after parsing from the first of them. The
+ *                  statements are kept by the worker of a compile server
+ *                  that ran the compile, so this only saves work with -R.
+ *                  The statements keep their IR, so the output is the
+ *                  same as with stream and through-ir, and -S prints how
+ *                  many statements were reused.
+ *        through-ir - at -O0, generate IR and print the code from it, as
+ *                  the other levels do, instead of printing it from the
+ *                  tree. The program computes the same either way.
+ *        compact - write the assembly without padding its fields into
+ *                  columns, which makes it about half the size.
+ *        elf-big, elf-little - write the output file as a big- or
+ *                  little-endian ELF32 MIPS relocatable object instead of
+ *                  assembly. The stage dumps are still assembly.
+ *        profile-generate[=file] - count how many times each statement
+ *                  runs, and write the counts to file (mips.profile by
+ *                  default) when the program ends. Objects cannot count.
+ *        profile-use=file - read the counts written by a profile-generate
+ *                  build of the same program. At -O2 the chains of the
+ *                  statements that ran most may keep sixteen values live
+ *                  at once, and those of statements that never ran are
+ *                  left unbalanced. Compiles with a profile bypass the cache.
+ * -c : the directory of the compile cache. When given, a compile whose
+ *      input and flags match an earlier one by the same build of the
+ *      compiler replays the earlier stage dumps and output file instead of
+ *      running the stages. Compiles that read or write images bypass the
+ *      cache.
+ * -C : the size limit of the compile cache in bytes. Least recently used
+ *      entries are evicted beyond it. Defaults to 64MB.
+ * -d : print the object file written by -felf-big or -felf-little as
+ *      assembly and exit. Objects are always encoded from the IR, so it
+ *      matches the output file of the same compile with through-ir in
+ *      place of the feature, and the object can be checked with diff. At
+ *      -O0 the output without through-ir is printed from the tree instead.
+ * -S : print statistics to stderr: cache hits and misses, the memory
+ *      used per node by the flat stage, the temporaries live at once
+ *      in the code for each statement, and how full the queue of a
+ *      pipelined compile ran.
+ * -L : run a compile server on the Unix domain socket socket until it is
+ *      interrupted. Compiles sent to it with -R run in worker processes that
+ *      stay warm between compiles. On SIGUSR1, and when it stops, the server
+ *      prints the percentiles of the time it took to answer each compile to
+ *      stderr.
+ * -j : the number of workers of a compile server, which is how many compiles
+ *      it runs at once. Defaults to the number of processors, and at least 2.
+ * -R : have the compile server on socket run the compile. The output and
+ *      exit status are those of the same compile run locally, and the paths
+ *      on the command line are relative to the current directory as usual.
+ *      With -S the time the compile took, round trip, is printed too.
+ *
+ * You should pass the name of the file to process or redirect stdin.
+ */
+static int compiler_main(int argc, char **argv, char const *source, size_t length) {
+  FILE *input;
+  struct cache cache;
+  struct compiler_options options;
+  char *cache_directory, *cache_source, *listen, *remote, flags[4096];
+  unsigned long cache_size;
+  bool wrote_output;
+  size_t cache_length;
+  int opt, status, workers;
+
+  strncpy(options.output_name, "output.s", NAME_MAX + 1);
+  options.stage = "mips";
+  options.target = &compiler_targets[0];
+  options.read_image = NULL;
+  options.write_image = NULL;
+  options.stream = false;
+  options.pipeline = false;
+  options.incremental = false;
+  options.through_ir = false;
+  options.compact = false;
+  options.object = false;
+  options.big_endian = true;
+  options.disassemble = NULL;
+  options.optimization = 0;
+  options.profile_generate = false;
+  options.profile_use = NULL;
+  options.profile = NULL;
+  flags[0] = '\0';
+  options.flags = flags;
+  cache_directory = NULL;
+  cache_size = CACHE_DEFAULT_MAX_SIZE;
+  options.print_statistics = false;
+  listen = remote = NULL;
+  workers = 0;
+  while (-1 != (opt = getopt(argc, argv, "o:s:T:O:r:w:f:c:C:Sd:L:R:j:"))) {
+    switch (opt) {
+      case 'o':
+        strncpy(options.output_name, optarg, NAME_MAX);
+        break;
+      case 's':
+        options.stage = optarg;
+        break;
+      case 'T':
+        options.target = compiler_find_target(optarg);
+        if (NULL == options.target) {
+          fprintf(stdout, "Unknown target %s.\n", optarg);
+          return 1;
+        }
+        break;
+      case 'O':
+        options.optimization = (int)strtoul(optarg, NULL, 10);
+        break;
+      case 'r':
+        options.read_image = optarg;
+        break;
+      case 'w':
+        options.write_image = optarg;
+        break;
+      case 'f':
+        if (0 == strcmp("stream", optarg)) {
+          options.stream = true;
+        } else if (0 == strcmp("pipeline", optarg)) {
+          options.stream = options.pipeline = true;
+        } else if (0 == strcmp("incremental", optarg)) {
+          options.stream = options.incremental = true;
+        } else if (0 == strcmp("compact", optarg)) {
+          options.compact = true;
+        } else if (0 == strcmp("elf-big", optarg) || 0 == strcmp("elf-little", optarg)) {
+          options.object = true;
+          options.big_endian = 0 == strcmp("elf-big", optarg);
+        } else if (0 == strcmp("through-ir", optarg)) {
+          options.through_ir = true;
+        } else if (0 == strcmp("profile-generate", optarg)) {
+          ir_set_profiling(true);
+          options.profile_generate = true;
+        } else if (0 == strncmp("profile-generate=", optarg, strlen("profile-generate="))) {
+          ir_set_profiling(true);
+          options.profile_generate = true;
+          mips_set_profile_name(optarg + strlen("profile-generate="));
+          x86_set_profile_name(optarg + strlen("profile-generate="));
+        } else if (0 == strncmp("profile-use=", optarg, strlen("profile-use="))) {
+          options.profile_use = optarg + strlen("profile-use=");
+        } else {
+          fprintf(stdout, "Unknown feature -f%s.\n", optarg);
+          return 1;
+        }
+        break;
+      case 'c':
+        cache_directory = optarg;
+        break;
+      case 'C':
+        cache_size = strtoul(optarg, NULL, 10);
+        break;
+      case 'S':
+        options.print_statistics = true;
+        break;
+      case 'd':
+        options.disassemble = optarg;
+        break;
+      case 'L':
+        listen = optarg;
+        break;
+      case 'R':
+        remote = optarg;
+        break;
+      case 'j':
+        workers = (int)strtoul(optarg, NULL, 10);
+        break;
+      case '?':
+        /* getopt has already printed the unknown option or missing argument. */
+        return 1;
+    }
+
+    /* Every flag that changes the output must be part of the cache key. */
+    if (NULL == strchr("ocCSLRj", opt)) {
+      compiler_add_flag(flags, sizeof(flags), opt, optarg);
+    }
+  }
+
+  if (compiler_server.serving) {
+    if (NULL != listen) {
+      fprintf(stdout, "A compile server cannot start another one.\n");
+      return 1;
+    }
+    compiler_server.print_statistics = options.print_statistics;
+    arena_use(options.stream ? NULL : &compiler_server.arena);
+  } else if (NULL != listen) {
+    return compiler_listen(listen, workers);
+  }
+
+  if (NULL != options.write_image
+      && 0 != strcmp("type", options.stage) && 0 != strcmp("ir", options.stage)) {
+    fprintf(stdout, "Images can only be written after the type or ir stage.\n");
     return 1;
   }
-  fprintf(stdout, "=================== IR ===================\n");
-  ir_print_section(stdout, parse_tree->ir);
-  if (0 == strcmp("ir", stage)) {
-    return 0;
+  if (options.object && &compiler_targets[0] != options.target) {
+    fprintf(stdout, "Objects can only be written for the mips target.\n");
+    return 1;
+  }
+  if (options.stream
+      && (0 != strcmp("mips", options.stage) || NULL != options.read_image || NULL != options.write_image)) {
+    fprintf(stdout, "Streaming compiles run every stage and cannot use images.\n");
+    return 1;
   }
 
-  fprintf(stdout, "================== MIPS ==================\n");
-  mips_print_program(stdout, parse_tree->ir);
-  fputs("\n\n", stdout);
+  /* The workers of a server ignore -R, since their client passes it on. */
+  if (NULL != remote && !compiler_server.serving) {
+    return compiler_send(remote, argc, argv, &options);
+  }
+  mips_set_layout(options.compact ? MIPS_LAYOUT_COMPACT : MIPS_LAYOUT_PADDED);
 
-  output = fopen(output_name, "w");
-  if (NULL == output) {
-    fprintf(stdout, "Could not open output file %s: %s", optarg, strerror(errno));
+  if (NULL != options.profile_use) {
+    options.profile = malloc(sizeof(struct profile));
+    assert(NULL != options.profile);
+    if (!profile_load(options.profile, options.profile_use)) {
+      free(options.profile);
+      return 1;
+    }
+  }
+
+  if (NULL != options.disassemble) {
+    struct emit_buffer output;
+
+    fflush(stdout);
+    emit_attach(&output, STDOUT_FILENO);
+    status = elf_disassemble(options.disassemble, &output);
+    emit_close(&output);
+    compiler_destroy_profile(&options);
+    return status;
+  }
+
+  /* Figure out whether we're using stdin/stdout or file in/file out. */
+  if (NULL != options.read_image) {
+    if (optind < argc) {
+      fprintf(stdout, "Expected no input file when resuming from an image, found %d.\n", argc - optind);
+      compiler_destroy_profile(&options);
+      return 1;
+    }
+    input = NULL;
+  } else if (!compiler_open_input(argc, argv, source, length, &input)) {
+    compiler_destroy_profile(&options);
     return 1;
   }
-  mips_print_program(output, parse_tree->ir);
-  fputs("\n\n", output);
 
-  return 0;
+  /* The cache key does not cover the contents of a profile. */
+  if (NULL == cache_directory || NULL != options.read_image || NULL != options.write_image
+      || NULL != options.profile) {
+    status = compiler_run(input, &options, &wrote_output);
+    if (NULL != input && stdin != input) {
+      fclose(input);
+    }
+    compiler_destroy_profile(&options);
+    return status;
+  }
+
+  cache_source = compiler_read_input(input, &cache_length);
+  cache_initialize(&cache, cache_directory, cache_size, flags, cache_source, cache_length);
+
+  if (!cache_lookup(&cache, options.output_name, &status)) {
+    input = fmemopen(cache_source, cache_length, "r");
+    assert(NULL != input);
+    if (cache_begin_capture(&cache)) {
+      status = compiler_run(input, &options, &wrote_output);
+      cache_end_capture(&cache, status, wrote_output ? options.output_name : NULL);
+    } else {
+      status = compiler_run(input, &options, &wrote_output);
+    }
+    fclose(input);
+  }
+
+  if (options.print_statistics) {
+    cache_print_statistics(stderr, &cache);
+  }
+  cache_destroy(&cache);
+  free(cache_source);
+  return status;
+}
+
+/*
+ * compiler_serve - run one compile in a worker of a compile server
+ *
+ * The state that a compile leaves behind in the modules is reset first, and
+ * the memory the compile allocated from the arena is freed after it.
+ */
+static int compiler_serve(int argc, char **argv, char const *source, size_t length) {
+  int status;
+
+  optind = 1;
+  ir_reset();
+  ir_set_profiling(false);
+  mips_set_profile_name(MIPS_PROFILE_DEFAULT_NAME);
+  x86_set_profile_name(X86_PROFILE_DEFAULT_NAME);
+  simplify_reset_statistics();
+  range_reset();
+  compiler_server.print_statistics = false;
+
+  status = compiler_main(argc, argv, NULL == source ? "" : source, length);
+
+  arena_use(NULL);
+  if (compiler_server.print_statistics) {
+    arena_print_statistics(stderr, &compiler_server.arena);
+  }
+  arena_reset(&compiler_server.arena);
+  return status;
+}
+
+static int compiler_listen(char const *path, int workers) {
+  long processors;
+
+  if (workers < 1) {
+    processors = sysconf(_SC_NPROCESSORS_ONLN);
+    workers = processors > 2 ? (int)processors : 2;
+  }
+  compiler_server.serving = true;
+  arena_initialize(&compiler_server.arena);
+  compiler_server.scanner = NULL;
+  return server_run(path, workers, compiler_serve);
+}
+
+int main(int argc, char **argv) {
+  return compiler_main(argc, argv, NULL, 0);
 }
@@ -1,6 +1,8 @@
 #ifndef _COMPILER_H
 #define _COMPILER_H
 
+#include <stdint.h>
+
 #define IDENTIFIER_MAX 31
 
 struct result {
@@ -8,11 +10,10 @@ struct result {
   struct ir_operand *ir_operand;
 };
 
+/* The text of a token or construct, as a byte offset into the source. See location.c. */
 typedef struct location {
-  int first_line;
-  int first_column;
-  int last_line;
-  int last_column;
+  uint32_t offset;
+  uint32_t length;
 } YYLTYPE;
 #define YYLTYPE struct location
 
@@ -0,0 +1,1125 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+
+#include "ir.h"
+#include "emit.h"
+#include "mips.h"
+#include "elf.h"
+
+/*
+ * Instead of printing assembly for an external assembler, the code can be
+ * encoded directly into an ELF32 MIPS relocatable object. The object holds
+ * the code in .text under the global symbol main, followed by the local
+ * routine print_number, and the print buffer in .data under print_length,
+ * followed by the temporaries area under temporaries. Every la of
+ * print_length and every access to the temporaries area has a pair of
+ * relocations, and every jal of print_number one.
+ *
+ * Each IR instruction becomes the machine instructions an assembler would
+ * expand its pseudo-instruction into, so the object runs exactly like the
+ * assembled text output:
+ *   li d, n       ori d, $0, n | addiu d, $0, n | lui d, %hi(n) [ori d, d, %lo(n)]
+ *   move d, s     or d, s, $0
+ *   mulu d, s, t  multu s, t; mflo d
+ *   divu d, s, t  bne t, $0, 1f; divu $0, s, t; break 7; 1: mflo d
+ *   divu s, t     divu $0, s, t, with no zero check
+ *   la $a1, print_length  lui $a1, %hi(print_length); addiu $a1, $a1, %lo(print_length)
+ *   lw d, temporaries+n   lui $at, %hi(temporaries+n); lw d, %lo(temporaries+n)($at)
+ *   sw s, temporaries+n   lui $at, %hi(temporaries+n); sw s, %lo(temporaries+n)($at)
+ *   jal print_number      jal print_number; nop
+ * Every branch and jump, including the jr $ra that ends the program, has a
+ * nop in its delay slot.
+ *
+ * elf_disassemble reverses the encoding and prints the object back as
+ * assembly, so an object can be checked with diff against the text output of
+ * the same compile through the IR, which -O0 prints only with through-ir.
+ */
+
+#define ELF_HEADER_SIZE           52
+#define ELF_SECTION_HEADER_SIZE   40
+#define ELF_SYMBOL_SIZE           16
+#define ELF_RELOCATION_SIZE        8
+
+#define ELF_TYPE_RELOCATABLE       1
+#define ELF_MACHINE_MIPS           8
+#define ELF_MIPS_NOREORDER         0x00000001
+#define ELF_MIPS_ABI_O32           0x00001000
+#define ELF_MIPS_ARCH_32           0x50000000
+
+#define ELF_SECTION_PROGBITS       1
+#define ELF_SECTION_SYMTAB         2
+#define ELF_SECTION_STRTAB         3
+#define ELF_SECTION_REL            9
+#define ELF_FLAG_WRITE             1
+#define ELF_FLAG_ALLOC             2
+#define ELF_FLAG_EXECINSTR         4
+
+#define ELF_SYMBOL_INFO(binding, type) ((binding) << 4 | (type))
+#define ELF_BINDING_LOCAL          0
+#define ELF_BINDING_GLOBAL         1
+#define ELF_SYMBOL_OBJECT          1
+#define ELF_SYMBOL_FUNCTION        2
+#define ELF_SYMBOL_SECTION         3
+
+#define ELF_RELOCATION_INFO(symbol, type) ((uint32_t)(symbol) << 8 | (type))
+#define ELF_MIPS_26                4
+#define ELF_MIPS_HI16              5
+#define ELF_MIPS_LO16              6
+
+enum elf_section_index {
+  ELF_NULL_SECTION,
+  ELF_TEXT_SECTION,
+  ELF_REL_TEXT_SECTION,
+  ELF_DATA_SECTION,
+  ELF_SYMTAB_SECTION,
+  ELF_STRTAB_SECTION,
+  ELF_SHSTRTAB_SECTION,
+  ELF_SECTION_COUNT
+};
+
+static char const *elf_section_names[ELF_SECTION_COUNT] = {
+  "", ".text", ".rel.text", ".data", ".symtab", ".strtab", ".shstrtab"
+};
+
+enum elf_symbol_index {
+  ELF_NULL_SYMBOL,
+  ELF_TEXT_SYMBOL,
+  ELF_DATA_SYMBOL,
+  ELF_PRINT_LENGTH_SYMBOL,
+  ELF_PRINT_NUMBER_SYMBOL,
+  ELF_TEMPORARIES_SYMBOL,
+  ELF_MAIN_SYMBOL,
+  ELF_SYMBOL_COUNT
+};
+
+/* The symbol names, at offsets 1, 14, 27 and 32 of the string table. */
+static char const elf_symbol_names[] = "\0print_length\0print_number\0main\0temporaries";
+#define ELF_PRINT_LENGTH_NAME  1
+#define ELF_PRINT_NUMBER_NAME 14
+#define ELF_MAIN_NAME         27
+#define ELF_TEMPORARIES_NAME  32
+
+/* .data is the length of the print buffer, then the buffer, then the temporaries area. */
+#define ELF_DATA_SIZE (4 + MIPS_PRINT_BUFFER_SIZE)
+
+/* Instruction fields. */
+#define MIPS_SPECIAL   0x00
+#define MIPS_REGIMM    0x01
+#define MIPS_BGEZ      0x01
+#define MIPS_SLL       0x00
+#define MIPS_SRL       0x02
+#define MIPS_SLLV      0x04
+#define MIPS_SRLV      0x06
+#define MIPS_JAL       0x03
+#define MIPS_BNE       0x05
+#define MIPS_ADDIU     0x09
+#define MIPS_SLTIU     0x0b
+#define MIPS_ORI       0x0d
+#define MIPS_LUI       0x0f
+#define MIPS_LW        0x23
+#define MIPS_SB        0x28
+#define MIPS_SW        0x2b
+#define MIPS_JR        0x08
+#define MIPS_SYSCALL   0x0c
+#define MIPS_BREAK     0x0d
+#define MIPS_MFHI      0x10
+#define MIPS_MFLO      0x12
+#define MIPS_MULTU     0x19
+#define MIPS_DIVU      0x1b
+#define MIPS_ADDU      0x21
+#define MIPS_SUBU      0x23
+#define MIPS_AND       0x24
+#define MIPS_OR        0x25
+#define MIPS_XOR       0x26
+
+#define MIPS_AT  1
+#define MIPS_V0  2
+#define MIPS_V1  3
+#define MIPS_A0  4
+#define MIPS_A1  5
+#define MIPS_A2  6
+#define MIPS_A3  7
+#define MIPS_SP 29
+#define MIPS_RA 31
+
+#define MIPS_R_TYPE(rs, rt, rd, function) \
+  ((uint32_t)(rs) << 21 | (uint32_t)(rt) << 16 | (uint32_t)(rd) << 11 | (function))
+#define MIPS_SHIFT_TYPE(rt, rd, shift, function) \
+  ((uint32_t)(rt) << 16 | (uint32_t)(rd) << 11 | ((uint32_t)(shift) & 0x1f) << 6 | (function))
+#define MIPS_I_TYPE(opcode, rs, rt, immediate) \
+  ((uint32_t)(opcode) << 26 | (uint32_t)(rs) << 21 | (uint32_t)(rt) << 16 | ((immediate) & 0xffff))
+#define MIPS_J_TYPE(opcode, target) ((uint32_t)(opcode) << 26 | ((target) & 0x3ffffff))
+
+#define MIPS_OPCODE(word)    ((word) >> 26)
+#define MIPS_RS(word)        ((word) >> 21 & 0x1f)
+#define MIPS_RT(word)        ((word) >> 16 & 0x1f)
+#define MIPS_RD(word)        ((word) >> 11 & 0x1f)
+#define MIPS_SHIFT(word)     ((word) >> 6 & 0x1f)
+#define MIPS_FUNCTION(word)  ((word) & 0x3f)
+#define MIPS_IMMEDIATE(word) ((word) & 0xffff)
+
+#define MIPS_BREAK_7 (7u << 16 | MIPS_BREAK)
+#define MIPS_NOP     0u
+
+static void elf_put16(uint8_t *bytes, uint32_t value, bool big_endian) {
+  if (big_endian) {
+    bytes[0] = (uint8_t)(value >> 8);
+    bytes[1] = (uint8_t)value;
+  } else {
+    bytes[0] = (uint8_t)value;
+    bytes[1] = (uint8_t)(value >> 8);
+  }
+}
+
+static void elf_put32(uint8_t *bytes, uint32_t value, bool big_endian) {
+  if (big_endian) {
+    elf_put16(bytes, value >> 16, true);
+    elf_put16(bytes + 2, value & 0xffff, true);
+  } else {
+    elf_put16(bytes, value & 0xffff, false);
+    elf_put16(bytes + 2, value >> 16, false);
+  }
+}
+
+static uint32_t elf_get16(uint8_t const *bytes, bool big_endian) {
+  return big_endian ? (uint32_t)bytes[0] << 8 | bytes[1] : (uint32_t)bytes[1] << 8 | bytes[0];
+}
+
+static uint32_t elf_get32(uint8_t const *bytes, bool big_endian) {
+  return big_endian
+    ? elf_get16(bytes, true) << 16 | elf_get16(bytes + 2, true)
+    : elf_get16(bytes + 2, false) << 16 | elf_get16(bytes, false);
+}
+
+
+/*******************
+ * ENCODE THE CODE *
+ *******************/
+
+static void elf_add_word(struct elf_object *object, uint32_t word) {
+  if (object->text_length + 4 > object->text_capacity) {
+    object->text_capacity = object->text_capacity > 0 ? 2 * object->text_capacity : 4096;
+    object->text = realloc(object->text, object->text_capacity);
+    assert(NULL != object->text);
+  }
+  elf_put32(object->text + object->text_length, word, object->big_endian);
+  object->text_length += 4;
+}
+
+static void elf_add_relocation(struct elf_object *object, enum elf_symbol_index symbol, uint32_t type) {
+  struct elf_relocation *relocation;
+
+  if (object->relocation_count == object->relocation_capacity) {
+    object->relocation_capacity = object->relocation_capacity > 0 ? 2 * object->relocation_capacity : 256;
+    object->relocations = realloc(object->relocations,
+                                  object->relocation_capacity * sizeof(struct elf_relocation));
+    assert(NULL != object->relocations);
+  }
+  relocation = &object->relocations[object->relocation_count++];
+  relocation->offset = (uint32_t)object->text_length;
+  relocation->info = ELF_RELOCATION_INFO(symbol, type);
+}
+
+void elf_initialize(struct elf_object *object, bool big_endian) {
+  object->big_endian = big_endian;
+  object->text = NULL;
+  object->text_length = object->text_capacity = 0;
+  object->relocations = NULL;
+  object->relocation_count = object->relocation_capacity = 0;
+  object->temporary_words = 0;
+  object->error_count = 0;
+
+  /* Keep the return address of main on the stack, since print_number is called with jal. */
+  elf_add_word(object, MIPS_I_TYPE(MIPS_ADDIU, MIPS_SP, MIPS_SP, -4));
+  elf_add_word(object, MIPS_I_TYPE(MIPS_SW, MIPS_SP, MIPS_RA, 0));
+}
+
+void elf_destroy(struct elf_object *object) {
+  free(object->text);
+  free(object->relocations);
+}
+
+/* lw or sw reg, temporaries+n, for a temporary kept in memory. */
+static void elf_add_temporary_access(struct elf_object *object, uint32_t opcode, uint32_t reg, int temporary) {
+  unsigned long offset = MIPS_TEMPORARY_OFFSET(temporary);
+
+  if (offset / 4 >= object->temporary_words) {
+    object->temporary_words = offset / 4 + 1;
+  }
+  elf_add_relocation(object, ELF_TEMPORARIES_SYMBOL, ELF_MIPS_HI16);
+  elf_add_word(object, MIPS_I_TYPE(MIPS_LUI, 0, MIPS_AT, (offset + 0x8000) >> 16));
+  elf_add_relocation(object, ELF_TEMPORARIES_SYMBOL, ELF_MIPS_LO16);
+  elf_add_word(object, MIPS_I_TYPE(opcode, MIPS_AT, reg, offset));
+}
+
+static void elf_add_load_immediate(struct elf_object *object, uint32_t target, unsigned long number) {
+  uint32_t value = (uint32_t)number;
+
+  if (number > 0xffffffff) {
+    if (0 == object->error_count) {
+      fprintf(stdout, "Could not encode %lu: it does not fit in 32 bits.\n", number);
+    }
+    object->error_count++;
+  }
+
+  if (value <= 0xffff) {
+    elf_add_word(object, MIPS_I_TYPE(MIPS_ORI, 0, target, value));
+  } else if (value >= 0xffff8000) {
+    elf_add_word(object, MIPS_I_TYPE(MIPS_ADDIU, 0, target, value));
+  } else {
+    elf_add_word(object, MIPS_I_TYPE(MIPS_LUI, 0, target, value >> 16));
+    if (0 != (value & 0xffff)) {
+      elf_add_word(object, MIPS_I_TYPE(MIPS_ORI, target, target, value));
+    }
+  }
+}
+
+static void elf_add_instruction(struct elf_object *object, struct ir_instruction *instruction) {
+  struct mips_registers registers;
+  uint32_t target, left, right;
+  int i;
+
+  mips_assign_registers(instruction, &registers);
+  for (i = 0; i < registers.load_count; i++) {
+    elf_add_temporary_access(object, MIPS_LW, MIPS_SCRATCH_REGISTER + (uint32_t)i, registers.loads[i]);
+  }
+  target = (uint32_t)registers.operands[0];
+  left = (uint32_t)registers.operands[1];
+  right = (uint32_t)registers.operands[2];
+  switch (instruction->kind) {
+    case IR_MULTIPLY:
+    case IR_DIVIDE:
+    case IR_DIVIDE_NONZERO:
+    case IR_ADD:
+    case IR_SUBTRACT:
+      if (IR_MULTIPLY == instruction->kind) {
+        elf_add_word(object, MIPS_R_TYPE(left, right, 0, MIPS_MULTU));
+        elf_add_word(object, MIPS_R_TYPE(0, 0, target, MIPS_MFLO));
+      } else if (IR_DIVIDE_NONZERO == instruction->kind) {
+        elf_add_word(object, MIPS_R_TYPE(left, right, 0, MIPS_DIVU));
+        elf_add_word(object, MIPS_R_TYPE(0, 0, target, MIPS_MFLO));
+      } else if (IR_DIVIDE == instruction->kind) {
+        elf_add_word(object, MIPS_I_TYPE(MIPS_BNE, right, 0, 2));
+        elf_add_word(object, MIPS_R_TYPE(left, right, 0, MIPS_DIVU));
+        elf_add_word(object, MIPS_BREAK_7);
+        elf_add_word(object, MIPS_R_TYPE(0, 0, target, MIPS_MFLO));
+      } else {
+        elf_add_word(object, MIPS_R_TYPE(left, right, target, IR_ADD == instruction->kind ? MIPS_ADDU : MIPS_SUBU));
+      }
+      break;
+
+    case IR_AND:
+    case IR_XOR:
+    case IR_OR:
+      elf_add_word(object, MIPS_R_TYPE(left, right, target,
+                                       IR_AND == instruction->kind ? MIPS_AND
+                                       : IR_XOR == instruction->kind ? MIPS_XOR : MIPS_OR));
+      break;
+
+    case IR_SHIFT_LEFT:
+    case IR_SHIFT_RIGHT:
+      /* The amount goes in rs and the value in rt. */
+      elf_add_word(object, MIPS_R_TYPE(right, left, target, IR_SHIFT_LEFT == instruction->kind ? MIPS_SLLV : MIPS_SRLV));
+      break;
+
+    case IR_SHIFT_LEFT_IMMEDIATE:
+    case IR_SHIFT_RIGHT_IMMEDIATE:
+      assert(OPERAND_NUMBER == instruction->operands[2].kind);
+      elf_add_word(object, MIPS_SHIFT_TYPE(left, target, instruction->operands[2].data.number,
+                                           IR_SHIFT_LEFT_IMMEDIATE == instruction->kind ? MIPS_SLL : MIPS_SRL));
+      break;
+
+    case IR_ADD_IMMEDIATE:
+      assert(OPERAND_NUMBER == instruction->operands[2].kind);
+      elf_add_word(object, MIPS_I_TYPE(MIPS_ADDIU, left, target, instruction->operands[2].data.number));
+      break;
+
+    case IR_COPY:
+      elf_add_word(object, MIPS_R_TYPE(left, 0, target, MIPS_OR));
+      break;
+
+    case IR_LOAD_IMMEDIATE:
+      assert(OPERAND_NUMBER == instruction->operands[1].kind);
+      elf_add_load_immediate(object, target, instruction->operands[1].data.number);
+      break;
+
+    case IR_PRINT_NUMBER:
+      elf_add_word(object, MIPS_R_TYPE(0, target, MIPS_A0, MIPS_OR));
+      elf_add_relocation(object, ELF_PRINT_NUMBER_SYMBOL, ELF_MIPS_26);
+      elf_add_word(object, MIPS_J_TYPE(MIPS_JAL, 0));
+      elf_add_word(object, MIPS_NOP);
+      break;
+
+    case IR_PROFILE_COUNT:
+      if (0 == object->error_count) {
+        fprintf(stdout, "Could not encode a profile counter: objects cannot count statements.\n");
+      }
+      object->error_count++;
+      break;
+
+    case IR_NO_OPERATION:
+      break;
+
+    default:
+      assert(0);
+      break;
+  }
+
+  if (registers.store >= 0) {
+    elf_add_temporary_access(object, MIPS_SW, target, registers.store);
+  }
+}
+
+/* la $a1, print_length */
+static void elf_add_print_length_address(struct elf_object *object) {
+  elf_add_relocation(object, ELF_PRINT_LENGTH_SYMBOL, ELF_MIPS_HI16);
+  elf_add_word(object, MIPS_I_TYPE(MIPS_LUI, 0, MIPS_A1, 0));
+  elf_add_relocation(object, ELF_PRINT_LENGTH_SYMBOL, ELF_MIPS_LO16);
+  elf_add_word(object, MIPS_I_TYPE(MIPS_ADDIU, MIPS_A1, MIPS_A1, 0));
+}
+
+/*
+ * elf_add_ending - write out the print buffer, return from main and add
+ * print_number after it, as mips_print_epilogue does
+ *
+ * The branches of print_number count in words from the one after their delay
+ * slot. Returns the offset of print_number in .text.
+ */
+static uint32_t elf_add_ending(struct elf_object *object) {
+  uint32_t print_number;
+
+  elf_add_print_length_address(object);
+  elf_add_word(object, MIPS_I_TYPE(MIPS_LW, MIPS_A1, MIPS_A2, 0));
+  elf_add_word(object, MIPS_I_TYPE(MIPS_ORI, 0, MIPS_V0, 15));
+  elf_add_word(object, MIPS_I_TYPE(MIPS_ORI, 0, MIPS_A0, 1));
+  elf_add_word(object, MIPS_I_TYPE(MIPS_ADDIU, MIPS_A1, MIPS_A1, 4));
+  elf_add_word(object, MIPS_SYSCALL);
+  elf_add_word(object, MIPS_I_TYPE(MIPS_LW, MIPS_SP, MIPS_RA, 0));
+  elf_add_word(object, MIPS_I_TYPE(MIPS_ADDIU, MIPS_SP, MIPS_SP, 4));
+  elf_add_word(object, MIPS_R_TYPE(MIPS_RA, 0, 0, MIPS_JR));
+  elf_add_word(object, MIPS_NOP);
+
+  print_number = (uint32_t)object->text_length;
+  elf_add_print_length_address(object);
+  elf_add_word(object, MIPS_I_TYPE(MIPS_LW, MIPS_A1, MIPS_V1, 0));
+  elf_add_word(object, MIPS_I_TYPE(MIPS_SLTIU, MIPS_V1, MIPS_A2,
+                                   MIPS_PRINT_BUFFER_SIZE - MIPS_PRINT_MAX_LENGTH + 1));
+  elf_add_word(object, MIPS_I_TYPE(MIPS_BNE, MIPS_A2, 0, 10));
+  elf_add_word(object, MIPS_NOP);
+  elf_add_word(object, MIPS_R_TYPE(MIPS_A0, 0, MIPS_A3, MIPS_OR));
+  elf_add_word(object, MIPS_I_TYPE(MIPS_ORI, 0, MIPS_V0, 15));
+  elf_add_word(object, MIPS_I_TYPE(MIPS_ORI, 0, MIPS_A0, 1));
+  elf_add_word(object, MIPS_R_TYPE(MIPS_V1, 0, MIPS_A2, MIPS_OR));
+  elf_add_word(object, MIPS_I_TYPE(MIPS_ADDIU, MIPS_A1, MIPS_A1, 4));
+  elf_add_word(object, MIPS_SYSCALL);
+  elf_add_word(object, MIPS_I_TYPE(MIPS_ADDIU, MIPS_A1, MIPS_A1, -4));
+  elf_add_word(object, MIPS_R_TYPE(MIPS_A3, 0, MIPS_A0, MIPS_OR));
+  elf_add_word(object, MIPS_R_TYPE(0, 0, MIPS_V1, MIPS_OR));
+
+  /* print_sign: */
+  elf_add_word(object, MIPS_R_TYPE(MIPS_A1, MIPS_V1, MIPS_V1, MIPS_ADDU));
+  elf_add_word(object, MIPS_I_TYPE(MIPS_REGIMM, MIPS_A0, MIPS_BGEZ, 5));
+  elf_add_word(object, MIPS_NOP);
+  elf_add_word(object, MIPS_I_TYPE(MIPS_ORI, 0, MIPS_A2, '-'));
+  elf_add_word(object, MIPS_I_TYPE(MIPS_SB, MIPS_V1, MIPS_A2, 4));
+  elf_add_word(object, MIPS_I_TYPE(MIPS_ADDIU, MIPS_V1, MIPS_V1, 1));
+  elf_add_word(object, MIPS_R_TYPE(0, MIPS_A0, MIPS_A0, MIPS_SUBU));
+
+  /* print_digits: */
+  elf_add_word(object, MIPS_R_TYPE(MIPS_A0, 0, MIPS_A2, MIPS_OR));
+  elf_add_word(object, MIPS_I_TYPE(MIPS_ORI, 0, MIPS_A3, 10));
+
+  /* print_count: */
+  elf_add_word(object, MIPS_I_TYPE(MIPS_ADDIU, MIPS_V1, MIPS_V1, 1));
+  elf_add_word(object, MIPS_R_TYPE(MIPS_A2, MIPS_A3, 0, MIPS_DIVU));
+  elf_add_word(object, MIPS_R_TYPE(0, 0, MIPS_A2, MIPS_MFLO));
+  elf_add_word(object, MIPS_I_TYPE(MIPS_BNE, MIPS_A2, 0, -4));
+  elf_add_word(object, MIPS_NOP);
+  elf_add_word(object, MIPS_I_TYPE(MIPS_ORI, 0, MIPS_A2, '\n'));
+  elf_add_word(object, MIPS_I_TYPE(MIPS_SB, MIPS_V1, MIPS_A2, 4));
+  elf_add_word(object, MIPS_R_TYPE(MIPS_V1, MIPS_A1, MIPS_A2, MIPS_SUBU));
+  elf_add_word(object, MIPS_I_TYPE(MIPS_ADDIU, MIPS_A2, MIPS_A2, 1));
+  elf_add_word(object, MIPS_I_TYPE(MIPS_SW, MIPS_A1, MIPS_A2, 0));
+
+  /* print_digit: */
+  elf_add_word(object, MIPS_R_TYPE(MIPS_A0, MIPS_A3, 0, MIPS_DIVU));
+  elf_add_word(object, MIPS_R_TYPE(0, 0, MIPS_A2, MIPS_MFHI));
+  elf_add_word(object, MIPS_R_TYPE(0, 0, MIPS_A0, MIPS_MFLO));
+  elf_add_word(object, MIPS_I_TYPE(MIPS_ADDIU, MIPS_A2, MIPS_A2, '0'));
+  elf_add_word(object, MIPS_I_TYPE(MIPS_SB, MIPS_V1, MIPS_A2, 3));
+  elf_add_word(object, MIPS_I_TYPE(MIPS_ADDIU, MIPS_V1, MIPS_V1, -1));
+  elf_add_word(object, MIPS_I_TYPE(MIPS_BNE, MIPS_A0, 0, -7));
+  elf_add_word(object, MIPS_NOP);
+  elf_add_word(object, MIPS_R_TYPE(MIPS_RA, 0, 0, MIPS_JR));
+  elf_add_word(object, MIPS_NOP);
+  return print_number;
+}
+
+/*
+ * elf_add_section - encode the instructions of section at the end of .text
+ *
+ * Returns the number of instructions that could not be encoded.
+ */
+int elf_add_section(struct elf_object *object, struct ir_section *section) {
+  struct ir_instruction *instruction;
+  int error_count = object->error_count;
+
+  for (instruction = section->first; instruction != section->last->next; instruction = instruction->next) {
+    elf_add_instruction(object, instruction);
+  }
+  return object->error_count - error_count;
+}
+
+
+/********************
+ * WRITE THE OBJECT *
+ ********************/
+
+static void elf_emit16(struct emit_buffer *output, uint32_t value, bool big_endian) {
+  uint8_t bytes[2];
+  elf_put16(bytes, value, big_endian);
+  emit_bytes(output, (char *)bytes, sizeof(bytes));
+}
+
+static void elf_emit32(struct emit_buffer *output, uint32_t value, bool big_endian) {
+  uint8_t bytes[4];
+  elf_put32(bytes, value, big_endian);
+  emit_bytes(output, (char *)bytes, sizeof(bytes));
+}
+
+static void elf_emit_symbol(struct emit_buffer *output, bool big_endian, uint32_t name, uint32_t value,
+                            uint32_t size, uint8_t info, enum elf_section_index section) {
+  elf_emit32(output, name, big_endian);
+  elf_emit32(output, value, big_endian);
+  elf_emit32(output, size, big_endian);
+  emit_bytes(output, (char *)&info, 1);
+  emit_bytes(output, "", 1);
+  elf_emit16(output, section, big_endian);
+}
+
+static void elf_emit_section_header(struct emit_buffer *output, bool big_endian, uint32_t name, uint32_t type,
+                                    uint32_t flags, uint32_t offset, uint32_t size, uint32_t link,
+                                    uint32_t info, uint32_t alignment, uint32_t entry_size) {
+  elf_emit32(output, name, big_endian);
+  elf_emit32(output, type, big_endian);
+  elf_emit32(output, flags, big_endian);
+  elf_emit32(output, 0, big_endian);
+  elf_emit32(output, offset, big_endian);
+  elf_emit32(output, size, big_endian);
+  elf_emit32(output, link, big_endian);
+  elf_emit32(output, info, big_endian);
+  elf_emit32(output, alignment, big_endian);
+  elf_emit32(output, entry_size, big_endian);
+}
+
+/*
+ * elf_write - end the program and write the object to the file name
+ *
+ * The sections follow the ELF header in the order of their section headers,
+ * which come last. Returns false, with errno set, when the file could not be
+ * written.
+ */
+bool elf_write(struct elf_object *object, char const *name) {
+  static char const padding[4];
+  struct emit_buffer output;
+  bool big_endian = object->big_endian;
+  uint32_t offsets[ELF_SECTION_COUNT + 1], sizes[ELF_SECTION_COUNT], names[ELF_SECTION_COUNT];
+  uint32_t print_number;
+  uint8_t header[ELF_HEADER_SIZE];
+  size_t i;
+  int section;
+
+  print_number = elf_add_ending(object);
+
+  sizes[ELF_NULL_SECTION] = 0;
+  sizes[ELF_TEXT_SECTION] = (uint32_t)object->text_length;
+  sizes[ELF_REL_TEXT_SECTION] = (uint32_t)(object->relocation_count * ELF_RELOCATION_SIZE);
+  sizes[ELF_DATA_SECTION] = (uint32_t)(ELF_DATA_SIZE + 4 * object->temporary_words);
+  sizes[ELF_SYMTAB_SECTION] = ELF_SYMBOL_COUNT * ELF_SYMBOL_SIZE;
+  sizes[ELF_STRTAB_SECTION] = sizeof(elf_symbol_names);
+  sizes[ELF_SHSTRTAB_SECTION] = 0;
+  for (section = 0; section < ELF_SECTION_COUNT; section++) {
+    names[section] = sizes[ELF_SHSTRTAB_SECTION];
+    sizes[ELF_SHSTRTAB_SECTION] += (uint32_t)strlen(elf_section_names[section]) + 1;
+  }
+
+  /* Every section, and the section headers, start on a word boundary. */
+  offsets[ELF_NULL_SECTION] = 0;
+  offsets[ELF_TEXT_SECTION] = ELF_HEADER_SIZE;
+  for (section = ELF_TEXT_SECTION + 1; section <= ELF_SECTION_COUNT; section++) {
+    offsets[section] = (offsets[section - 1] + sizes[section - 1] + 3) & ~3u;
+  }
+
+  if (!emit_open(&output, name)) {
+    return false;
+  }
+
+  memset(header, 0, sizeof(header));
+  memcpy(header, "\177ELF", 4);
+  header[4] = 1;
+  header[5] = big_endian ? 2 : 1;
+  header[6] = 1;
+  elf_put16(header + 16, ELF_TYPE_RELOCATABLE, big_endian);
+  elf_put16(header + 18, ELF_MACHINE_MIPS, big_endian);
+  elf_put32(header + 20, 1, big_endian);
+  elf_put32(header + 32, offsets[ELF_SECTION_COUNT], big_endian);
+  elf_put32(header + 36, ELF_MIPS_NOREORDER | ELF_MIPS_ABI_O32 | ELF_MIPS_ARCH_32, big_endian);
+  elf_put16(header + 40, ELF_HEADER_SIZE, big_endian);
+  elf_put16(header + 46, ELF_SECTION_HEADER_SIZE, big_endian);
+  elf_put16(header + 48, ELF_SECTION_COUNT, big_endian);
+  elf_put16(header + 50, ELF_SHSTRTAB_SECTION, big_endian);
+  emit_bytes(&output, (char *)header, sizeof(header));
+
+  emit_bytes(&output, (char *)object->text, object->text_length);
+
+  for (i = 0; i < object->relocation_count; i++) {
+    elf_emit32(&output, object->relocations[i].offset, big_endian);
+    elf_emit32(&output, object->relocations[i].info, big_endian);
+  }
+
+  for (i = 0; i < sizes[ELF_DATA_SECTION]; i += sizeof(padding)) {
+    emit_bytes(&output, padding, sizeof(padding));
+  }
+
+  elf_emit_symbol(&output, big_endian, 0, 0, 0, 0, ELF_NULL_SECTION);
+  elf_emit_symbol(&output, big_endian, 0, 0, 0, ELF_SYMBOL_INFO(ELF_BINDING_LOCAL, ELF_SYMBOL_SECTION),
+                  ELF_TEXT_SECTION);
+  elf_emit_symbol(&output, big_endian, 0, 0, 0, ELF_SYMBOL_INFO(ELF_BINDING_LOCAL, ELF_SYMBOL_SECTION),
+                  ELF_DATA_SECTION);
+  elf_emit_symbol(&output, big_endian, ELF_PRINT_LENGTH_NAME, 0, ELF_DATA_SIZE,
+                  ELF_SYMBOL_INFO(ELF_BINDING_LOCAL, ELF_SYMBOL_OBJECT), ELF_DATA_SECTION);
+  elf_emit_symbol(&output, big_endian, ELF_PRINT_NUMBER_NAME, print_number,
+                  (uint32_t)object->text_length - print_number,
+                  ELF_SYMBOL_INFO(ELF_BINDING_LOCAL, ELF_SYMBOL_FUNCTION), ELF_TEXT_SECTION);
+  elf_emit_symbol(&output, big_endian, ELF_TEMPORARIES_NAME, ELF_DATA_SIZE,
+                  sizes[ELF_DATA_SECTION] - ELF_DATA_SIZE,
+                  ELF_SYMBOL_INFO(ELF_BINDING_LOCAL, ELF_SYMBOL_OBJECT), ELF_DATA_SECTION);
+  elf_emit_symbol(&output, big_endian, ELF_MAIN_NAME, 0, print_number,
+                  ELF_SYMBOL_INFO(ELF_BINDING_GLOBAL, ELF_SYMBOL_FUNCTION), ELF_TEXT_SECTION);
+
+  emit_bytes(&output, elf_symbol_names, sizeof(elf_symbol_names));
+  emit_bytes(&output, padding, offsets[ELF_SHSTRTAB_SECTION] - offsets[ELF_STRTAB_SECTION] - sizeof(elf_symbol_names));
+
+  for (section = 0; section < ELF_SECTION_COUNT; section++) {
+    emit_bytes(&output, elf_section_names[section], strlen(elf_section_names[section]) + 1);
+  }
+  emit_bytes(&output, padding,
+             offsets[ELF_SECTION_COUNT] - offsets[ELF_SHSTRTAB_SECTION] - sizes[ELF_SHSTRTAB_SECTION]);
+
+  elf_emit_section_header(&output, big_endian, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+  elf_emit_section_header(&output, big_endian, names[ELF_TEXT_SECTION], ELF_SECTION_PROGBITS,
+                          ELF_FLAG_ALLOC | ELF_FLAG_EXECINSTR, offsets[ELF_TEXT_SECTION],
+                          sizes[ELF_TEXT_SECTION], 0, 0, 4, 0);
+  elf_emit_section_header(&output, big_endian, names[ELF_REL_TEXT_SECTION], ELF_SECTION_REL, 0,
+                          offsets[ELF_REL_TEXT_SECTION], sizes[ELF_REL_TEXT_SECTION], ELF_SYMTAB_SECTION,
+                          ELF_TEXT_SECTION, 4, ELF_RELOCATION_SIZE);
+  elf_emit_section_header(&output, big_endian, names[ELF_DATA_SECTION], ELF_SECTION_PROGBITS,
+                          ELF_FLAG_ALLOC | ELF_FLAG_WRITE, offsets[ELF_DATA_SECTION],
+                          sizes[ELF_DATA_SECTION], 0, 0, 4, 0);
+  elf_emit_section_header(&output, big_endian, names[ELF_SYMTAB_SECTION], ELF_SECTION_SYMTAB, 0,
+                          offsets[ELF_SYMTAB_SECTION], sizes[ELF_SYMTAB_SECTION], ELF_STRTAB_SECTION,
+                          ELF_MAIN_SYMBOL, 4, ELF_SYMBOL_SIZE);
+  elf_emit_section_header(&output, big_endian, names[ELF_STRTAB_SECTION], ELF_SECTION_STRTAB, 0,
+                          offsets[ELF_STRTAB_SECTION], sizes[ELF_STRTAB_SECTION], 0, 0, 1, 0);
+  elf_emit_section_header(&output, big_endian, names[ELF_SHSTRTAB_SECTION], ELF_SECTION_STRTAB, 0,
+                          offsets[ELF_SHSTRTAB_SECTION], sizes[ELF_SHSTRTAB_SECTION], 0, 0, 1, 0);
+
+  return emit_close(&output);
+}
+
+
+/*************************
+ * DISASSEMBLE AN OBJECT *
+ *************************/
+
+struct elf_reader {
+  uint8_t *bytes;
+  size_t size;
+  bool big_endian;
+  char const *error;
+
+  /* The section headers, and the sections the code is read from. */
+  uint8_t const *sections;
+  uint32_t section_count;
+  uint8_t const *text;
+  uint32_t text_length;
+  uint8_t const *relocations;
+  uint32_t relocation_count;
+  uint8_t const *symbols;
+  uint32_t symbol_count;
+  char const *symbol_names;
+  uint32_t symbol_names_size;
+
+  /* The next relocation to match and the instructions decoded so far. */
+  uint32_t next_relocation;
+  struct ir_instruction *instructions;
+  size_t instruction_count;
+  size_t instruction_capacity;
+
+  /*
+   * The temporaries in memory loaded into $v0 and $v1 for the next
+   * instruction, or -1, and the register the last one set that still has to
+   * be stored, or 0.
+   */
+  int loaded[2];
+  uint32_t unstored;
+};
+
+static uint8_t const *elf_section_header(struct elf_reader *reader, uint32_t index) {
+  return reader->sections + (size_t)index * ELF_SECTION_HEADER_SIZE;
+}
+
+/* The contents of section index, or NULL when they lie outside the file. */
+static uint8_t const *elf_section_contents(struct elf_reader *reader, uint32_t index, uint32_t *size) {
+  uint8_t const *header;
+  uint32_t offset;
+
+  if (index >= reader->section_count) {
+    return NULL;
+  }
+  header = elf_section_header(reader, index);
+  offset = elf_get32(header + 16, reader->big_endian);
+  *size = elf_get32(header + 20, reader->big_endian);
+  if (offset > reader->size || *size > reader->size - offset) {
+    return NULL;
+  }
+  return reader->bytes + offset;
+}
+
+static bool elf_read_sections(struct elf_reader *reader) {
+  uint32_t section_offset, names_size, size, i, symtab;
+  uint8_t const *header;
+  char const *names;
+
+  if (reader->size < ELF_HEADER_SIZE || 0 != memcmp(reader->bytes, "\177ELF", 4)
+      || 1 != reader->bytes[4] || (1 != reader->bytes[5] && 2 != reader->bytes[5])) {
+    reader->error = "not an ELF32 file";
+    return false;
+  }
+  reader->big_endian = 2 == reader->bytes[5];
+  if (ELF_TYPE_RELOCATABLE != elf_get16(reader->bytes + 16, reader->big_endian)
+      || ELF_MACHINE_MIPS != elf_get16(reader->bytes + 18, reader->big_endian)) {
+    reader->error = "not a MIPS relocatable object";
+    return false;
+  }
+
+  section_offset = elf_get32(reader->bytes + 32, reader->big_endian);
+  reader->section_count = elf_get16(reader->bytes + 48, reader->big_endian);
+  if (ELF_SECTION_HEADER_SIZE != elf_get16(reader->bytes + 46, reader->big_endian)
+      || section_offset > reader->size
+      || (size_t)reader->section_count * ELF_SECTION_HEADER_SIZE > reader->size - section_offset) {
+    reader->error = "the section headers are damaged";
+    return false;
+  }
+  reader->sections = reader->bytes + section_offset;
+
+  names = (char const *)elf_section_contents(reader, elf_get16(reader->bytes + 50, reader->big_endian),
+                                             &names_size);
+  if (NULL == names || 0 == names_size || '\0' != names[names_size - 1]) {
+    reader->error = "the section names are damaged";
+    return false;
+  }
+
+  for (i = 0; i < reader->section_count; i++) {
+    header = elf_section_header(reader, i);
+    if (elf_get32(header, reader->big_endian) >= names_size) {
+      continue;
+    }
+    if (0 == strcmp(".text", names + elf_get32(header, reader->big_endian))) {
+      reader->text = elf_section_contents(reader, i, &reader->text_length);
+    } else if (0 == strcmp(".rel.text", names + elf_get32(header, reader->big_endian))) {
+      reader->relocations = elf_section_contents(reader, i, &size);
+      reader->relocation_count = size / ELF_RELOCATION_SIZE;
+      symtab = elf_get32(header + 24, reader->big_endian);
+      reader->symbols = elf_section_contents(reader, symtab, &size);
+      reader->symbol_count = size / ELF_SYMBOL_SIZE;
+      if (NULL != reader->symbols) {
+        reader->symbol_names = (char const *)elf_section_contents(
+          reader, elf_get32(elf_section_header(reader, symtab) + 24, reader->big_endian),
+          &reader->symbol_names_size);
+      }
+    }
+  }
+  if (NULL == reader->text || NULL == reader->relocations || NULL == reader->symbols
+      || NULL == reader->symbol_names || 0 == reader->symbol_names_size
+      || '\0' != reader->symbol_names[reader->symbol_names_size - 1]) {
+    reader->error = "the .text, .rel.text or symbol sections are missing or damaged";
+    return false;
+  }
+  return true;
+}
+
+static uint32_t elf_word(struct elf_reader *reader, uint32_t index) {
+  return elf_get32(reader->text + 4 * (size_t)index, reader->big_endian);
+}
+
+/* Whether the next relocation is of type against the symbol named symbol_name at word index. */
+static bool elf_match_relocation(struct elf_reader *reader, uint32_t index, uint32_t type,
+                                 char const *symbol_name) {
+  uint8_t const *relocation;
+  uint32_t info, symbol, name;
+
+  if (reader->next_relocation >= reader->relocation_count) {
+    return false;
+  }
+  relocation = reader->relocations + (size_t)reader->next_relocation * ELF_RELOCATION_SIZE;
+  info = elf_get32(relocation + 4, reader->big_endian);
+  symbol = info >> 8;
+  if (4 * index != elf_get32(relocation, reader->big_endian) || type != (info & 0xff)
+      || symbol >= reader->symbol_count) {
+    return false;
+  }
+  name = elf_get32(reader->symbols + (size_t)symbol * ELF_SYMBOL_SIZE, reader->big_endian);
+  if (name >= reader->symbol_names_size || 0 != strcmp(symbol_name, reader->symbol_names + name)) {
+    return false;
+  }
+  reader->next_relocation++;
+  return true;
+}
+
+static struct ir_instruction *elf_add_decoded(struct elf_reader *reader, enum ir_instruction_kind kind) {
+  struct ir_instruction *instruction;
+
+  if (reader->instruction_count == reader->instruction_capacity) {
+    reader->instruction_capacity = reader->instruction_capacity > 0 ? 2 * reader->instruction_capacity : 256;
+    reader->instructions = realloc(reader->instructions,
+                                   reader->instruction_capacity * sizeof(struct ir_instruction));
+    assert(NULL != reader->instructions);
+  }
+  instruction = &reader->instructions[reader->instruction_count++];
+  instruction->kind = kind;
+  return instruction;
+}
+
+/* Decode a register that holds a temporary an instruction reads. */
+static bool elf_decode_temporary(struct elf_reader *reader, struct ir_operand *operand, uint32_t number) {
+  operand->kind = OPERAND_TEMPORARY;
+  if (MIPS_V0 == number || MIPS_V1 == number) {
+    operand->data.temporary = reader->loaded[number - MIPS_V0];
+    if (operand->data.temporary < 0) {
+      reader->error = "$v0 or $v1 is read without a temporary loaded into it";
+      return false;
+    }
+    return true;
+  } else if (number < FIRST_USABLE_REGISTER || number > LAST_USABLE_REGISTER) {
+    reader->error = "a register outside the temporaries is used";
+    return false;
+  }
+  operand->data.temporary = (int)number - FIRST_USABLE_REGISTER;
+  return true;
+}
+
+/* Decode the register an instruction sets, which the store after it names when it is $v0 or $v1. */
+static bool elf_decode_target(struct elf_reader *reader, struct ir_operand *operand, uint32_t number) {
+  if (MIPS_V0 == number || MIPS_V1 == number) {
+    operand->kind = OPERAND_TEMPORARY;
+    operand->data.temporary = -1;
+    reader->unstored = number;
+    return true;
+  }
+  return elf_decode_temporary(reader, operand, number);
+}
+
+/*
+ * elf_decode_temporary_access - decode a load of a temporary in memory
+ * before an instruction, or the store of the one it set after it
+ *
+ * Returns the number of words decoded, which is 0 when the words at index
+ * are not an access to the temporaries area.
+ */
+static uint32_t elf_decode_temporary_access(struct elf_reader *reader, uint32_t index, uint32_t count) {
+  uint32_t word = elf_word(reader, index), next = index + 1 < count ? elf_word(reader, index + 1) : MIPS_NOP;
+  uint32_t offset, reg = MIPS_RT(next);
+  int temporary;
+
+  if (index + 2 > count || MIPS_I_TYPE(MIPS_LUI, 0, MIPS_AT, 0) != (word & ~0xffffu)
+      || (MIPS_I_TYPE(MIPS_LW, MIPS_AT, 0, 0) != (next & ~MIPS_I_TYPE(0, 0, 0x1f, 0xffff))
+          && MIPS_I_TYPE(MIPS_SW, MIPS_AT, 0, 0) != (next & ~MIPS_I_TYPE(0, 0, 0x1f, 0xffff)))) {
+    return 0;
+  }
+  if (!elf_match_relocation(reader, index, ELF_MIPS_HI16, "temporaries")
+      || !elf_match_relocation(reader, index + 1, ELF_MIPS_LO16, "temporaries")) {
+    reader->error = "an access to the temporaries is missing its relocations";
+    return 0;
+  }
+
+  offset = (MIPS_IMMEDIATE(word) << 16) + (MIPS_IMMEDIATE(next) >= 0x8000 ? 0xffff0000 | MIPS_IMMEDIATE(next)
+                                                                            : MIPS_IMMEDIATE(next));
+  temporary = (int)(offset / 4) + MIPS_TEMPORARY_REGISTERS;
+  if (0 != offset % 4 || offset >= 0x80000000) {
+    reader->error = "an access to the temporaries is not at a word of them";
+    return 0;
+  }
+
+  /* The loads come in order, $v0 first, and the store names the register its instruction set. */
+  if (MIPS_LW == MIPS_OPCODE(next)) {
+    if (0 != reader->unstored) {
+      reader->error = "a temporary set in $v0 or $v1 is not stored";
+      return 0;
+    } else if (reg != (reader->loaded[0] < 0 ? MIPS_V0 : MIPS_V1) || reader->loaded[1] >= 0) {
+      reader->error = "a temporary is loaded into a register other than the next of $v0 and $v1";
+      return 0;
+    }
+    reader->loaded[reg - MIPS_V0] = temporary;
+  } else {
+    if (reg != reader->unstored) {
+      reader->error = "a temporary is stored from a register its instruction did not set";
+      return 0;
+    }
+    reader->instructions[reader->instruction_count - 1].operands[0].data.temporary = temporary;
+    reader->unstored = 0;
+  }
+  return 2;
+}
+
+/*
+ * elf_decode_instruction - turn the words at index back into an instruction
+ *
+ * Returns the number of words decoded, or 0 when they are not a sequence
+ * elf_add_instruction produces.
+ */
+static uint32_t elf_decode_instruction(struct elf_reader *reader, uint32_t index, uint32_t count) {
+  struct ir_instruction *instruction;
+  uint32_t word = elf_word(reader, index), next = index + 1 < count ? elf_word(reader, index + 1) : MIPS_NOP;
+  uint32_t immediate = MIPS_IMMEDIATE(word), value;
+  bool ok = true;
+
+  /* The print sequence starts with an or, so try it before move. */
+  if (index + 3 <= count
+      && MIPS_R_TYPE(0, 0, MIPS_A0, MIPS_OR) == (word & ~MIPS_R_TYPE(0, 0x1f, 0, 0))
+      && MIPS_J_TYPE(MIPS_JAL, 0) == next
+      && MIPS_NOP == elf_word(reader, index + 2)) {
+    if (!elf_match_relocation(reader, index + 1, ELF_MIPS_26, "print_number")) {
+      reader->error = "jal print_number is missing its relocation";
+      return 0;
+    }
+    instruction = elf_add_decoded(reader, IR_PRINT_NUMBER);
+    return elf_decode_temporary(reader, &instruction->operands[0], MIPS_RT(word)) ? 3 : 0;
+  }
+
+  switch (MIPS_OPCODE(word)) {
+    case MIPS_ORI:
+    case MIPS_ADDIU:
+    case MIPS_LUI:
+      if (MIPS_ADDIU == MIPS_OPCODE(word) && 0 != MIPS_RS(word)) {
+        instruction = elf_add_decoded(reader, IR_ADD_IMMEDIATE);
+        instruction->operands[2].kind = OPERAND_NUMBER;
+        instruction->operands[2].data.number = immediate >= 0x8000 ? 0xffff0000 | immediate : immediate;
+        ok = elf_decode_target(reader, &instruction->operands[0], MIPS_RT(word))
+          && elf_decode_temporary(reader, &instruction->operands[1], MIPS_RS(word));
+        return ok ? 1 : 0;
+      } else if (0 != MIPS_RS(word)) {
+        break;
+      }
+      if (MIPS_ORI == MIPS_OPCODE(word)) {
+        value = immediate;
+      } else if (MIPS_ADDIU == MIPS_OPCODE(word)) {
+        value = immediate >= 0x8000 ? 0xffff0000 | immediate : immediate;
+      } else {
+        value = immediate << 16;
+      }
+      instruction = elf_add_decoded(reader, IR_LOAD_IMMEDIATE);
+      instruction->operands[1].kind = OPERAND_NUMBER;
+      ok = elf_decode_target(reader, &instruction->operands[0], MIPS_RT(word));
+      if (MIPS_LUI == MIPS_OPCODE(word) && index + 1 < count && MIPS_ORI == MIPS_OPCODE(next)
+          && MIPS_RT(word) == MIPS_RS(next) && MIPS_RT(word) == MIPS_RT(next)) {
+        instruction->operands[1].data.number = value | MIPS_IMMEDIATE(next);
+        return ok ? 2 : 0;
+      }
+      instruction->operands[1].data.number = value;
+      return ok ? 1 : 0;
+
+    case MIPS_BNE:
+      /* The zero check of divu, with the divide in its delay slot. */
+      if (index + 4 <= count && MIPS_I_TYPE(MIPS_BNE, MIPS_RS(word), 0, 2) == word
+          && MIPS_R_TYPE(MIPS_RS(next), MIPS_RS(word), 0, MIPS_DIVU) == next
+          && MIPS_BREAK_7 == elf_word(reader, index + 2)
+          && MIPS_R_TYPE(0, 0, MIPS_RD(elf_word(reader, index + 3)), MIPS_MFLO) == elf_word(reader, index + 3)) {
+        instruction = elf_add_decoded(reader, IR_DIVIDE);
+        ok = elf_decode_target(reader, &instruction->operands[0], MIPS_RD(elf_word(reader, index + 3)))
+          && elf_decode_temporary(reader, &instruction->operands[1], MIPS_RS(next))
+          && elf_decode_temporary(reader, &instruction->operands[2], MIPS_RT(next));
+        return ok ? 4 : 0;
+      }
+      break;
+
+    case MIPS_SPECIAL:
+      if ((MIPS_SLL == MIPS_FUNCTION(word) || MIPS_SRL == MIPS_FUNCTION(word)) && 0 == MIPS_RS(word)
+          && MIPS_NOP != word) {
+        instruction = elf_add_decoded(reader, MIPS_SLL == MIPS_FUNCTION(word) ? IR_SHIFT_LEFT_IMMEDIATE
+                                                                                 : IR_SHIFT_RIGHT_IMMEDIATE);
+        instruction->operands[2].kind = OPERAND_NUMBER;
+        instruction->operands[2].data.number = MIPS_SHIFT(word);
+        ok = elf_decode_target(reader, &instruction->operands[0], MIPS_RD(word))
+          && elf_decode_temporary(reader, &instruction->operands[1], MIPS_RT(word));
+        return ok ? 1 : 0;
+      } else if (0 != MIPS_SHIFT(word)) {
+        break;
+      }
+      switch (MIPS_FUNCTION(word)) {
+        case MIPS_MULTU:
+        case MIPS_DIVU:
+          /* A checked divu starts with its bne, so a divu on its own has no check. */
+          if (index + 2 <= count && 0 == MIPS_RD(word)
+              && MIPS_R_TYPE(0, 0, MIPS_RD(next), MIPS_MFLO) == next) {
+            instruction = elf_add_decoded(reader, MIPS_MULTU == MIPS_FUNCTION(word) ? IR_MULTIPLY
+                                                                                    : IR_DIVIDE_NONZERO);
+            ok = elf_decode_target(reader, &instruction->operands[0], MIPS_RD(next))
+              && elf_decode_temporary(reader, &instruction->operands[1], MIPS_RS(word))
+              && elf_decode_temporary(reader, &instruction->operands[2], MIPS_RT(word));
+            return ok ? 2 : 0;
+          }
+          break;
+
+        case MIPS_ADDU:
+        case MIPS_SUBU:
+          instruction = elf_add_decoded(reader, MIPS_ADDU == MIPS_FUNCTION(word) ? IR_ADD : IR_SUBTRACT);
+          ok = elf_decode_target(reader, &instruction->operands[0], MIPS_RD(word))
+            && elf_decode_temporary(reader, &instruction->operands[1], MIPS_RS(word))
+            && elf_decode_temporary(reader, &instruction->operands[2], MIPS_RT(word));
+          return ok ? 1 : 0;
+
+        case MIPS_SLLV:
+        case MIPS_SRLV:
+          instruction = elf_add_decoded(reader, MIPS_SLLV == MIPS_FUNCTION(word) ? IR_SHIFT_LEFT : IR_SHIFT_RIGHT);
+          ok = elf_decode_target(reader, &instruction->operands[0], MIPS_RD(word))
+            && elf_decode_temporary(reader, &instruction->operands[1], MIPS_RT(word))
+            && elf_decode_temporary(reader, &instruction->operands[2], MIPS_RS(word));
+          return ok ? 1 : 0;
+
+        case MIPS_OR:
+          if (0 == MIPS_RT(word)) {
+            instruction = elf_add_decoded(reader, IR_COPY);
+            ok = elf_decode_target(reader, &instruction->operands[0], MIPS_RD(word))
+              && elf_decode_temporary(reader, &instruction->operands[1], MIPS_RS(word));
+            return ok ? 1 : 0;
+          }
+          /* fall through */
+        case MIPS_AND:
+        case MIPS_XOR:
+          instruction = elf_add_decoded(reader, MIPS_AND == MIPS_FUNCTION(word) ? IR_AND
+                                                : MIPS_XOR == MIPS_FUNCTION(word) ? IR_XOR : IR_OR);
+          ok = elf_decode_target(reader, &instruction->operands[0], MIPS_RD(word))
+            && elf_decode_temporary(reader, &instruction->operands[1], MIPS_RS(word))
+            && elf_decode_temporary(reader, &instruction->operands[2], MIPS_RT(word));
+          return ok ? 1 : 0;
+      }
+      break;
+  }
+
+  if (NULL == reader->error) {
+    reader->error = "it contains an instruction this compiler does not generate";
+  }
+  return 0;
+}
+
+/*
+ * elf_disassemble - print the object in the file name as assembly
+ *
+ * The code is decoded back into IR instructions and printed by the MIPS
+ * stage, in the layout it was set to, so the result can be compared with
+ * the text output of the compile that wrote the object, printed from the
+ * IR. Returns the exit status of the compiler.
+ */
+int elf_disassemble(char const *name, struct emit_buffer *output) {
+  struct elf_reader reader;
+  struct elf_object frame;
+  struct ir_section section;
+  uint32_t index, count, decoded, prologue, ending;
+  size_t i;
+  FILE *input;
+  long size;
+
+  memset(&reader, 0, sizeof(reader));
+  input = fopen(name, "rb");
+  if (NULL == input || 0 != fseek(input, 0, SEEK_END) || (size = ftell(input)) < 0
+      || 0 != fseek(input, 0, SEEK_SET)) {
+    fprintf(stdout, "Could not read object file %s: %s\n", name, strerror(errno));
+    if (NULL != input) {
+      fclose(input);
+    }
+    return 1;
+  }
+  reader.size = (size_t)size;
+  reader.bytes = malloc(reader.size + 1);
+  assert(NULL != reader.bytes);
+  if (reader.size != fread(reader.bytes, 1, reader.size, input)) {
+    fprintf(stdout, "Could not read object file %s: %s\n", name, strerror(errno));
+    fclose(input);
+    free(reader.bytes);
+    return 1;
+  }
+  fclose(input);
+
+  if (elf_read_sections(&reader)) {
+    /*
+     * Every program has the prologue and the ending of an empty one around
+     * its code, ending with print_number.
+     */
+    elf_initialize(&frame, reader.big_endian);
+    prologue = (uint32_t)frame.text_length / 4;
+    elf_add_ending(&frame);
+    ending = (uint32_t)frame.text_length / 4 - prologue;
+
+    count = reader.text_length / 4;
+    if (0 != reader.text_length % 4 || count < prologue + ending
+        || 0 != memcmp(reader.text, frame.text, 4 * (size_t)prologue)
+        || 0 != memcmp(reader.text + 4 * (size_t)(count - ending), frame.text + 4 * (size_t)prologue,
+                       4 * (size_t)ending)) {
+      reader.error = "the code does not start and end like a program of this compiler";
+    } else {
+      count -= ending;
+      reader.loaded[0] = reader.loaded[1] = -1;
+      for (index = prologue; index < count && NULL == reader.error; index += decoded) {
+        decoded = elf_decode_temporary_access(&reader, index, count);
+        if (0 == decoded && NULL == reader.error && 0 == reader.unstored) {
+          decoded = elf_decode_instruction(&reader, index, count);
+          reader.loaded[0] = reader.loaded[1] = -1;
+        } else if (0 == decoded) {
+          break;
+        }
+      }
+      if (NULL == reader.error && 0 != reader.unstored) {
+        reader.error = "a temporary set in $v0 or $v1 is not stored";
+      }
+      for (i = 0; i < frame.relocation_count && NULL == reader.error; i++) {
+        assert(ELF_PRINT_LENGTH_SYMBOL == frame.relocations[i].info >> 8);
+        if (!elf_match_relocation(&reader, frame.relocations[i].offset / 4 - prologue + count,
+                                  frame.relocations[i].info & 0xff, "print_length")) {
+          reader.error = "la $a1, print_length is missing its relocations";
+        }
+      }
+      if (NULL == reader.error && reader.next_relocation != reader.relocation_count) {
+        reader.error = "it has relocations outside la $a1, print_length, jal print_number and the temporaries";
+      }
+    }
+    elf_destroy(&frame);
+  }
+  if (NULL != reader.error) {
+    fprintf(stdout, "Could not disassemble %s: %s.\n", name, reader.error);
+    free(reader.instructions);
+    free(reader.bytes);
+    return 1;
+  }
+
+  /* A program without code still has an instruction for the section to hold. */
+  if (0 == reader.instruction_count) {
+    elf_add_decoded(&reader, IR_NO_OPERATION);
+  }
+  for (i = 0; i < reader.instruction_count; i++) {
+    reader.instructions[i].prev = i > 0 ? &reader.instructions[i - 1] : NULL;
+    reader.instructions[i].next = i + 1 < reader.instruction_count ? &reader.instructions[i + 1] : NULL;
+  }
+  section.first = &reader.instructions[0];
+  section.last = &reader.instructions[reader.instruction_count - 1];
+  mips_print_program(output, &section);
+  emit_string(output, "\n\n");
+
+  free(reader.instructions);
+  free(reader.bytes);
+  return 0;
+}
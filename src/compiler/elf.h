@@ -0,0 +1,40 @@
+#ifndef _ELF_H
+#define _ELF_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+struct ir_section;
+struct emit_buffer;
+
+struct elf_relocation {
+  uint32_t offset;
+  uint32_t info;
+};
+
+/*
+ * A MIPS relocatable object under construction. Code is encoded into text
+ * a section of IR at a time, and the file is laid out when it is written.
+ */
+struct elf_object {
+  bool big_endian;
+  uint8_t *text;
+  size_t text_length;
+  size_t text_capacity;
+  struct elf_relocation *relocations;
+  size_t relocation_count;
+  size_t relocation_capacity;
+  unsigned long temporary_words;
+  int error_count;
+};
+
+void elf_initialize(struct elf_object *object, bool big_endian);
+void elf_destroy(struct elf_object *object);
+
+int elf_add_section(struct elf_object *object, struct ir_section *section);
+bool elf_write(struct elf_object *object, char const *name);
+
+int elf_disassemble(char const *name, struct emit_buffer *output);
+
+#endif /* _ELF_H */
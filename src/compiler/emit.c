@@ -0,0 +1,182 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "emit.h"
+
+/*
+ * The code generator writes millions of short lines, so it formats them
+ * straight into one large buffer instead of going through stdio, and hands
+ * the buffer to the kernel only when it fills. A write error is remembered
+ * and reported when the buffer is closed; text added after it is dropped.
+ */
+
+/******************
+ * OPEN AND CLOSE *
+ ******************/
+
+static void emit_initialize(struct emit_buffer *buffer, int fd, bool owns_fd) {
+  buffer->fd = fd;
+  buffer->owns_fd = owns_fd;
+  buffer->data = malloc(EMIT_BUFFER_SIZE);
+  assert(NULL != buffer->data);
+  buffer->length = 0;
+  buffer->error = 0;
+}
+
+/*
+ * emit_open - create or truncate the file name and buffer writes to it
+ *
+ * Returns false, with errno set, when the file cannot be opened.
+ */
+bool emit_open(struct emit_buffer *buffer, char const *name) {
+  int fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+  if (fd < 0) {
+    return false;
+  }
+  emit_initialize(buffer, fd, true);
+  return true;
+}
+
+/*
+ * emit_attach - buffer writes to a descriptor that stays open after closing
+ *
+ * Anything buffered by stdio for the same descriptor must be flushed first.
+ */
+void emit_attach(struct emit_buffer *buffer, int fd) {
+  emit_initialize(buffer, fd, false);
+}
+
+/*
+ * emit_close - flush the buffer and release it
+ *
+ * Returns false, with errno set, when any of the text could not be written.
+ */
+bool emit_close(struct emit_buffer *buffer) {
+  emit_flush(buffer);
+  if (buffer->owns_fd && 0 != close(buffer->fd) && 0 == buffer->error) {
+    buffer->error = errno;
+  }
+  free(buffer->data);
+  buffer->data = NULL;
+  if (0 != buffer->error) {
+    errno = buffer->error;
+    return false;
+  }
+  return true;
+}
+
+/***************
+ * ADDING TEXT *
+ ***************/
+
+/*
+ * emit_flush - write out everything in the buffer
+ */
+void emit_flush(struct emit_buffer *buffer) {
+  size_t written = 0;
+  ssize_t count;
+
+  while (written < buffer->length && 0 == buffer->error) {
+    count = write(buffer->fd, buffer->data + written, buffer->length - written);
+    if (count >= 0) {
+      written += (size_t)count;
+    } else if (EINTR != errno) {
+      buffer->error = errno;
+    }
+  }
+  buffer->length = 0;
+}
+
+/*
+ * emit_reserve - make room for size bytes at the end of the buffer
+ *
+ * Returns where to put them. The text is added by passing the end of what
+ * was actually written to emit_commit.
+ */
+char *emit_reserve(struct emit_buffer *buffer, size_t size) {
+  assert(size <= EMIT_BUFFER_SIZE);
+  if (EMIT_BUFFER_SIZE - buffer->length < size) {
+    emit_flush(buffer);
+  }
+  return buffer->data + buffer->length;
+}
+
+void emit_commit(struct emit_buffer *buffer, char *end) {
+  assert(end >= buffer->data + buffer->length && end <= buffer->data + EMIT_BUFFER_SIZE);
+  buffer->length = (size_t)(end - buffer->data);
+}
+
+void emit_bytes(struct emit_buffer *buffer, char const *bytes, size_t length) {
+  size_t count;
+
+  while (length > 0) {
+    if (EMIT_BUFFER_SIZE == buffer->length) {
+      emit_flush(buffer);
+    }
+    count = EMIT_BUFFER_SIZE - buffer->length;
+    if (count > length) {
+      count = length;
+    }
+    memcpy(buffer->data + buffer->length, bytes, count);
+    buffer->length += count;
+    bytes += count;
+    length -= count;
+  }
+}
+
+void emit_string(struct emit_buffer *buffer, char const *text) {
+  emit_bytes(buffer, text, strlen(text));
+}
+
+/******************
+ * FORMAT NUMBERS *
+ ******************/
+
+static char const emit_digit_pairs[] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+/*
+ * emit_format_unsigned - write value in decimal at cursor
+ *
+ * The digits are right-aligned in a field of width characters, padded with
+ * spaces, like printf's %*lu. Returns the end of the text, which is at most
+ * width or 20 characters long, whichever is more.
+ */
+char *emit_format_unsigned(char *cursor, unsigned long value, int width) {
+  char digits[20], *start = digits + sizeof(digits);
+  size_t length;
+
+  while (value >= 100) {
+    start -= 2;
+    memcpy(start, emit_digit_pairs + 2 * (value % 100), 2);
+    value /= 100;
+  }
+  if (value >= 10) {
+    start -= 2;
+    memcpy(start, emit_digit_pairs + 2 * value, 2);
+  } else {
+    *--start = (char)('0' + value);
+  }
+
+  length = (size_t)(digits + sizeof(digits) - start);
+  while (width > (int)length) {
+    *cursor++ = ' ';
+    width--;
+  }
+  memcpy(cursor, start, length);
+  return cursor + length;
+}
@@ -0,0 +1,34 @@
+#ifndef _EMIT_H
+#define _EMIT_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#define EMIT_BUFFER_SIZE (1 << 20)
+
+/*
+ * An output buffer written to a file descriptor with write(2) once it
+ * fills. Text is added either a string at a time or by reserving space and
+ * formatting into it directly.
+ */
+struct emit_buffer {
+  int fd;
+  bool owns_fd;
+  char *data;
+  size_t length;
+  int error;
+};
+
+bool emit_open(struct emit_buffer *buffer, char const *name);
+void emit_attach(struct emit_buffer *buffer, int fd);
+bool emit_close(struct emit_buffer *buffer);
+
+void emit_flush(struct emit_buffer *buffer);
+char *emit_reserve(struct emit_buffer *buffer, size_t size);
+void emit_commit(struct emit_buffer *buffer, char *end);
+void emit_bytes(struct emit_buffer *buffer, char const *bytes, size_t length);
+void emit_string(struct emit_buffer *buffer, char const *text);
+
+char *emit_format_unsigned(char *cursor, unsigned long value, int width);
+
+#endif /* _EMIT_H */
@@ -0,0 +1,397 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "node.h"
+#include "flat.h"
+
+/****************
+ * CREATE NODES *
+ ****************/
+
+void flat_initialize(struct flat_tree *tree) {
+  memset(tree, 0, sizeof(struct flat_tree));
+  tree->root = FLAT_NONE;
+}
+
+void flat_destroy(struct flat_tree *tree) {
+  free(tree->kinds);
+  free(tree->operations);
+  free(tree->left);
+  free(tree->right);
+  free(tree->locations);
+  free(tree->wide_numbers);
+  free(tree->names);
+  free(tree->name_table);
+  flat_initialize(tree);
+}
+
+/* Grow a parallel array to hold capacity elements. */
+static void *flat_grow(void *array, uint32_t capacity, size_t size) {
+  array = realloc(array, (size_t)capacity * size);
+  assert(NULL != array);
+  return array;
+}
+
+static flat_id flat_create(struct flat_tree *tree, enum node_kind kind, YYLTYPE location) {
+  flat_id id;
+
+  if (tree->count == tree->capacity) {
+    assert(tree->capacity < FLAT_NONE / 2);
+    tree->capacity = tree->capacity ? tree->capacity * 2 : 1024;
+    tree->kinds = flat_grow(tree->kinds, tree->capacity, sizeof(uint8_t));
+    tree->operations = flat_grow(tree->operations, tree->capacity, sizeof(uint8_t));
+    tree->left = flat_grow(tree->left, tree->capacity, sizeof(flat_id));
+    tree->right = flat_grow(tree->right, tree->capacity, sizeof(flat_id));
+    tree->locations = flat_grow(tree->locations, tree->capacity, sizeof(struct location));
+  }
+
+  id = tree->count++;
+  tree->kinds[id] = kind;
+  tree->operations[id] = 0;
+  tree->left[id] = FLAT_NONE;
+  tree->right[id] = FLAT_NONE;
+
+  tree->locations[id] = location;
+  return id;
+}
+
+flat_id flat_number(struct flat_tree *tree, YYLTYPE location, unsigned long value, bool overflow) {
+  flat_id id = flat_create(tree, NODE_NUMBER, location);
+
+  tree->operations[id] = overflow ? FLAT_NUMBER_OVERFLOW : 0;
+  if (value <= UINT32_MAX) {
+    tree->left[id] = value;
+  } else {
+    if (tree->wide_count == tree->wide_capacity) {
+      tree->wide_capacity = tree->wide_capacity ? tree->wide_capacity * 2 : 16;
+      tree->wide_numbers = flat_grow(tree->wide_numbers, tree->wide_capacity, sizeof(unsigned long));
+    }
+    tree->operations[id] |= FLAT_NUMBER_WIDE;
+    tree->left[id] = tree->wide_count;
+    tree->wide_numbers[tree->wide_count++] = value;
+  }
+  return id;
+}
+
+static uint32_t flat_hash_name(char const *name) {
+  uint32_t hash = 2166136261u;
+  for (; '\0' != *name; name++) {
+    hash = (hash ^ (unsigned char)*name) * 16777619u;
+  }
+  return hash;
+}
+
+static void flat_grow_name_table(struct flat_tree *tree) {
+  uint32_t *old_table = tree->name_table, old_size = tree->name_table_size, i, slot;
+
+  tree->name_table_size = old_size ? old_size * 2 : 256;
+  tree->name_table = malloc(tree->name_table_size * sizeof(uint32_t));
+  assert(NULL != tree->name_table);
+  memset(tree->name_table, 0xFF, tree->name_table_size * sizeof(uint32_t));
+
+  for (i = 0; i < old_size; i++) {
+    if (FLAT_NONE != old_table[i]) {
+      slot = flat_hash_name(tree->names + old_table[i]) & (tree->name_table_size - 1);
+      while (FLAT_NONE != tree->name_table[slot]) {
+        slot = (slot + 1) & (tree->name_table_size - 1);
+      }
+      tree->name_table[slot] = old_table[i];
+    }
+  }
+  free(old_table);
+}
+
+/* Find the offset of name in the name pool, adding it if it is new. */
+static uint32_t flat_intern_name(struct flat_tree *tree, char const *name) {
+  uint32_t slot, length = strlen(name) + 1;
+
+  if (2 * (tree->name_count + 1) > tree->name_table_size) {
+    flat_grow_name_table(tree);
+  }
+
+  slot = flat_hash_name(name) & (tree->name_table_size - 1);
+  while (FLAT_NONE != tree->name_table[slot]) {
+    if (0 == strcmp(name, tree->names + tree->name_table[slot])) {
+      return tree->name_table[slot];
+    }
+    slot = (slot + 1) & (tree->name_table_size - 1);
+  }
+
+  while (tree->names_length + length > tree->names_capacity) {
+    tree->names_capacity = tree->names_capacity ? tree->names_capacity * 2 : 1024;
+    tree->names = flat_grow(tree->names, tree->names_capacity, sizeof(char));
+  }
+  memcpy(tree->names + tree->names_length, name, length);
+  tree->name_table[slot] = tree->names_length;
+  tree->names_length += length;
+  tree->name_count++;
+  return tree->name_table[slot];
+}
+
+flat_id flat_identifier(struct flat_tree *tree, YYLTYPE location, char const *name) {
+  flat_id id = flat_create(tree, NODE_IDENTIFIER, location);
+  tree->left[id] = flat_intern_name(tree, name);
+  return id;
+}
+
+flat_id flat_binary_operation(struct flat_tree *tree, YYLTYPE location, enum node_binary_operation operation,
+                              flat_id left_operand, flat_id right_operand) {
+  flat_id id = flat_create(tree, NODE_BINARY_OPERATION, location);
+  assert(left_operand < id && right_operand < id);
+  tree->operations[id] = operation;
+  tree->left[id] = left_operand;
+  tree->right[id] = right_operand;
+  return id;
+}
+
+flat_id flat_expression_statement(struct flat_tree *tree, YYLTYPE location, flat_id expression) {
+  flat_id id = flat_create(tree, NODE_EXPRESSION_STATEMENT, location);
+  assert(expression < id);
+  tree->left[id] = expression;
+  return id;
+}
+
+flat_id flat_statement_list(struct flat_tree *tree, YYLTYPE location, flat_id init, flat_id statement) {
+  flat_id id = flat_create(tree, NODE_STATEMENT_LIST, location);
+  assert((FLAT_NONE == init || init < id) && statement < id);
+  tree->left[id] = init;
+  tree->right[id] = statement;
+  return id;
+}
+
+flat_id flat_null_statement(struct flat_tree *tree, YYLTYPE location) {
+  return flat_create(tree, NODE_NULL_STATEMENT, location);
+}
+
+YYLTYPE flat_get_location(struct flat_tree *tree, flat_id id) {
+  return tree->locations[id];
+}
+
+unsigned long flat_get_number(struct flat_tree *tree, flat_id id) {
+  assert(NODE_NUMBER == tree->kinds[id]);
+  if (tree->operations[id] & FLAT_NUMBER_WIDE) {
+    return tree->wide_numbers[tree->left[id]];
+  }
+  return tree->left[id];
+}
+
+/*************************
+ * FLATTEN POINTER TREES *
+ *************************/
+
+struct flat_frame {
+  struct node *node;
+  flat_id left;
+  int state;
+};
+
+/* Add an expression children first, using an explicit stack. */
+static flat_id flat_add_expression(struct flat_tree *tree, struct node *expression) {
+  struct flat_frame *stack;
+  size_t depth = 0, capacity = 64;
+  flat_id result = FLAT_NONE;
+  struct node *node;
+
+  stack = malloc(capacity * sizeof(struct flat_frame));
+  assert(NULL != stack);
+  stack[depth].node = expression;
+  stack[depth++].state = 0;
+
+  while (depth > 0) {
+    if (depth == capacity) {
+      capacity *= 2;
+      stack = realloc(stack, capacity * sizeof(struct flat_frame));
+      assert(NULL != stack);
+    }
+
+    node = stack[depth - 1].node;
+    switch (node->kind) {
+      case NODE_BINARY_OPERATION:
+        if (0 == stack[depth - 1].state) {
+          stack[depth - 1].state = 1;
+          stack[depth].node = node->data.binary_operation.left_operand;
+          stack[depth++].state = 0;
+        } else if (1 == stack[depth - 1].state) {
+          stack[depth - 1].state = 2;
+          stack[depth - 1].left = result;
+          stack[depth].node = node->data.binary_operation.right_operand;
+          stack[depth++].state = 0;
+        } else {
+          result = flat_binary_operation(tree, node->location, node->data.binary_operation.operation,
+                                         stack[depth - 1].left, result);
+          depth--;
+        }
+        break;
+
+      case NODE_NUMBER:
+        result = flat_number(tree, node->location, node->data.number.value, node->data.number.overflow);
+        depth--;
+        break;
+
+      case NODE_IDENTIFIER:
+        result = flat_identifier(tree, node->location, node->data.identifier.name);
+        depth--;
+        break;
+
+      default:
+        assert(0);
+        depth--;
+        break;
+    }
+  }
+
+  free(stack);
+  return result;
+}
+
+/*
+ * flat_add_statement_list - add a copy of a pointer parse tree
+ *
+ * Returns the id of the copied statement list, which also becomes the root
+ * of the tree.
+ */
+flat_id flat_add_statement_list(struct flat_tree *tree, struct node *statement_list) {
+  struct node **lists, *iter, *statement;
+  size_t count = 0, i;
+  flat_id init = FLAT_NONE, id;
+
+  for (iter = statement_list; NULL != iter; iter = iter->data.statement_list.init) {
+    count++;
+  }
+  lists = malloc(count * sizeof(struct node *));
+  assert(NULL != lists);
+  for (iter = statement_list, i = count; NULL != iter; iter = iter->data.statement_list.init) {
+    lists[--i] = iter;
+  }
+
+  for (i = 0; i < count; i++) {
+    statement = lists[i]->data.statement_list.statement;
+    if (NODE_EXPRESSION_STATEMENT == statement->kind) {
+      id = flat_add_expression(tree, statement->data.expression_statement.expression);
+      id = flat_expression_statement(tree, statement->location, id);
+    } else {
+      id = flat_null_statement(tree, statement->location);
+    }
+    init = flat_statement_list(tree, lists[i]->location, init, id);
+  }
+
+  free(lists);
+  tree->root = init;
+  return init;
+}
+
+/*************************
+ * PRINT FLATTENED TREES *
+ *************************/
+
+/*
+ * Prints an expression in the same form as node_print_statement_list, using
+ * an explicit stack of node ids. A binary operation is visited three times:
+ * before, between and after its operands.
+ */
+static void flat_print_expression(FILE *output, struct flat_tree *tree, flat_id expression) {
+  struct {
+    flat_id id;
+    int state;
+  } *stack;
+  size_t depth = 0, capacity = 64;
+  flat_id id;
+
+  stack = malloc(capacity * sizeof(*stack));
+  assert(NULL != stack);
+  stack[depth].id = expression;
+  stack[depth++].state = 0;
+
+  while (depth > 0) {
+    if (depth == capacity) {
+      capacity *= 2;
+      stack = realloc(stack, capacity * sizeof(*stack));
+      assert(NULL != stack);
+    }
+
+    id = stack[depth - 1].id;
+    switch (tree->kinds[id]) {
+      case NODE_BINARY_OPERATION:
+        if (0 == stack[depth - 1].state) {
+          fputs("(", output);
+          stack[depth - 1].state = 1;
+          stack[depth].id = tree->left[id];
+          stack[depth++].state = 0;
+        } else if (1 == stack[depth - 1].state
+                   && (BINOP_POST_INCREMENT == tree->operations[id] || BINOP_POST_DECREMENT == tree->operations[id])) {
+          /* The 1 that a postfix operator adds is not printed. */
+          fputs(node_binary_operator(tree->operations[id]), output);
+          stack[depth - 1].state = 2;
+        } else if (1 == stack[depth - 1].state) {
+          fputs(" ", output);
+          fputs(node_binary_operator(tree->operations[id]), output);
+          fputs(" ", output);
+          stack[depth - 1].state = 2;
+          stack[depth].id = tree->right[id];
+          stack[depth++].state = 0;
+        } else {
+          fputs(")", output);
+          depth--;
+        }
+        break;
+
+      case NODE_NUMBER:
+        fprintf(output, "%lu", flat_get_number(tree, id));
+        depth--;
+        break;
+
+      case NODE_IDENTIFIER:
+        fputs(tree->names + tree->left[id], output);
+        depth--;
+        break;
+
+      default:
+        assert(0);
+        depth--;
+        break;
+    }
+  }
+  free(stack);
+}
+
+void flat_print_statement_list(FILE *output, struct flat_tree *tree, flat_id statement_list) {
+  flat_id *lists, iter;
+  size_t count = 0, i;
+
+  for (iter = statement_list; FLAT_NONE != iter; iter = tree->left[iter]) {
+    assert(NODE_STATEMENT_LIST == tree->kinds[iter]);
+    count++;
+  }
+  lists = malloc(count * sizeof(flat_id));
+  assert(NULL != lists);
+  for (iter = statement_list, i = count; FLAT_NONE != iter; iter = tree->left[iter]) {
+    lists[--i] = iter;
+  }
+
+  for (i = 0; i < count; i++) {
+    iter = tree->right[lists[i]];
+    assert(NODE_EXPRESSION_STATEMENT == tree->kinds[iter]);
+    flat_print_expression(output, tree, tree->left[iter]);
+    fputs(";\n", output);
+  }
+  free(lists);
+}
+
+/*
+ * flat_print_footprint - compare the memory used by the flattened tree
+ * with that of the equivalent pointer tree
+ */
+void flat_print_footprint(FILE *output, struct flat_tree *tree) {
+  size_t per_node = sizeof(uint8_t) * 2 + sizeof(flat_id) * 2 + sizeof(struct location);
+  size_t total = tree->count * per_node
+               + tree->wide_count * sizeof(unsigned long)
+               + tree->names_length
+               + tree->name_table_size * sizeof(uint32_t);
+
+  fprintf(output, "flat tree: %u nodes, %u names, %zu bytes, %.1f bytes per node"
+          " (pointer tree: %zu bytes per node)\n",
+          tree->count, tree->name_count, total,
+          tree->count ? (double)total / tree->count : 0.0, sizeof(struct node));
+}
@@ -0,0 +1,75 @@
+#ifndef _FLAT_H
+#define _FLAT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "compiler.h"
+#include "node.h"
+
+/*
+ * A parse tree flattened into parallel arrays indexed by 32-bit node ids.
+ * Nodes are added children first, so the ids are a post-order numbering and
+ * a pass that visits children before parents walks every array linearly.
+ *
+ * The meaning of left and right depends on the kind of the node:
+ *   NODE_NUMBER               left = value (or wide number index)
+ *   NODE_IDENTIFIER           left = offset of the name in names
+ *   NODE_BINARY_OPERATION     left, right = operands; operation = operator
+ *   NODE_EXPRESSION_STATEMENT left = expression
+ *   NODE_STATEMENT_LIST       left = init (or FLAT_NONE), right = statement
+ */
+typedef uint32_t flat_id;
+
+#define FLAT_NONE UINT32_MAX
+
+/* Flags kept in the operation byte of a number. */
+#define FLAT_NUMBER_OVERFLOW 0x1
+#define FLAT_NUMBER_WIDE     0x2
+
+struct flat_tree {
+  uint32_t count;
+  uint32_t capacity;
+  uint8_t *kinds;
+  uint8_t *operations;
+  flat_id *left;
+  flat_id *right;
+  struct location *locations;
+
+  /* Numbers that do not fit in 32 bits. */
+  unsigned long *wide_numbers;
+  uint32_t wide_count;
+  uint32_t wide_capacity;
+
+  /* Identifier names, each stored once, and a hash table of their offsets. */
+  char *names;
+  uint32_t names_length;
+  uint32_t names_capacity;
+  uint32_t *name_table;
+  uint32_t name_table_size;
+  uint32_t name_count;
+
+  flat_id root;
+};
+
+void flat_initialize(struct flat_tree *tree);
+void flat_destroy(struct flat_tree *tree);
+
+flat_id flat_number(struct flat_tree *tree, YYLTYPE location, unsigned long value, bool overflow);
+flat_id flat_identifier(struct flat_tree *tree, YYLTYPE location, char const *name);
+flat_id flat_binary_operation(struct flat_tree *tree, YYLTYPE location, enum node_binary_operation operation,
+                              flat_id left_operand, flat_id right_operand);
+flat_id flat_expression_statement(struct flat_tree *tree, YYLTYPE location, flat_id expression);
+flat_id flat_statement_list(struct flat_tree *tree, YYLTYPE location, flat_id init, flat_id statement);
+flat_id flat_null_statement(struct flat_tree *tree, YYLTYPE location);
+
+YYLTYPE flat_get_location(struct flat_tree *tree, flat_id id);
+unsigned long flat_get_number(struct flat_tree *tree, flat_id id);
+
+flat_id flat_add_statement_list(struct flat_tree *tree, struct node *statement_list);
+
+void flat_print_statement_list(FILE *output, struct flat_tree *tree, flat_id statement_list);
+void flat_print_footprint(FILE *output, struct flat_tree *tree);
+
+#endif /* _FLAT_H */
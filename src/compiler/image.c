@@ -0,0 +1,623 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "node.h"
+#include "symbol.h"
+#include "type.h"
+#include "ir.h"
+#include "image.h"
+
+/*
+ * An image is a binary snapshot of the compiler's state after the type stage
+ * (the typed parse tree and its symbol table) or after the IR stage (the IR
+ * instruction list). The objects are stored with the same layout they have in
+ * memory, except that every pointer holds an offset from the start of the
+ * file, with 0 standing for NULL.
+ *
+ * Loading maps the file privately and converts the offsets back to pointers
+ * in a single linear pass over each region. Nothing is copied or allocated,
+ * and only the pages that contain pointers are ever written.
+ *
+ * Because the layout is the in-memory one, the header records the byte order
+ * and the structure sizes of the compiler that wrote the image, and images
+ * from a different build are rejected.
+ */
+
+#define IMAGE_MAGIC "E95IMAGE"
+#define IMAGE_VERSION 6
+#define IMAGE_BYTE_ORDER 0x01020304u
+
+/* The type table holds every signedness of every basic type. */
+#define IMAGE_TYPE_COUNT 8
+
+#define IMAGE_OFFSET(offset) ((void *)(uintptr_t)(offset))
+
+struct image_region {
+  unsigned long long start, end, stride;
+};
+
+struct image_header {
+  char magic[8];
+  unsigned int version;
+  unsigned int kind;
+  unsigned int byte_order;
+  unsigned int pointer_size;
+  unsigned int node_size;
+  unsigned int symbol_size;
+  unsigned int type_size;
+  unsigned int instruction_size;
+
+  /* The statement list or the first instruction, and the last instruction. */
+  unsigned long long root;
+  unsigned long long last;
+  unsigned long long symbols;
+
+  struct image_region types;
+  struct image_region symbol_list;
+  struct image_region objects;
+};
+
+struct image_buffer {
+  char *bytes;
+  size_t length;
+  size_t capacity;
+};
+
+/* Reserve zeroed space at the end of buffer and return its offset. */
+static size_t image_reserve(struct image_buffer *buffer, size_t size) {
+  size_t offset = buffer->length;
+
+  while (buffer->length + size > buffer->capacity) {
+    buffer->capacity = buffer->capacity ? buffer->capacity * 2 : 65536;
+    buffer->bytes = realloc(buffer->bytes, buffer->capacity);
+    assert(NULL != buffer->bytes);
+  }
+  memset(buffer->bytes + offset, 0, size);
+  buffer->length += size;
+  return offset;
+}
+
+static void image_initialize_header(struct image_buffer *buffer, enum image_kind kind) {
+  struct image_header *header;
+
+  image_reserve(buffer, sizeof(struct image_header));
+  header = (struct image_header *)buffer->bytes;
+  memcpy(header->magic, IMAGE_MAGIC, sizeof(header->magic));
+  header->version = IMAGE_VERSION;
+  header->kind = kind;
+  header->byte_order = IMAGE_BYTE_ORDER;
+  header->pointer_size = sizeof(void *);
+  header->node_size = sizeof(struct node);
+  header->symbol_size = sizeof(struct symbol_list);
+  header->type_size = sizeof(struct type);
+  header->instruction_size = sizeof(struct ir_instruction);
+}
+
+static int image_write_buffer(char const *name, struct image_buffer *buffer) {
+  FILE *output = fopen(name, "wb");
+  int error = 0;
+
+  if (NULL == output) {
+    fprintf(stdout, "Could not open image file %s: %s\n", name, strerror(errno));
+    free(buffer->bytes);
+    return 1;
+  }
+  if (buffer->length != fwrite(buffer->bytes, 1, buffer->length, output)) {
+    fprintf(stdout, "Could not write image file %s: %s\n", name, strerror(errno));
+    error = 1;
+  }
+  fclose(output);
+  free(buffer->bytes);
+  return error;
+}
+
+/*********************
+ * WRITE TREE IMAGES *
+ *********************/
+
+struct image_writer {
+  struct image_buffer buffer;
+  size_t types;
+  size_t *symbols;
+
+  /* Offsets of the operands written for the binary operations being walked. */
+  size_t *operands;
+  size_t operand_count;
+  size_t operand_capacity;
+};
+
+static size_t image_put_type(struct image_writer *writer, struct type *type) {
+  if (NULL == type) {
+    return 0;
+  }
+  assert(TYPE_BASIC == type->kind);
+  return writer->types
+       + (type->data.basic.is_unsigned * 4 + type->data.basic.datatype) * sizeof(struct type);
+}
+
+static size_t image_put_copy(struct image_writer *writer, struct node *copy) {
+  size_t offset = image_reserve(&writer->buffer, sizeof(struct node));
+  memcpy(writer->buffer.bytes + offset, copy, sizeof(struct node));
+  return offset;
+}
+
+/* Expressions are written by a post-order walk, so children come before their parents. */
+static enum node_walk image_put_expression(struct node *node, enum node_visit visit, void *context) {
+  struct image_writer *writer = context;
+  struct node copy;
+
+  if (NODE_VISIT_POST != visit) {
+    return NODE_WALK_OPERANDS;
+  }
+
+  copy = *node;
+  copy.ir = NULL;
+  switch (node->kind) {
+    case NODE_NUMBER:
+      copy.data.number.result.type = IMAGE_OFFSET(image_put_type(writer, node->data.number.result.type));
+      copy.data.number.result.ir_operand = NULL;
+      break;
+
+    case NODE_IDENTIFIER:
+      copy.data.identifier.symbol = IMAGE_OFFSET(writer->symbols[node->data.identifier.symbol->id]);
+      break;
+
+    case NODE_BINARY_OPERATION:
+      assert(writer->operand_count >= 2);
+      copy.data.binary_operation.right_operand = IMAGE_OFFSET(writer->operands[--writer->operand_count]);
+      copy.data.binary_operation.left_operand = IMAGE_OFFSET(writer->operands[--writer->operand_count]);
+      copy.data.binary_operation.result.type =
+        IMAGE_OFFSET(image_put_type(writer, node->data.binary_operation.result.type));
+      copy.data.binary_operation.result.ir_operand = NULL;
+      break;
+
+    default:
+      assert(0);
+      break;
+  }
+
+  if (writer->operand_count == writer->operand_capacity) {
+    writer->operand_capacity = writer->operand_capacity ? writer->operand_capacity * 2 : 64;
+    writer->operands = realloc(writer->operands, writer->operand_capacity * sizeof(size_t));
+    assert(NULL != writer->operands);
+  }
+  writer->operands[writer->operand_count++] = image_put_copy(writer, &copy);
+  return NODE_WALK_OPERANDS;
+}
+
+static size_t image_put_statement(struct image_writer *writer, struct node *node) {
+  struct node copy;
+
+  if (NULL == node) {
+    return 0;
+  }
+
+  copy = *node;
+  copy.ir = NULL;
+  switch (node->kind) {
+    case NODE_EXPRESSION_STATEMENT:
+      node_walk_expression(node->data.expression_statement.expression, image_put_expression, writer);
+      assert(1 == writer->operand_count);
+      copy.data.expression_statement.expression = IMAGE_OFFSET(writer->operands[--writer->operand_count]);
+      break;
+
+    case NODE_NULL_STATEMENT:
+      break;
+
+    default:
+      assert(0);
+      break;
+  }
+  return image_put_copy(writer, &copy);
+}
+
+/*
+ * Statement lists are written from the first statement onwards, iteratively,
+ * since a long program makes the init chain arbitrarily long.
+ */
+static size_t image_put_statement_list(struct image_writer *writer, struct node *statement_list) {
+  struct node **lists, *iter, copy;
+  size_t count = 0, i, offset = 0;
+
+  for (iter = statement_list; NULL != iter; iter = iter->data.statement_list.init) {
+    count++;
+  }
+  lists = malloc(count * sizeof(struct node *));
+  assert(NULL != lists);
+  for (iter = statement_list, i = count; NULL != iter; iter = iter->data.statement_list.init) {
+    lists[--i] = iter;
+  }
+
+  for (i = 0; i < count; i++) {
+    assert(NODE_STATEMENT_LIST == lists[i]->kind);
+    copy = *lists[i];
+    copy.ir = NULL;
+    copy.data.statement_list.init = IMAGE_OFFSET(offset);
+    copy.data.statement_list.statement =
+      IMAGE_OFFSET(image_put_statement(writer, lists[i]->data.statement_list.statement));
+    offset = image_put_copy(writer, &copy);
+  }
+  free(lists);
+  return offset;
+}
+
+/*
+ * image_write_tree - write the typed parse tree and its symbol table
+ *
+ * Returns the number of errors encountered.
+ */
+int image_write_tree(char const *name, struct node *statement_list, struct symbol_table *table) {
+  struct image_writer writer;
+  struct image_header *header;
+  struct symbol_list *iter;
+  struct type *type;
+  size_t offset, root;
+  unsigned int max_id = 0;
+  int i;
+
+  memset(&writer, 0, sizeof(writer));
+  image_initialize_header(&writer.buffer, IMAGE_TREE);
+
+  writer.types = image_reserve(&writer.buffer, IMAGE_TYPE_COUNT * sizeof(struct type));
+  for (i = 0; i < IMAGE_TYPE_COUNT; i++) {
+    type = (struct type *)(writer.buffer.bytes + writer.types) + i;
+    type->kind = TYPE_BASIC;
+    type->data.basic.is_unsigned = i / 4;
+    type->data.basic.datatype = i % 4;
+  }
+
+  for (iter = table->variables; NULL != iter; iter = iter->next) {
+    if (iter->symbol.id > max_id) {
+      max_id = iter->symbol.id;
+    }
+  }
+  writer.symbols = calloc(max_id + 1, sizeof(size_t));
+  assert(NULL != writer.symbols);
+
+  /* The symbol list is written in order, each element followed by the next. */
+  offset = writer.buffer.length;
+  for (iter = table->variables; NULL != iter; iter = iter->next) {
+    struct symbol_list *copy;
+    size_t element = image_reserve(&writer.buffer, sizeof(struct symbol_list));
+
+    copy = (struct symbol_list *)(writer.buffer.bytes + element);
+    *copy = *iter;
+    copy->symbol.result.type = IMAGE_OFFSET(image_put_type(&writer, iter->symbol.result.type));
+    copy->symbol.result.ir_operand = NULL;
+    copy->next = IMAGE_OFFSET(NULL == iter->next ? 0 : element + sizeof(struct symbol_list));
+    writer.symbols[iter->symbol.id] = element;
+  }
+
+  header = (struct image_header *)writer.buffer.bytes;
+  header->symbols = writer.buffer.length > offset ? offset : 0;
+  header->types.start = writer.types;
+  header->types.end = offset;
+  header->types.stride = sizeof(struct type);
+  header->symbol_list.start = offset;
+  header->symbol_list.end = writer.buffer.length;
+  header->symbol_list.stride = sizeof(struct symbol_list);
+
+  offset = writer.buffer.length;
+  root = image_put_statement_list(&writer, statement_list);
+
+  header = (struct image_header *)writer.buffer.bytes;
+  header->root = root;
+  header->objects.start = offset;
+  header->objects.end = writer.buffer.length;
+  header->objects.stride = sizeof(struct node);
+
+  free(writer.symbols);
+  free(writer.operands);
+  return image_write_buffer(name, &writer.buffer);
+}
+
+/*******************
+ * WRITE IR IMAGES *
+ *******************/
+
+/*
+ * image_write_ir - write the instructions of an IR section
+ *
+ * Instructions are stored in list order. Returns the number of errors
+ * encountered.
+ */
+int image_write_ir(char const *name, struct ir_section *section) {
+  struct image_buffer buffer;
+  struct image_header *header;
+  struct ir_instruction *iter, *copy;
+  size_t offset, element;
+
+  memset(&buffer, 0, sizeof(buffer));
+  image_initialize_header(&buffer, IMAGE_IR);
+
+  offset = buffer.length;
+  for (iter = section->first; NULL != iter; iter = iter->next) {
+    element = image_reserve(&buffer, sizeof(struct ir_instruction));
+    copy = (struct ir_instruction *)(buffer.bytes + element);
+    *copy = *iter;
+    copy->prev = IMAGE_OFFSET(iter == section->first ? 0 : element - sizeof(struct ir_instruction));
+    copy->next = IMAGE_OFFSET(iter == section->last ? 0 : element + sizeof(struct ir_instruction));
+    if (iter == section->last) {
+      break;
+    }
+  }
+
+  header = (struct image_header *)buffer.bytes;
+  header->root = offset;
+  header->last = buffer.length - sizeof(struct ir_instruction);
+  header->types.stride = sizeof(struct type);
+  header->symbol_list.stride = sizeof(struct symbol_list);
+  header->objects.start = offset;
+  header->objects.end = buffer.length;
+  header->objects.stride = sizeof(struct ir_instruction);
+
+  return image_write_buffer(name, &buffer);
+}
+
+/***************
+ * LOAD IMAGES *
+ ***************/
+
+/* A region must lie after the header, inside the file, and hold whole objects of size. */
+static bool image_region_is_valid(struct image *image, struct image_region *region, size_t size) {
+  return region->stride == size
+      && region->start <= region->end
+      && region->end <= image->size
+      && (region->start == region->end || region->start >= sizeof(struct image_header))
+      && 0 == (region->end - region->start) % region->stride;
+}
+
+/* Whether offset is the start of one of the objects in region. */
+static bool image_offset_is_valid(struct image_region *region, unsigned long long offset) {
+  return offset >= region->start && offset < region->end && 0 == (offset - region->start) % region->stride;
+}
+
+/* Turn the offset stored in *field into a pointer into region. */
+static bool image_swizzle(struct image *image, void **field, struct image_region *region) {
+  unsigned long long offset = (uintptr_t)*field;
+
+  if (0 == offset) {
+    return true;
+  }
+  if (!image_offset_is_valid(region, offset)) {
+    return false;
+  }
+  *field = (char *)image->base + offset;
+  return true;
+}
+
+#define IMAGE_SWIZZLE(image, field, region) image_swizzle(image, (void **)&(field), region)
+#define IMAGE_SWIZZLE_REQUIRED(image, field, region) (NULL != (field) && IMAGE_SWIZZLE(image, field, region))
+
+/* Whether a name read from an image ends within its array. */
+#define IMAGE_NAME_IS_VALID(name) (NULL != memchr(name, '\0', sizeof(name)))
+
+static bool image_types_are_valid(struct image *image, struct image_region *region) {
+  unsigned long long offset;
+  struct type *type;
+
+  for (offset = region->start; offset < region->end; offset += region->stride) {
+    type = (struct type *)((char *)image->base + offset);
+    if (TYPE_BASIC != type->kind
+        || *(unsigned char *)&type->data.basic.is_unsigned > 1
+        || type->data.basic.datatype > TYPE_BASIC_LONG) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Every pointer in a tree image points forwards in the symbol list and
+ * backwards among the nodes, since children are written before their
+ * parents, so a corrupt image cannot make a cycle.
+ */
+static bool image_load_tree(struct image *image, struct image_header *header) {
+  unsigned long long offset;
+  struct image_region following, preceding;
+  struct symbol_list *symbol_list;
+  struct node *node;
+  bool ok = image_offset_is_valid(&header->objects, header->root)
+         && (0 == header->symbols || image_offset_is_valid(&header->symbol_list, header->symbols))
+         && image_types_are_valid(image, &header->types);
+
+  for (offset = header->symbol_list.start; ok && offset < header->symbol_list.end; offset += header->symbol_list.stride) {
+    symbol_list = (struct symbol_list *)((char *)image->base + offset);
+    following = header->symbol_list;
+    following.start = offset + following.stride;
+    ok = IMAGE_NAME_IS_VALID(symbol_list->symbol.name)
+      && IMAGE_SWIZZLE(image, symbol_list->symbol.result.type, &header->types)
+      && IMAGE_SWIZZLE(image, symbol_list->next, &following);
+  }
+
+  for (offset = header->objects.start; ok && offset < header->objects.end; offset += header->objects.stride) {
+    node = (struct node *)((char *)image->base + offset);
+    preceding = header->objects;
+    preceding.end = offset;
+    switch (node->kind) {
+      case NODE_NUMBER:
+        ok = *(unsigned char *)&node->data.number.overflow <= 1
+          && IMAGE_SWIZZLE_REQUIRED(image, node->data.number.result.type, &header->types);
+        break;
+      case NODE_IDENTIFIER:
+        ok = IMAGE_NAME_IS_VALID(node->data.identifier.name)
+          && IMAGE_SWIZZLE_REQUIRED(image, node->data.identifier.symbol, &header->symbol_list);
+        break;
+      case NODE_BINARY_OPERATION:
+        ok = node->data.binary_operation.operation >= BINOP_MULTIPLICATION
+          && node->data.binary_operation.operation <= BINOP_POST_DECREMENT
+          && *(unsigned char *)&node->data.binary_operation.evaluate_right_first <= 1
+          && IMAGE_SWIZZLE_REQUIRED(image, node->data.binary_operation.left_operand, &preceding)
+          && IMAGE_SWIZZLE_REQUIRED(image, node->data.binary_operation.right_operand, &preceding)
+          && IMAGE_SWIZZLE_REQUIRED(image, node->data.binary_operation.result.type, &header->types);
+        break;
+      case NODE_EXPRESSION_STATEMENT:
+        ok = IMAGE_SWIZZLE_REQUIRED(image, node->data.expression_statement.expression, &preceding);
+        break;
+      case NODE_STATEMENT_LIST:
+        ok = IMAGE_SWIZZLE(image, node->data.statement_list.init, &preceding)
+          && IMAGE_SWIZZLE_REQUIRED(image, node->data.statement_list.statement, &preceding);
+        break;
+      case NODE_NULL_STATEMENT:
+        break;
+      default:
+        ok = false;
+        break;
+    }
+  }
+
+  if (!ok) {
+    return false;
+  }
+
+  image->tree = (struct node *)((char *)image->base + header->root);
+  image->symbol_table.variables =
+    header->symbols ? (struct symbol_list *)((char *)image->base + header->symbols) : NULL;
+  return true;
+}
+
+/*
+ * The operands each kind of instruction takes, N for a number and T for a
+ * temporary, in the order of enum ir_instruction_kind.
+ */
+static char const *const image_ir_operands[IR_PROFILE_COUNT + 1] = {
+  "", "TTT", "TTT", "TTT", "TTT", "TN", "TT", "T", "TTN",
+  "TTT", "TTT", "TTN", "TTN", "TTT", "TTT", "TTT", "TTT", "N"
+};
+
+static bool image_instruction_is_valid(struct ir_instruction *instruction) {
+  char const *operands;
+  int i;
+
+  if (instruction->kind < IR_NO_OPERATION || instruction->kind > IR_PROFILE_COUNT) {
+    return false;
+  }
+  operands = image_ir_operands[instruction->kind];
+  for (i = 0; '\0' != operands[i]; i++) {
+    if ('N' == operands[i] ? OPERAND_NUMBER != instruction->operands[i].kind
+                           : OPERAND_TEMPORARY != instruction->operands[i].kind
+                             || instruction->operands[i].data.temporary < 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* The instructions of an IR image are stored in list order, each linked to its neighbours. */
+static bool image_load_ir(struct image *image, struct image_header *header) {
+  unsigned long long offset, stride = header->objects.stride;
+  struct ir_instruction *instruction;
+  bool ok = header->objects.start < header->objects.end
+         && header->root == header->objects.start
+         && header->last == header->objects.end - stride;
+
+  for (offset = header->objects.start; ok && offset < header->objects.end; offset += stride) {
+    instruction = (struct ir_instruction *)((char *)image->base + offset);
+    ok = image_instruction_is_valid(instruction)
+      && (uintptr_t)instruction->prev == (offset == header->root ? 0 : offset - stride)
+      && (uintptr_t)instruction->next == (offset == header->last ? 0 : offset + stride)
+      && IMAGE_SWIZZLE(image, instruction->prev, &header->objects)
+      && IMAGE_SWIZZLE(image, instruction->next, &header->objects);
+  }
+  if (!ok) {
+    return false;
+  }
+
+  image->ir = malloc(sizeof(struct ir_section));
+  assert(NULL != image->ir);
+  image->ir->first = (struct ir_instruction *)((char *)image->base + header->root);
+  image->ir->last = (struct ir_instruction *)((char *)image->base + header->last);
+  return true;
+}
+
+/*
+ * image_load - map an image file and restore the objects it contains
+ *
+ * Returns the number of errors encountered.
+ */
+int image_load(char const *name, struct image *image) {
+  struct image_header *header;
+  struct stat info;
+  bool ok;
+  int fd;
+
+  memset(image, 0, sizeof(struct image));
+  fd = open(name, O_RDONLY);
+  if (fd < 0 || 0 != fstat(fd, &info)) {
+    fprintf(stdout, "Could not open image file %s: %s\n", name, strerror(errno));
+    if (fd >= 0) {
+      close(fd);
+    }
+    return 1;
+  }
+  image->size = info.st_size;
+  if (image->size < sizeof(struct image_header)) {
+    fprintf(stdout, "Image file %s is truncated.\n", name);
+    close(fd);
+    return 1;
+  }
+
+  image->base = mmap(NULL, image->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (MAP_FAILED == image->base) {
+    fprintf(stdout, "Could not map image file %s: %s\n", name, strerror(errno));
+    return 1;
+  }
+
+  header = image->base;
+  if (0 != memcmp(header->magic, IMAGE_MAGIC, sizeof(header->magic))) {
+    fprintf(stdout, "File %s is not an image.\n", name);
+    image_unload(image);
+    return 1;
+  }
+  if (IMAGE_VERSION != header->version
+      || IMAGE_BYTE_ORDER != header->byte_order
+      || sizeof(void *) != header->pointer_size
+      || sizeof(struct node) != header->node_size
+      || sizeof(struct symbol_list) != header->symbol_size
+      || sizeof(struct type) != header->type_size
+      || sizeof(struct ir_instruction) != header->instruction_size) {
+    fprintf(stdout, "Image file %s was written by an incompatible compiler.\n", name);
+    image_unload(image);
+    return 1;
+  }
+
+  image->kind = header->kind;
+  ok = image_region_is_valid(image, &header->types, sizeof(struct type))
+    && image_region_is_valid(image, &header->symbol_list, sizeof(struct symbol_list))
+    && image_region_is_valid(image, &header->objects, IMAGE_TREE == header->kind ? sizeof(struct node)
+                                                                                 : sizeof(struct ir_instruction));
+  if (ok && IMAGE_TREE == header->kind) {
+    ok = image_load_tree(image, header);
+  } else if (ok && IMAGE_IR == header->kind) {
+    ok = image_load_ir(image, header);
+  } else {
+    ok = false;
+  }
+
+  if (!ok) {
+    fprintf(stdout, "Image file %s is corrupt.\n", name);
+    image_unload(image);
+    return 1;
+  }
+  return 0;
+}
+
+/*
+ * image_unload - unmap a loaded image, after which none of its objects can
+ * be used
+ */
+void image_unload(struct image *image) {
+  munmap(image->base, image->size);
+  image->base = NULL;
+  free(image->ir);
+  image->ir = NULL;
+}
@@ -0,0 +1,38 @@
+#ifndef _IMAGE_H
+#define _IMAGE_H
+
+#include <stddef.h>
+
+#include "symbol.h"
+
+struct node;
+struct ir_section;
+
+enum image_kind {
+  IMAGE_TREE,
+  IMAGE_IR
+};
+
+/*
+ * A loaded image. The objects it describes live in a private mapping of the
+ * image file and stay valid until the image is unloaded.
+ */
+struct image {
+  enum image_kind kind;
+  void *base;
+  size_t size;
+
+  /* IMAGE_TREE */
+  struct node *tree;
+  struct symbol_table symbol_table;
+
+  /* IMAGE_IR */
+  struct ir_section *ir;
+};
+
+int image_write_tree(char const *name, struct node *statement_list, struct symbol_table *table);
+int image_write_ir(char const *name, struct ir_section *section);
+int image_load(char const *name, struct image *image);
+void image_unload(struct image *image);
+
+#endif /* _IMAGE_H */
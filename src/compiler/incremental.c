@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "node.h"
+#include "incremental.h"
+
+/*
+ * An incremental compile keeps its statements for the next compile of the
+ * same source, which is taken to be an edited copy of this one.
+ *
+ * The top-level statements end at their semicolons, and a semicolon is
+ * always a token of its own, so a statement is scanned and parsed the same
+ * wherever it is, as long as its own text is. The next compile finds the
+ * text the two sources have in common at their start and at their end.
+ * The statements that lie wholly in the common start are kept, and those
+ * that lie wholly in the common end, along with the semicolon before them,
+ * are kept and moved. Only the text between the two is parsed again.
+ *
+ * The stages after parsing depend on the statements before, through the
+ * symbols they defined and the temporaries they numbered, so they run
+ * again from the first statement that was not kept, or that did not
+ * compile. The statements before it keep their code, and each statement
+ * records where the symbol table and IR generation were before it, so that
+ * they can be put back there.
+ *
+ * A statement with a parse error is kept without a tree, so that the next
+ * compile parses it again, and reports its error again.
+ */
+
+void incremental_initialize(struct incremental_program *program) {
+  memset(program, 0, sizeof(*program));
+  program->complete = true;
+  symbol_initialize_table(&program->symbol_table);
+}
+
+/*
+ * incremental_drop - free the tree and code of a statement, as when one
+ * taken out by incremental_begin is not added back
+ */
+void incremental_drop(struct incremental_statement *statement) {
+  if (statement->compiled) {
+    ir_destroy_instructions(&statement->ir);
+    statement->compiled = false;
+  }
+  node_destroy(statement->tree);
+  statement->tree = NULL;
+}
+
+void incremental_destroy(struct incremental_program *program) {
+  size_t i;
+
+  for (i = 0; i < program->count; i++) {
+    incremental_drop(&program->statements[i]);
+  }
+  free(program->statements);
+  symbol_destroy_table(&program->symbol_table);
+  free(program->source);
+  free(program->flags);
+}
+
+/* Whether text holds nothing but what the scanner skips. */
+bool incremental_is_blank(char const *text, size_t length) {
+  size_t i;
+
+  for (i = 0; i < length; i++) {
+    if (NULL == strchr(" \t\v\f\n", text[i]) || '\0' == text[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static uint32_t incremental_end_of(struct incremental_statement *statement) {
+  return statement->offset + statement->length;
+}
+
+/*
+ * incremental_plan - find what a compile of source can keep of the last
+ * compile
+ *
+ * Only a compile with the same flags is kept. Everything else is
+ * forgotten, and the plan is to parse the whole of source.
+ */
+void incremental_plan(struct incremental_program *program, char const *flags, char const *source, size_t length,
+                      struct incremental_plan *plan) {
+  size_t common, prefix = 0, suffix = 0, i;
+  char const *old = program->source;
+
+  if (NULL == program->flags || 0 != strcmp(flags, program->flags)) {
+    incremental_destroy(program);
+    incremental_initialize(program);
+    program->flags = strdup(flags);
+    assert(NULL != program->flags);
+  }
+
+  common = length < program->length ? length : program->length;
+  while (prefix < common && old[prefix] == source[prefix]) {
+    prefix++;
+  }
+  while (suffix < common - prefix && old[program->length - 1 - suffix] == source[length - 1 - suffix]) {
+    suffix++;
+  }
+
+  for (plan->kept = 0; plan->kept < program->count; plan->kept++) {
+    if (incremental_end_of(&program->statements[plan->kept]) > prefix || NULL == program->statements[plan->kept].tree) {
+      break;
+    }
+  }
+
+  /*
+   * The moved statements follow the last one without a tree. Text after the
+   * last statement is parsed again, since it ends in an error.
+   */
+  plan->suffix = program->count;
+  for (i = program->count; i > plan->kept && program->complete; i--) {
+    if (program->statements[i - 1].offset <= program->length - suffix || NULL == program->statements[i - 1].tree) {
+      break;
+    }
+    plan->suffix = i - 1;
+  }
+  plan->delta = (int32_t)(length - program->length);
+  if (plan->suffix < program->count) {
+    plan->end = program->statements[plan->suffix].offset + plan->delta;
+  } else {
+    plan->end = (uint32_t)length;
+  }
+
+  /*
+   * The parse of the text in between starts with the last statement kept
+   * before it, so that the parser is in the state it would be in after the
+   * statements before, and reports the same errors.
+   */
+  plan->start = 0 == plan->kept ? 0 : incremental_end_of(&program->statements[plan->kept - 1]);
+  if (plan->kept > 0 && !incremental_is_blank(source + plan->start, plan->end - plan->start)) {
+    plan->kept--;
+    plan->start = program->statements[plan->kept].offset;
+  }
+  for (plan->reused = 0; plan->reused < plan->kept; plan->reused++) {
+    if (!program->statements[plan->reused].compiled) {
+      break;
+    }
+  }
+}
+
+/*
+ * incremental_begin - start a compile that follows plan
+ *
+ * The statements that are parsed again are freed, and the code of the ones
+ * whose later stages run again. The symbol table is put back to where it
+ * was before the first of those, and checkpoint is set to it. The
+ * statements that are moved are taken out, and returned in an array of
+ * suffix_count to be added back once the text before them is parsed.
+ */
+struct incremental_statement *incremental_begin(struct incremental_program *program, struct incremental_plan *plan,
+                                                size_t *suffix_count, struct incremental_checkpoint *checkpoint) {
+  struct incremental_statement *suffix;
+  size_t i;
+
+  *checkpoint = plan->reused < program->count ? program->statements[plan->reused].before : program->end;
+  symbol_rewind_table(&program->symbol_table, checkpoint->symbols);
+
+  for (i = plan->reused; i < program->count; i++) {
+    if (program->statements[i].compiled) {
+      ir_destroy_instructions(&program->statements[i].ir);
+      program->statements[i].compiled = false;
+    }
+  }
+  for (i = plan->kept; i < plan->suffix; i++) {
+    incremental_drop(&program->statements[i]);
+  }
+
+  *suffix_count = program->count - plan->suffix;
+  suffix = malloc((*suffix_count + 1) * sizeof(struct incremental_statement));
+  assert(NULL != suffix);
+  memcpy(suffix, program->statements + plan->suffix, *suffix_count * sizeof(struct incremental_statement));
+  for (i = 0; i < *suffix_count; i++) {
+    suffix[i].offset += plan->delta;
+  }
+  program->count = plan->kept;
+
+  program->statistics.reused = plan->reused;
+  program->statistics.reparsed = 0;
+  program->statistics.recompiled = 0;
+  return suffix;
+}
+
+/*
+ * incremental_add - add the statement that follows the last one
+ *
+ * The program takes tree, which must be as the parser built it when the
+ * statement began at parsed_offset.
+ */
+struct incremental_statement *incremental_add(struct incremental_program *program, uint32_t offset, uint32_t length,
+                                              uint32_t parsed_offset, struct node *tree) {
+  struct incremental_statement *statement;
+
+  if (program->count == program->capacity) {
+    program->capacity = program->capacity ? program->capacity * 2 : 256;
+    program->statements = realloc(program->statements, program->capacity * sizeof(struct incremental_statement));
+    assert(NULL != program->statements);
+  }
+  statement = &program->statements[program->count++];
+  statement->offset = offset;
+  statement->length = length;
+  statement->parsed_offset = parsed_offset;
+  statement->tree = tree;
+  statement->compiled = false;
+  return statement;
+}
+
+/*
+ * incremental_finish - record the source of the compile, which the program
+ * takes, and where the stages after parsing got to at its end
+ *
+ * The statements are complete when the parse reached the end of the source
+ * and nothing but blanks follow the last of them.
+ */
+void incremental_finish(struct incremental_program *program, char *source, size_t length,
+                        struct incremental_checkpoint *end) {
+  uint32_t last = 0 == program->count ? 0 : incremental_end_of(&program->statements[program->count - 1]);
+
+  free(program->source);
+  program->source = source;
+  program->length = length;
+  program->complete = program->complete && incremental_is_blank(source + last, length - last);
+  program->end = *end;
+  program->statistics.statements = program->count;
+}
+
+void incremental_print_statistics(FILE *output, struct incremental_program *program) {
+  fprintf(output, "incremental: %lu statements, %lu reused, %lu parsed again, %lu compiled again from kept trees\n",
+          program->statistics.statements, program->statistics.reused, program->statistics.reparsed,
+          program->statistics.recompiled);
+}
@@ -0,0 +1,91 @@
+#ifndef _INCREMENTAL_H
+#define _INCREMENTAL_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ir.h"
+#include "symbol.h"
+
+struct node;
+
+/* Where the stages after parsing had got to before a statement. */
+struct incremental_checkpoint {
+  unsigned int symbols;
+  struct ir_position ir;
+  unsigned long balanced;
+};
+
+/*
+ * A statement of the last compile. Its span runs from the end of the
+ * statement before it through its semicolon, and its tree is a copy made
+ * before any stage ran over it, with the locations it had when it was
+ * parsed at parsed_offset.
+ */
+struct incremental_statement {
+  uint32_t offset;
+  uint32_t length;
+  uint32_t parsed_offset;
+  struct node *tree;
+  struct incremental_checkpoint before;
+  bool compiled;
+  struct ir_section ir;
+};
+
+struct incremental_program {
+  char *flags;
+  char *source;
+  size_t length;
+
+  /* Whether the statements reach the end of the source, but for blanks. */
+  bool complete;
+  struct incremental_statement *statements;
+  size_t count;
+  size_t capacity;
+
+  struct symbol_table symbol_table;
+  struct incremental_checkpoint end;
+
+  struct {
+    unsigned long statements;
+    unsigned long reused;
+    unsigned long reparsed;
+    unsigned long recompiled;
+  } statistics;
+};
+
+/*
+ * What a compile of an edited source can keep of the last one. The first
+ * kept statements are where they were, and the code of the first reused of
+ * them is reused. The source from start to end is parsed again. The
+ * statements from suffix on follow it, moved by delta.
+ */
+struct incremental_plan {
+  size_t reused;
+  size_t kept;
+  uint32_t start;
+  uint32_t end;
+  size_t suffix;
+  int32_t delta;
+};
+
+void incremental_initialize(struct incremental_program *program);
+void incremental_destroy(struct incremental_program *program);
+
+void incremental_plan(struct incremental_program *program, char const *flags, char const *source, size_t length,
+                      struct incremental_plan *plan);
+struct incremental_statement *incremental_begin(struct incremental_program *program, struct incremental_plan *plan,
+                                                size_t *suffix_count, struct incremental_checkpoint *checkpoint);
+struct incremental_statement *incremental_add(struct incremental_program *program, uint32_t offset, uint32_t length,
+                                              uint32_t parsed_offset, struct node *tree);
+void incremental_drop(struct incremental_statement *statement);
+void incremental_finish(struct incremental_program *program, char *source, size_t length,
+                        struct incremental_checkpoint *end);
+
+bool incremental_is_blank(char const *text, size_t length);
+
+void incremental_print_statistics(FILE *output, struct incremental_program *program);
+
+#endif /* _INCREMENTAL_H */
@@ -7,6 +7,12 @@
 #include "symbol.h"
 #include "type.h"
 #include "ir.h"
+#include "arena.h"
+
+/* Values are 32 bits, and immediates 16 bits sign-extended. */
+#define IR_MASK 0xFFFFFFFFul
+#define IR_IMMEDIATE_MAX 0x7FFFul
+#define IR_IMMEDIATE_MIN 0xFFFF8000ul
 
 /************************
  * CREATE IR STRUCTURES *
@@ -18,8 +24,7 @@
  */
 static struct ir_section *ir_section(struct ir_instruction *first, struct ir_instruction *last) {
   struct ir_section *code;
-  code = malloc(sizeof(struct ir_section));
-  assert(NULL != code);
+  code = arena_allocate(sizeof(struct ir_section));
 
   code->first = first;
   code->last = last;
@@ -66,14 +71,20 @@ static struct ir_section *ir_append(struct ir_section *section,
   return section;
 }
 
+static void ir_prepend(struct ir_section *section, struct ir_instruction *instruction) {
+  instruction->prev = NULL;
+  instruction->next = section->first;
+  section->first->prev = instruction;
+  section->first = instruction;
+}
+
 /*
  * An IR instruction represents a single 3-address statement.
  */
 static struct ir_instruction *ir_instruction(enum ir_instruction_kind kind) {
   struct ir_instruction *instruction;
 
-  instruction = malloc(sizeof(struct ir_instruction));
-  assert(NULL != instruction);
+  instruction = arena_allocate(sizeof(struct ir_instruction));
 
   instruction->kind = kind;
 
@@ -88,16 +99,244 @@ static void ir_operand_number(struct ir_instruction *instruction, int position,
   instruction->operands[position].data.number = number->data.number.value;
 }
 
+/* Temporaries are numbered across the whole program. */
+static int ir_next_temporary;
+
 static void ir_operand_temporary(struct ir_instruction *instruction, int position) {
-  static int next_temporary;
   instruction->operands[position].kind = OPERAND_TEMPORARY;
-  instruction->operands[position].data.temporary = next_temporary++;
+  instruction->operands[position].data.temporary = ir_next_temporary++;
 }
 
 static void ir_operand_copy(struct ir_instruction *instruction, int position, struct ir_operand *operand) {
   instruction->operands[position] = *operand;
 }
 
+/*
+ * Symbols keep their own copy of the operand that holds their value, so that
+ * the instructions that defined them can be freed.
+ */
+static struct ir_operand *ir_operand_for_symbol(struct ir_operand *operand) {
+  struct ir_operand *copy;
+
+  copy = arena_allocate(sizeof(struct ir_operand));
+
+  *copy = *operand;
+  return copy;
+}
+
+/***************************************
+ * ORDER THE EVALUATION OF EXPRESSIONS *
+ ***************************************/
+
+/*
+ * Before generating code for an expression, each of its nodes is labelled
+ * with the number of temporaries that must be live at once to evaluate it:
+ * its Ershov number, counting only the temporaries that hold intermediate
+ * results. An identifier needs none, since its value is already in the
+ * temporary of its variable, and neither does the result of an assignment.
+ *
+ * Evaluating the operand that needs more temporaries first means the value
+ * of the other operand is held for less time (Sethi and Ullman). Operands are
+ * only swapped when neither of them assigns, so side effects keep their order.
+ *
+ * Each node is also labelled with its critical path: the cycles from the
+ * start of the expression until its value is ready, if every instruction
+ * issued as soon as its operands were.
+ */
+struct ir_label {
+  int temporaries;
+  int temporaries_in_order;
+  int held;
+  bool side_effects;
+  unsigned long cycles;
+};
+
+struct ir_labeling {
+  struct ir_label *labels;
+  size_t count;
+  size_t capacity;
+};
+
+static struct {
+  unsigned long statements;
+  int max_temporaries;
+  int max_temporaries_in_order;
+  unsigned long total_temporaries;
+  unsigned long total_temporaries_in_order;
+  unsigned long max_cycles;
+  unsigned long total_cycles;
+} ir_statistics;
+
+/* The operation an assignment performs before storing its result. */
+static int ir_performed_operation(int operation) {
+  if (node_is_assignment(operation) && BINOP_ASSIGN != operation) {
+    return node_assigned_operation(operation);
+  }
+  return operation;
+}
+
+/*
+ * ir_immediate - whether the right operand of an operation is a constant its
+ * instruction can hold, so that it needs no code or temporary of its own
+ *
+ * Additions and subtractions of constants that fit in 16 signed bits become
+ * an addiu, and shifts by less than 32 an sll or srl. The value the
+ * instruction holds is stored in immediate when it is not NULL.
+ */
+bool ir_immediate(struct node *binary_operation, unsigned long *immediate) {
+  struct node *right = binary_operation->data.binary_operation.right_operand;
+  unsigned long value;
+
+  if (NODE_NUMBER != right->kind || right->data.number.overflow) {
+    return false;
+  }
+  value = right->data.number.value & IR_MASK;
+  switch (ir_performed_operation(binary_operation->data.binary_operation.operation)) {
+    case BINOP_SUBTRACTION:
+      value = (0 - value) & IR_MASK;
+      /* fall through */
+    case BINOP_ADDITION:
+      if (value > IR_IMMEDIATE_MAX && value < IR_IMMEDIATE_MIN) {
+        return false;
+      }
+      break;
+    case BINOP_LEFT_SHIFT:
+    case BINOP_RIGHT_SHIFT:
+      if (value >= 32) {
+        return false;
+      }
+      break;
+    default:
+      return false;
+  }
+  if (NULL != immediate) {
+    *immediate = value;
+  }
+  return true;
+}
+
+/*
+ * The cycles before the result of an operation can be used, as on an R4000:
+ * multiplies and divides go through the HI/LO unit.
+ */
+static unsigned long ir_latency(enum node_binary_operation operation) {
+  switch (operation) {
+    case BINOP_MULTIPLICATION:
+      return 10;
+    case BINOP_DIVISION:
+      return 69;
+    default:
+      return 1;
+  }
+}
+
+/* The temporaries needed to evaluate first, then second, then the operation. */
+static int ir_temporaries_for(int first, int first_held, int second) {
+  int temporaries = first_held + second;
+  if (first > temporaries) {
+    temporaries = first;
+  }
+  return temporaries > 1 ? temporaries : 1;
+}
+
+static enum node_walk ir_label_expression(struct node *expression, enum node_visit visit, void *context) {
+  struct ir_labeling *labeling = context;
+  struct ir_label label, left, right;
+  int left_first, right_first, operation;
+
+  if (NODE_VISIT_POST != visit) {
+    return NODE_WALK_OPERANDS;
+  }
+
+  switch (expression->kind) {
+    case NODE_NUMBER:
+      label.temporaries = label.temporaries_in_order = label.held = 1;
+      label.side_effects = false;
+      label.cycles = 1;
+      break;
+
+    case NODE_IDENTIFIER:
+      label.temporaries = label.temporaries_in_order = label.held = 0;
+      label.side_effects = false;
+      label.cycles = 0;
+      break;
+
+    case NODE_BINARY_OPERATION:
+      assert(labeling->count >= 2);
+      right = labeling->labels[--labeling->count];
+      left = labeling->labels[--labeling->count];
+      operation = expression->data.binary_operation.operation;
+      if (ir_immediate(expression, NULL)) {
+        /* The constant is part of the instruction. */
+        right.temporaries = right.temporaries_in_order = right.held = 0;
+        right.cycles = 0;
+      }
+      label.cycles = (left.cycles > right.cycles ? left.cycles : right.cycles)
+                   + ir_latency(ir_performed_operation(operation));
+      if (BINOP_POST_INCREMENT == operation || BINOP_POST_DECREMENT == operation) {
+        /* The old value is copied out before the variable is updated. */
+        label.temporaries = label.temporaries_in_order = label.held = 1;
+        label.side_effects = true;
+        break;
+      } else if (node_is_assignment(operation)) {
+        label.temporaries = right.temporaries;
+        label.temporaries_in_order = right.temporaries_in_order;
+        label.held = 0;
+        label.side_effects = true;
+        break;
+      }
+
+      left_first = ir_temporaries_for(left.temporaries, left.held, right.temporaries);
+      right_first = ir_temporaries_for(right.temporaries, right.held, left.temporaries);
+      expression->data.binary_operation.evaluate_right_first =
+        right_first < left_first && !left.side_effects && !right.side_effects && !ir_immediate(expression, NULL);
+      label.temporaries = expression->data.binary_operation.evaluate_right_first ? right_first : left_first;
+      label.temporaries_in_order =
+        ir_temporaries_for(left.temporaries_in_order, left.held, right.temporaries_in_order);
+      label.held = 1;
+      label.side_effects = left.side_effects || right.side_effects;
+      break;
+
+    default:
+      assert(0);
+      return NODE_WALK_OPERANDS;
+  }
+
+  if (labeling->count == labeling->capacity) {
+    labeling->capacity = labeling->capacity ? labeling->capacity * 2 : 64;
+    labeling->labels = realloc(labeling->labels, labeling->capacity * sizeof(struct ir_label));
+    assert(NULL != labeling->labels);
+  }
+  labeling->labels[labeling->count++] = label;
+  return NODE_WALK_OPERANDS;
+}
+
+/* Label an expression and record the temporaries it needs. */
+static void ir_label_expression_statement(struct node *expression_statement) {
+  struct ir_labeling labeling;
+
+  labeling.labels = NULL;
+  labeling.count = labeling.capacity = 0;
+  node_walk_expression(expression_statement->data.expression_statement.expression,
+                       ir_label_expression, &labeling);
+  assert(1 == labeling.count);
+
+  ir_statistics.statements++;
+  ir_statistics.total_temporaries += labeling.labels[0].temporaries;
+  ir_statistics.total_temporaries_in_order += labeling.labels[0].temporaries_in_order;
+  ir_statistics.total_cycles += labeling.labels[0].cycles;
+  if (labeling.labels[0].cycles > ir_statistics.max_cycles) {
+    ir_statistics.max_cycles = labeling.labels[0].cycles;
+  }
+  if (labeling.labels[0].temporaries > ir_statistics.max_temporaries) {
+    ir_statistics.max_temporaries = labeling.labels[0].temporaries;
+  }
+  if (labeling.labels[0].temporaries_in_order > ir_statistics.max_temporaries_in_order) {
+    ir_statistics.max_temporaries_in_order = labeling.labels[0].temporaries_in_order;
+  }
+  free(labeling.labels);
+}
+
 /*******************************
  * GENERATE IR FOR EXPRESSIONS *
  *******************************/
@@ -122,23 +361,75 @@ static void ir_generate_for_identifier(struct node *identifier) {
   assert(NULL != identifier->data.identifier.symbol->result.ir_operand);
 }
 
-static void ir_generate_for_expression(struct node *expression);
+static enum ir_instruction_kind ir_instruction_kind_for(int operation, bool immediate) {
+  switch (operation) {
+    case BINOP_MULTIPLICATION:
+      return IR_MULTIPLY;
+    case BINOP_DIVISION:
+      return IR_DIVIDE;
+    case BINOP_ADDITION:
+      return immediate ? IR_ADD_IMMEDIATE : IR_ADD;
+    case BINOP_SUBTRACTION:
+      return immediate ? IR_ADD_IMMEDIATE : IR_SUBTRACT;
+    case BINOP_LEFT_SHIFT:
+      return immediate ? IR_SHIFT_LEFT_IMMEDIATE : IR_SHIFT_LEFT;
+    case BINOP_RIGHT_SHIFT:
+      return immediate ? IR_SHIFT_RIGHT_IMMEDIATE : IR_SHIFT_RIGHT;
+    case BINOP_BITWISE_AND:
+      return IR_AND;
+    case BINOP_BITWISE_XOR:
+      return IR_XOR;
+    case BINOP_BITWISE_OR:
+      return IR_OR;
+    default:
+      assert(0);
+      return IR_NO_OPERATION;
+  }
+}
 
-static void ir_generate_for_arithmetic_binary_operation(enum ir_instruction_kind kind, struct node *binary_operation) {
+/*
+ * ir_generate_for_operation - generate the operands of an operation and the
+ * instruction that performs it
+ *
+ * The result goes to target when it is not NULL, and to a new temporary
+ * otherwise. Returns the instruction.
+ */
+static struct ir_instruction *ir_generate_for_operation(struct node *binary_operation, struct ir_operand *target) {
+  struct node *left = binary_operation->data.binary_operation.left_operand;
+  struct node *right = binary_operation->data.binary_operation.right_operand;
   struct ir_instruction *instruction;
+  unsigned long immediate;
+  bool is_immediate;
   assert(NODE_BINARY_OPERATION == binary_operation->kind);
 
-  ir_generate_for_expression(binary_operation->data.binary_operation.left_operand);
-  ir_generate_for_expression(binary_operation->data.binary_operation.right_operand);
-
-  instruction = ir_instruction(kind);
-  ir_operand_temporary(instruction, 0);
-  ir_operand_copy(instruction, 1, node_get_result(binary_operation->data.binary_operation.left_operand)->ir_operand);
-  ir_operand_copy(instruction, 2, node_get_result(binary_operation->data.binary_operation.right_operand)->ir_operand);
+  is_immediate = ir_immediate(binary_operation, &immediate);
+  instruction = ir_instruction(ir_instruction_kind_for(ir_performed_operation(binary_operation->data.binary_operation.operation),
+                                                       is_immediate));
+  if (NULL == target) {
+    ir_operand_temporary(instruction, 0);
+  } else {
+    ir_operand_copy(instruction, 0, target);
+  }
+  ir_operand_copy(instruction, 1, node_get_result(left)->ir_operand);
 
-  binary_operation->ir = ir_concatenate(binary_operation->data.binary_operation.left_operand->ir,
-                                        binary_operation->data.binary_operation.right_operand->ir);
+  if (is_immediate) {
+    instruction->operands[2].kind = OPERAND_NUMBER;
+    instruction->operands[2].data.number = immediate;
+    binary_operation->ir = ir_copy(left->ir);
+  } else {
+    ir_operand_copy(instruction, 2, node_get_result(right)->ir_operand);
+    if (binary_operation->data.binary_operation.evaluate_right_first) {
+      binary_operation->ir = ir_concatenate(right->ir, left->ir);
+    } else {
+      binary_operation->ir = ir_concatenate(left->ir, right->ir);
+    }
+  }
   ir_append(binary_operation->ir, instruction);
+  return instruction;
+}
+
+static void ir_generate_for_arithmetic_binary_operation(struct node *binary_operation) {
+  struct ir_instruction *instruction = ir_generate_for_operation(binary_operation, NULL);
   binary_operation->data.binary_operation.result.ir_operand = &instruction->operands[0];
 }
 
@@ -147,15 +438,13 @@ static void ir_generate_for_simple_assignment(struct node *binary_operation) {
   struct node *left;
   assert(NODE_BINARY_OPERATION == binary_operation->kind);
 
-  ir_generate_for_expression(binary_operation->data.binary_operation.right_operand);
-
   left = binary_operation->data.binary_operation.left_operand;
   assert(NODE_IDENTIFIER == left->kind);
 
   instruction = ir_instruction(IR_COPY);
   if (NULL == left->data.identifier.symbol->result.ir_operand) {
     ir_operand_temporary(instruction, 0);
-    left->data.identifier.symbol->result.ir_operand = &instruction->operands[0];
+    left->data.identifier.symbol->result.ir_operand = ir_operand_for_symbol(&instruction->operands[0]);
   } else {
     ir_operand_copy(instruction, 0, left->data.identifier.symbol->result.ir_operand);
   }
@@ -167,37 +456,64 @@ static void ir_generate_for_simple_assignment(struct node *binary_operation) {
   binary_operation->data.binary_operation.result.ir_operand = &instruction->operands[0];
 }
 
-static void ir_generate_for_binary_operation(struct node *binary_operation) {
-  assert(NODE_BINARY_OPERATION == binary_operation->kind);
+/* A compound assignment operates on the variable's temporary in place. */
+static void ir_generate_for_compound_assignment(struct node *binary_operation) {
+  struct node *left = binary_operation->data.binary_operation.left_operand;
+  struct ir_instruction *instruction;
 
-  switch (binary_operation->data.binary_operation.operation) {
-    case BINOP_MULTIPLICATION:
-      ir_generate_for_arithmetic_binary_operation(IR_MULTIPLY, binary_operation);
-      break;
+  assert(NODE_IDENTIFIER == left->kind);
+  instruction = ir_generate_for_operation(binary_operation, left->data.identifier.symbol->result.ir_operand);
+  binary_operation->data.binary_operation.result.ir_operand = &instruction->operands[0];
+}
 
-    case BINOP_DIVISION:
-      ir_generate_for_arithmetic_binary_operation(IR_DIVIDE, binary_operation);
-      break;
+/* x++ and x-- copy the old value out, then update the variable in place. */
+static void ir_generate_for_postfix(struct node *binary_operation) {
+  struct node *left = binary_operation->data.binary_operation.left_operand;
+  struct ir_instruction *copy;
 
-    case BINOP_ADDITION:
-      ir_generate_for_arithmetic_binary_operation(IR_ADD, binary_operation);
-      break;
+  assert(NODE_IDENTIFIER == left->kind);
+  copy = ir_instruction(IR_COPY);
+  ir_operand_temporary(copy, 0);
+  ir_operand_copy(copy, 1, left->data.identifier.symbol->result.ir_operand);
 
-    case BINOP_SUBTRACTION:
-      ir_generate_for_arithmetic_binary_operation(IR_SUBTRACT, binary_operation);
-      break;
+  ir_generate_for_operation(binary_operation, left->data.identifier.symbol->result.ir_operand);
+  ir_prepend(binary_operation->ir, copy);
+  binary_operation->data.binary_operation.result.ir_operand = &copy->operands[0];
+}
 
-    case BINOP_ASSIGN:
-      ir_generate_for_simple_assignment(binary_operation);
-      break;
+static void ir_generate_for_binary_operation(struct node *binary_operation) {
+  int operation = binary_operation->data.binary_operation.operation;
+  assert(NODE_BINARY_OPERATION == binary_operation->kind);
 
-    default:
-      assert(0);
-      break;
+  if (BINOP_ASSIGN == operation) {
+    ir_generate_for_simple_assignment(binary_operation);
+  } else if (BINOP_POST_INCREMENT == operation || BINOP_POST_DECREMENT == operation) {
+    ir_generate_for_postfix(binary_operation);
+  } else if (node_is_assignment(operation)) {
+    ir_generate_for_compound_assignment(binary_operation);
+  } else {
+    ir_generate_for_arithmetic_binary_operation(binary_operation);
   }
 }
 
-static void ir_generate_for_expression(struct node *expression) {
+/*
+ * Operands are generated before the operations that use them, in the order
+ * chosen by labelling, except for the left operand of an assignment, which
+ * needs no code of its own, and constants held by the instruction.
+ */
+static enum node_walk ir_generate_for_expression(struct node *expression, enum node_visit visit, void *context) {
+  (void)context;
+  if (NODE_VISIT_PRE == visit) {
+    if (BINOP_ASSIGN == expression->data.binary_operation.operation) {
+      return NODE_WALK_RIGHT_OPERAND;
+    } else if (ir_immediate(expression, NULL)) {
+      return NODE_WALK_LEFT_OPERAND;
+    }
+    return expression->data.binary_operation.evaluate_right_first ? NODE_WALK_OPERANDS_REVERSED : NODE_WALK_OPERANDS;
+  } else if (NODE_VISIT_IN == visit) {
+    return NODE_WALK_OPERANDS;
+  }
+
   switch (expression->kind) {
     case NODE_IDENTIFIER:
       ir_generate_for_identifier(expression);
@@ -215,42 +531,134 @@ static void ir_generate_for_expression(struct node *expression) {
       assert(0);
       break;
   }
+  return NODE_WALK_OPERANDS;
 }
 
-static void ir_generate_for_expression_statement(struct node *expression_statement) {
+/*
+ * When profiling, every statement starts by counting itself. The statements
+ * are numbered in the order their code is generated, which is the order of
+ * the source.
+ */
+static struct {
+  bool enabled;
+  unsigned long statements;
+} ir_profiling;
+
+void ir_set_profiling(bool profiling) {
+  ir_profiling.enabled = profiling;
+}
+
+/*
+ * ir_reset - start a new program, numbering its temporaries and statements
+ * from 0, with the statistics cleared
+ */
+void ir_reset(void) {
+  ir_next_temporary = 0;
+  ir_profiling.statements = 0;
+  memset(&ir_statistics, 0, sizeof(ir_statistics));
+}
+
+/*
+ * ir_get_position - the numbers the next temporary and the next profiled
+ * statement will be given
+ *
+ * Setting a position taken earlier generates the statements that follow it
+ * again with the same numbers.
+ */
+struct ir_position ir_get_position(void) {
+  struct ir_position position;
+
+  position.temporary = ir_next_temporary;
+  position.statement = ir_profiling.statements;
+  return position;
+}
+
+void ir_set_position(struct ir_position position) {
+  ir_next_temporary = position.temporary;
+  ir_profiling.statements = position.statement;
+}
+
+void ir_generate_for_expression_statement(struct node *expression_statement) {
   struct ir_instruction *instruction;
   struct node *expression = expression_statement->data.expression_statement.expression;
   assert(NODE_EXPRESSION_STATEMENT == expression_statement->kind);
-  ir_generate_for_expression(expression);
+  ir_label_expression_statement(expression_statement);
+  node_walk_expression(expression, ir_generate_for_expression, NULL);
 
   instruction = ir_instruction(IR_PRINT_NUMBER);
   ir_operand_copy(instruction, 0, node_get_result(expression)->ir_operand);
 
   expression_statement->ir = ir_copy(expression_statement->data.expression_statement.expression->ir);
   ir_append(expression_statement->ir, instruction);
+
+  if (ir_profiling.enabled) {
+    instruction = ir_instruction(IR_PROFILE_COUNT);
+    instruction->operands[0].kind = OPERAND_NUMBER;
+    instruction->operands[0].data.number = ir_profiling.statements++;
+    ir_prepend(expression_statement->ir, instruction);
+  }
 }
 
-int ir_generate_for_statement_list(struct node *statement_list) {
+static enum node_walk ir_generate_for_statement(struct node *statement_list, enum node_visit visit, void *context) {
   struct node *init = statement_list->data.statement_list.init;
   struct node *statement = statement_list->data.statement_list.statement;
+  (void)visit;
+  (void)context;
 
-  assert(NODE_STATEMENT_LIST == statement_list->kind);
-
+  ir_generate_for_expression_statement(statement);
   if (NULL != init) {
-    ir_generate_for_statement_list(init);
-    ir_generate_for_expression_statement(statement);
     statement_list->ir = ir_concatenate(init->ir, statement->ir);
   } else {
-    ir_generate_for_expression_statement(statement);
-    statement_list->ir = statement->ir;
+    statement_list->ir = ir_copy(statement->ir);
   }
+  return NODE_WALK_OPERANDS;
+}
+
+int ir_generate_for_statement_list(struct node *statement_list) {
+  assert(NODE_STATEMENT_LIST == statement_list->kind);
+
+  node_walk_statement_list(statement_list, ir_generate_for_statement, NULL);
   return 0;
 }
 
+/*
+ * ir_destroy_instructions - free the instructions of a section
+ *
+ * The section itself belongs to the node it was generated for.
+ */
+void ir_destroy_instructions(struct ir_section *section) {
+  struct ir_instruction *iter, *next;
+
+  for (iter = section->first; NULL != iter; iter = next) {
+    next = iter->next;
+    arena_free(iter);
+    if (section->last == iter) {
+      break;
+    }
+  }
+}
+
 /***********************
  * PRINT IR STRUCTURES *
  ***********************/
 
+/*
+ * ir_print_statistics - print the temporaries needed per statement so far
+ *
+ * Each figure is given for the order the code was generated in, and for
+ * evaluating every left operand first. The critical path is the longest
+ * chain of dependent instructions in a statement, in cycles.
+ */
+void ir_print_statistics(FILE *output) {
+  fprintf(output, "ir: %lu statements, live temporaries per statement: max %d (left first %d), mean %.2f (left first %.2f)\n",
+          ir_statistics.statements, ir_statistics.max_temporaries, ir_statistics.max_temporaries_in_order,
+          ir_statistics.statements ? (double)ir_statistics.total_temporaries / ir_statistics.statements : 0.0,
+          ir_statistics.statements ? (double)ir_statistics.total_temporaries_in_order / ir_statistics.statements : 0.0);
+  fprintf(output, "ir: critical path per statement: max %lu cycles, mean %.2f cycles\n",
+          ir_statistics.max_cycles,
+          ir_statistics.statements ? (double)ir_statistics.total_cycles / ir_statistics.statements : 0.0);
+}
+
 static void ir_print_opcode(FILE *output, enum ir_instruction_kind kind) {
   static char const * const instruction_names[] = {
     "NOP",
@@ -261,6 +669,16 @@ static void ir_print_opcode(FILE *output, enum ir_instruction_kind kind) {
     "LI",
     "COPY",
     "PNUM",
+    "ADDI",
+    "SLLV",
+    "SRLV",
+    "SLL",
+    "SRL",
+    "AND",
+    "XOR",
+    "OR",
+    "DIVNZ",
+    "PROF",
     NULL
   };
 
@@ -284,8 +702,17 @@ static void ir_print_instruction(FILE *output, struct ir_instruction *instructio
   switch (instruction->kind) {
     case IR_MULTIPLY:
     case IR_DIVIDE:
+    case IR_DIVIDE_NONZERO:
     case IR_ADD:
     case IR_SUBTRACT:
+    case IR_ADD_IMMEDIATE:
+    case IR_SHIFT_LEFT:
+    case IR_SHIFT_RIGHT:
+    case IR_SHIFT_LEFT_IMMEDIATE:
+    case IR_SHIFT_RIGHT_IMMEDIATE:
+    case IR_AND:
+    case IR_XOR:
+    case IR_OR:
       ir_print_operand(output, &instruction->operands[0]);
       fprintf(output, ", ");
       ir_print_operand(output, &instruction->operands[1]);
@@ -299,6 +726,7 @@ static void ir_print_instruction(FILE *output, struct ir_instruction *instructio
       ir_print_operand(output, &instruction->operands[1]);
       break;
     case IR_PRINT_NUMBER:
+    case IR_PROFILE_COUNT:
       ir_print_operand(output, &instruction->operands[0]);
       break;
     case IR_NO_OPERATION:
@@ -29,7 +29,17 @@ enum ir_instruction_kind {
   IR_SUBTRACT,
   IR_LOAD_IMMEDIATE,
   IR_COPY,
-  IR_PRINT_NUMBER
+  IR_PRINT_NUMBER,
+  IR_ADD_IMMEDIATE,
+  IR_SHIFT_LEFT,
+  IR_SHIFT_RIGHT,
+  IR_SHIFT_LEFT_IMMEDIATE,
+  IR_SHIFT_RIGHT_IMMEDIATE,
+  IR_AND,
+  IR_XOR,
+  IR_OR,
+  IR_DIVIDE_NONZERO,
+  IR_PROFILE_COUNT
 };
 struct ir_instruction {
   enum ir_instruction_kind kind;
@@ -41,8 +51,23 @@ struct ir_section {
   struct ir_instruction *first, *last;
 };
 
+/* How far IR generation has got through a program. See ir_get_position. */
+struct ir_position {
+  int temporary;
+  unsigned long statement;
+};
+
+void ir_set_profiling(bool profiling);
+void ir_reset(void);
+struct ir_position ir_get_position(void);
+void ir_set_position(struct ir_position position);
+
 int ir_generate_for_statement_list(struct node *statement_list);
+void ir_generate_for_expression_statement(struct node *expression_statement);
+void ir_destroy_instructions(struct ir_section *section);
+bool ir_immediate(struct node *binary_operation, unsigned long *immediate);
 
 void ir_print_section(FILE *output, struct ir_section *section);
+void ir_print_statistics(FILE *output);
 
 #endif
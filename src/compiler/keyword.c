@@ -0,0 +1,104 @@
+/*
+ * keyword.c
+ *
+ * Recognizes the keywords of the language among the identifiers found by the
+ * scanner, so the scanner needs one pattern for both instead of one more per
+ * keyword.
+ *
+ * The lookup is a perfect hash in the style of gperf: a keyword's position in
+ * the table is its length plus a value given to its first character and one
+ * given to its last. The values were chosen, by searching, so that no two
+ * keywords collide and the table is as short as that search could make it.
+ * Characters that begin or end no keyword have a value larger than any
+ * position, so most identifiers are rejected without comparing any text.
+ *
+ * To add a keyword, search for new values again and rebuild both tables.
+ */
+
+#include <string.h>
+
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+typedef void* yyscan_t;
+#endif
+
+#include "compiler.h"
+#include "parser.tab.h"
+#include "keyword.h"
+
+#define KEYWORD_MIN_LENGTH 2
+#define KEYWORD_MAX_LENGTH 8
+#define KEYWORD_MAX_HASH 20
+
+struct keyword {
+  char const *name;
+  size_t length;
+  int token;
+};
+
+static unsigned char const keyword_values[256] = {
+  21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21,
+  21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21,
+  21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21,
+  21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21,
+  21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21,
+  21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21,
+  21, 21,  5,  2,  0,  3,  0,  4, 21,  7, 21,  1,  6, 21,  6,  0,
+  21, 21,  0, 10,  5, 10,  3, 11, 21, 21, 21, 21, 21, 21, 21, 21,
+  21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21,
+  21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21,
+  21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21,
+  21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21,
+  21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21,
+  21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21,
+  21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21,
+  21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21
+};
+
+static struct keyword const keyword_table[KEYWORD_MAX_HASH + 1] = {
+  { "", 0, 0 },
+  { "", 0, 0 },
+  { "do", 2, DO },
+  { "for", 3, FOR },
+  { "", 0, 0 },
+  { "", 0, 0 },
+  { "char", 4, CHAR },
+  { "void", 4, VOID },
+  { "goto", 4, GOTO },
+  { "if", 2, IF },
+  { "else", 4, ELSE },
+  { "break", 5, BREAK },
+  { "return", 6, RETURN },
+  { "continue", 8, CONTINUE },
+  { "long", 4, LONG },
+  { "int", 3, INT },
+  { "signed", 6, SIGNED },
+  { "", 0, 0 },
+  { "unsigned", 8, UNSIGNED },
+  { "while", 5, WHILE },
+  { "short", 5, SHORT }
+};
+
+/*
+ * keyword_token - the token for a keyword
+ *
+ * Returns 0 when the text, which need not be terminated, is not a keyword.
+ */
+int keyword_token(char const *text, size_t length) {
+  struct keyword const *keyword;
+  unsigned int hash;
+
+  if (length < KEYWORD_MIN_LENGTH || length > KEYWORD_MAX_LENGTH) {
+    return 0;
+  }
+  hash = length + keyword_values[(unsigned char)text[0]] + keyword_values[(unsigned char)text[length - 1]];
+  if (hash > KEYWORD_MAX_HASH) {
+    return 0;
+  }
+
+  keyword = &keyword_table[hash];
+  if (length != keyword->length || 0 != memcmp(text, keyword->name, length)) {
+    return 0;
+  }
+  return keyword->token;
+}
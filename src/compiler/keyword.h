@@ -0,0 +1,8 @@
+#ifndef _KEYWORD_H
+#define _KEYWORD_H
+
+#include <stddef.h>
+
+int keyword_token(char const *text, size_t length);
+
+#endif /* _KEYWORD_H */
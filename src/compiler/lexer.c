@@ -0,0 +1,456 @@
+/*
+ * lexer.c
+ *
+ * A hand-written scanner for the same language as scanner.lex, built instead
+ * of the flex scanner with "make SCANNER=simd". The flex DFA takes a step
+ * per byte, where most of the input is runs of blanks, letters and digits.
+ * This scanner finds the end of such a run by classifying a vector of bytes
+ * at once: 32 with AVX2, 16 with SSE2, and one at a time where neither is
+ * available.
+ *
+ * The input is read whole before the first token, into a buffer followed by
+ * LEXER_PADDING zero bytes, so that a vector may be loaded at any point up to
+ * the end of the input. A zero byte ends every run, and the scanner compares
+ * its position to the length of the input where flex would read more.
+ *
+ * The tokens, their locations and values are those of scanner.lex: the
+ * longest match, the first rule among matches of the same length, a line
+ * added at the offset after each newline, and -1 for a character no rule
+ * matches. As with flex, the location of the end of the input is that of the
+ * last blank before it, if there is one.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+typedef void* yyscan_t;
+#endif
+
+#include "compiler.h"
+#include "parser.tab.h"
+#include "lexer.h"
+#include "node.h"
+#include "type.h"
+#include "keyword.h"
+#include "location.h"
+#include "scanner.h"
+
+#define LEXER_PADDING 32
+#define LEXER_SHORT 8
+#define LEXER_INITIAL_CAPACITY 65536
+
+struct lexer {
+  FILE *input;
+  bool loaded;
+
+  /* The input, followed by LEXER_PADDING zero bytes. */
+  char *source;
+  size_t length;
+  size_t capacity;
+
+  /* Where the next token is looked for, and its offset, as yyextra is. */
+  size_t position;
+  uint32_t offset;
+
+  /* The text of the last token, for scanner_print_tokens. */
+  size_t text;
+  int leng;
+};
+
+/*
+ * The bytes of a run: the first digits of "0123456789" and the first
+ * letters of "abcdefghijklmnopqrstuvwxyz", in either case.
+ */
+struct lexer_class {
+  unsigned char digits;
+  unsigned char letters;
+};
+
+static struct lexer_class const lexer_identifier = { 10, 26 };
+static struct lexer_class const lexer_decimal = { 10, 0 };
+static struct lexer_class const lexer_octal = { 8, 0 };
+static struct lexer_class const lexer_hex = { 10, 6 };
+
+/* Setting the 0x20 bit makes an upper case letter lower case, and no other byte a letter. */
+static inline bool lexer_in_class(char c, struct lexer_class class) {
+  return (unsigned char)(c - '0') < class.digits || (unsigned char)((c | 0x20) - 'a') < class.letters;
+}
+
+/* The blanks are the space and the four characters from \t to \f, \n among them. */
+static inline bool lexer_is_blank(char c) {
+  return ' ' == c || (unsigned char)(c - '\t') < 4;
+}
+
+#if defined(__AVX2__)
+#define LEXER_WIDTH 32
+#define LEXER_ALL 0xFFFFFFFFu
+typedef __m256i lexer_vector;
+#define lexer_load(p) _mm256_loadu_si256((__m256i const *)(p))
+#define lexer_set(c) _mm256_set1_epi8((char)(c))
+#define lexer_subtract(a, b) _mm256_sub_epi8(a, b)
+#define lexer_minimum(a, b) _mm256_min_epu8(a, b)
+#define lexer_or(a, b) _mm256_or_si256(a, b)
+#define lexer_equal(a, b) _mm256_cmpeq_epi8(a, b)
+#define lexer_bits(v) ((uint32_t)_mm256_movemask_epi8(v))
+#elif defined(__SSE2__)
+#define LEXER_WIDTH 16
+#define LEXER_ALL 0xFFFFu
+typedef __m128i lexer_vector;
+#define lexer_load(p) _mm_loadu_si128((__m128i const *)(p))
+#define lexer_set(c) _mm_set1_epi8((char)(c))
+#define lexer_subtract(a, b) _mm_sub_epi8(a, b)
+#define lexer_minimum(a, b) _mm_min_epu8(a, b)
+#define lexer_or(a, b) _mm_or_si128(a, b)
+#define lexer_equal(a, b) _mm_cmpeq_epi8(a, b)
+#define lexer_bits(v) ((uint32_t)_mm_movemask_epi8(v))
+#endif
+
+#ifdef LEXER_WIDTH
+/*
+ * lexer_range - the bytes of x from first to first + count - 1
+ *
+ * Neither instruction set compares unsigned bytes, but a byte is at most
+ * count - 1 when the unsigned minimum of the two is the byte itself.
+ */
+static inline lexer_vector lexer_range(lexer_vector x, unsigned char first, unsigned char count) {
+  lexer_vector offset = lexer_subtract(x, lexer_set(first));
+  return lexer_equal(lexer_minimum(offset, lexer_set(count - 1)), offset);
+}
+
+/* A bit for each of the bytes at p, set when the byte is of class. */
+static inline uint32_t lexer_class_bits(char const *p, struct lexer_class class) {
+  lexer_vector x = lexer_load(p);
+  lexer_vector in = lexer_range(x, '0', class.digits);
+  if (0 != class.letters) {
+    in = lexer_or(in, lexer_range(lexer_or(x, lexer_set(0x20)), 'a', class.letters));
+  }
+  return lexer_bits(in);
+}
+
+/* A bit for each of the bytes at p, set when the byte is a blank, and another for a newline. */
+static inline uint32_t lexer_blank_bits(char const *p, uint32_t *newlines) {
+  lexer_vector x = lexer_load(p);
+  *newlines = lexer_bits(lexer_equal(x, lexer_set('\n')));
+  return lexer_bits(lexer_or(lexer_equal(x, lexer_set(' ')), lexer_range(x, '\t', 4)));
+}
+#endif
+
+/*
+ * lexer_span - the end of the run of class that starts at p
+ *
+ * Most runs are a name or a constant of a few characters, which are found
+ * sooner a byte at a time than with a vector, so the vectors start after the
+ * first LEXER_SHORT bytes.
+ */
+static inline char *lexer_span(char *p, struct lexer_class class) {
+#ifdef LEXER_WIDTH
+  char *short_end = p + LEXER_SHORT;
+  uint32_t bits;
+
+  for (; p < short_end; p++) {
+    if (!lexer_in_class(*p, class)) {
+      return p;
+    }
+  }
+  while (LEXER_ALL == (bits = lexer_class_bits(p, class))) {
+    p += LEXER_WIDTH;
+  }
+  return p + __builtin_ctz(~bits);
+#else
+  while (lexer_in_class(*p, class)) {
+    p++;
+  }
+  return p;
+#endif
+}
+
+/*
+ * lexer_skip_blanks - the end of the run of blanks that starts at p, where
+ * the offset is offset
+ *
+ * A line is added for each newline of the run, and location is set to its
+ * last blank, as the flex scanner matches each blank as a token of its own.
+ * As with lexer_span, the vectors start after the first LEXER_SHORT bytes.
+ */
+static char *lexer_skip_blanks(char *p, uint32_t offset, YYLTYPE *location) {
+  char *start = p;
+#ifdef LEXER_WIDTH
+  char *short_end = p + LEXER_SHORT;
+  uint32_t bits, newlines;
+  int count;
+#endif
+
+  if (!lexer_is_blank(*p)) {
+    return p;
+  }
+  for (; lexer_is_blank(*p); p++) {
+#ifdef LEXER_WIDTH
+    if (p == short_end) {
+      break;
+    }
+#endif
+    if ('\n' == *p) {
+      location_add_line(offset + (uint32_t)(p - start) + 1);
+    }
+  }
+#ifdef LEXER_WIDTH
+  if (p == short_end) {
+    do {
+      bits = lexer_blank_bits(p, &newlines);
+      count = LEXER_WIDTH;
+      if (LEXER_ALL != bits) {
+        count = __builtin_ctz(~bits);
+        newlines &= (1u << count) - 1;
+      }
+      for (; 0 != newlines; newlines &= newlines - 1) {
+        location_add_line(offset + (uint32_t)(p - start) + __builtin_ctz(newlines) + 1);
+      }
+      p += count;
+    } while (LEXER_WIDTH == count);
+  }
+#endif
+  location->offset = offset + (uint32_t)(p - start) - 1;
+  location->length = 1;
+  return p;
+}
+
+/* lexer_operator - the token of an operator that may be followed by "=", or doubled */
+static int lexer_operator(char **end, int token, int equal_token, int double_token) {
+  if ('=' == **end && 0 != equal_token) {
+    (*end)++;
+    return equal_token;
+  }
+  if ((*end)[-1] == **end && 0 != double_token) {
+    (*end)++;
+    return double_token;
+  }
+  return token;
+}
+
+/* lexer_shift - the token of "<<" or ">>", which may be followed by "=" */
+static int lexer_shift(char **end, int token, int equal_token) {
+  if ((*end)[-1] != **end) {
+    return -1;
+  }
+  (*end)++;
+  if ('=' == **end) {
+    (*end)++;
+    return equal_token;
+  }
+  return token;
+}
+
+/* lexer_number - the end of a constant, with its suffix */
+static char *lexer_number(char *start) {
+  char *end;
+
+  if ('0' == start[0] && 'x' == (start[1] | 0x20) && lexer_in_class(start[2], lexer_hex)) {
+    end = lexer_span(start + 2, lexer_hex);
+  } else if ('0' == start[0]) {
+    end = lexer_span(start + 1, lexer_octal);
+  } else {
+    end = lexer_span(start + 1, lexer_decimal);
+  }
+
+  if ('u' == (*end | 0x20)) {
+    end++;
+    if ('l' == (*end | 0x20)) {
+      end++;
+    }
+  } else if ('l' == (*end | 0x20)) {
+    end++;
+    if ('u' == (*end | 0x20)) {
+      end++;
+    }
+  }
+  return end;
+}
+
+static void lexer_read(struct lexer *lexer) {
+  size_t count;
+
+  lexer->length = 0;
+  do {
+    if (lexer->capacity - lexer->length <= LEXER_PADDING) {
+      lexer->capacity = lexer->capacity ? lexer->capacity * 2 : LEXER_INITIAL_CAPACITY;
+      lexer->source = realloc(lexer->source, lexer->capacity);
+      assert(NULL != lexer->source);
+    }
+    count = fread(lexer->source + lexer->length, 1, lexer->capacity - lexer->length - LEXER_PADDING, lexer->input);
+    lexer->length += count;
+  } while (0 != count);
+  memset(lexer->source + lexer->length, 0, LEXER_PADDING);
+  lexer->loaded = true;
+}
+
+int yylex(YYSTYPE *yylval_param, YYLTYPE *yylloc_param, yyscan_t scanner) {
+  struct lexer *lexer = scanner;
+  char *position, *start, *end;
+  int token, keyword;
+
+  if (!lexer->loaded) {
+    lexer_read(lexer);
+  }
+  position = lexer->source + lexer->position;
+  start = lexer_skip_blanks(position, lexer->offset, yylloc_param);
+  lexer->offset += (uint32_t)(start - position);
+  lexer->position = start - lexer->source;
+  if (lexer->position >= lexer->length) {
+    return 0;
+  }
+
+  end = start + 1;
+  switch (*start) {
+    case '*': token = lexer_operator(&end, ASTERISK, ASTERISK_EQUAL, 0); break;
+    case '+': token = lexer_operator(&end, PLUS, PLUS_EQUAL, PLUS_PLUS); break;
+    case '-': token = lexer_operator(&end, MINUS, MINUS_EQUAL, MINUS_MINUS); break;
+    case '/': token = lexer_operator(&end, SLASH, SLASH_EQUAL, 0); break;
+    case '&': token = lexer_operator(&end, AMPERSAND, AMPERSAND_EQUAL, 0); break;
+    case '^': token = lexer_operator(&end, CARET, CARET_EQUAL, 0); break;
+    case '|': token = lexer_operator(&end, VBAR, VBAR_EQUAL, 0); break;
+    case '<': token = lexer_shift(&end, LESS_LESS, LESS_LESS_EQUAL); break;
+    case '>': token = lexer_shift(&end, GREATER_GREATER, GREATER_GREATER_EQUAL); break;
+    case '=': token = EQUAL; break;
+    case '(': token = LEFT_PAREN; break;
+    case ')': token = RIGHT_PAREN; break;
+    case ';': token = SEMICOLON; break;
+
+    case '0': case '1': case '2': case '3': case '4':
+    case '5': case '6': case '7': case '8': case '9':
+      token = NUMBER;
+      end = lexer_number(start);
+      break;
+
+    default:
+      token = -1;
+      if (lexer_in_class(*start, lexer_identifier)) {
+        token = IDENTIFIER;
+        end = lexer_span(end, lexer_identifier);
+      }
+      break;
+  }
+
+  yylloc_param->offset = lexer->offset;
+  yylloc_param->length = (uint32_t)(end - start);
+  lexer->offset += yylloc_param->length;
+  lexer->position = end - lexer->source;
+  lexer->text = start - lexer->source;
+  lexer->leng = (int)(end - start);
+
+  if (NUMBER == token) {
+    *yylval_param = node_number(*yylloc_param, start, lexer->leng);
+  } else if (IDENTIFIER == token) {
+    keyword = keyword_token(start, lexer->leng);
+    if (0 != keyword) {
+      return keyword;
+    }
+    *yylval_param = node_identifier(*yylloc_param, start, lexer->leng);
+  }
+  return token;
+}
+
+void scanner_initialize(yyscan_t *scanner, FILE *input) {
+  struct lexer *lexer = calloc(1, sizeof(struct lexer));
+  assert(NULL != lexer);
+  lexer->input = input;
+  *scanner = lexer;
+  location_start_source();
+}
+
+/*
+ * scanner_restart - scan a new input with a scanner that already scanned one
+ *
+ * The scanner keeps the buffer it read the last input into.
+ */
+void scanner_restart(yyscan_t scanner, FILE *input) {
+  struct lexer *lexer = scanner;
+  lexer->input = input;
+  lexer->loaded = false;
+  lexer->position = 0;
+  lexer->offset = 0;
+  location_start_source();
+}
+
+/*
+ * scanner_start_at - take the input to be the part of its source that
+ * begins at offset
+ *
+ * The lines of the source before offset must be added by the caller.
+ */
+void scanner_start_at(yyscan_t scanner, uint32_t offset) {
+  struct lexer *lexer = scanner;
+  lexer->offset = offset;
+}
+
+void scanner_destroy(yyscan_t *scanner) {
+  struct lexer *lexer = *scanner;
+  free(lexer->source);
+  free(lexer);
+  *scanner = NULL;
+}
+
+void scanner_print_tokens(FILE *output, int *error_count, yyscan_t scanner) {
+  struct lexer *lexer = scanner;
+  struct location_lines lines;
+  YYSTYPE val;
+  YYLTYPE loc;
+  int token;
+
+  token = yylex(&val, &loc, scanner);
+  while (0 != token) {
+    /*
+     * Print the line number. Use printf formatting and tabs to keep columns
+     * lined up.
+     */
+    lines = location_find_lines(loc);
+    fprintf(output, "loc = %04d:%04d-%04d:%04d",
+            lines.first_line, lines.first_column, lines.last_line, lines.last_column);
+
+    /*
+     * Print the scanned text. Try to use formatting but give up instead of
+     * truncating if the text is too long. The text is not terminated, so its
+     * length is given as the precision.
+     */
+    if (lexer->leng <= 20) {
+      fprintf(output, "     text = %-20.*s", lexer->leng, lexer->source + lexer->text);
+    } else {
+      fprintf(output, "     text = %.*s", lexer->leng, lexer->source + lexer->text);
+    }
+
+    if (token <= 0) {
+      fputs("     token = ERROR", output);
+      (*error_count)++;
+    } else {
+      fprintf(output, "     token = [%-20s]", parser_token_name(token));
+
+      switch (token) {
+        case NUMBER:
+          /* Print the type and value. */
+          fputs("     type = ", output);
+          type_print(output, val->data.number.result.type);
+          fprintf(output, "     value = [%-10lu]", val->data.number.value);
+          if (val->data.number.overflow) {
+            fputs("     OVERFLOW", output);
+            (*error_count)++;
+          }
+          break;
+
+        case IDENTIFIER:
+          fprintf(output, "     name = %s", val->data.identifier.name);
+          break;
+      }
+    }
+    fputs("\n", output);
+    token = yylex(&val, &loc, scanner);
+  }
+}
@@ -0,0 +1,19 @@
+#ifndef _LEXER_H
+#define _LEXER_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+ * What the parsers use of the header flex writes for scanner.lex, for the
+ * build with the hand-written scanner of lexer.c in its place.
+ */
+
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+typedef void* yyscan_t;
+#endif
+
+int yylex(YYSTYPE *yylval_param, YYLTYPE *yylloc_param, yyscan_t scanner);
+
+#endif /* _LEXER_H */
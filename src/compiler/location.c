@@ -0,0 +1,129 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <stdatomic.h>
+
+#include "compiler.h"
+#include "location.h"
+
+/*
+ * Locations are kept as the byte offset and length of their text in the
+ * source, and only turned into lines and columns when an error or a dump
+ * prints them. For that the scanner records where each line of the source
+ * begins as it goes.
+ *
+ * There is one source at a time. Its table is kept until the next source is
+ * started, since errors about a statement can be reported after the scanner
+ * has moved past it.
+ *
+ * In a pipelined compile the scanner adds lines on one thread while errors
+ * look them up on another. The array and the count are published with
+ * release stores, and an array that is outgrown is kept until the next
+ * source starts, since a reader may still be searching it.
+ */
+#define LOCATION_MAX_RETIRED 64
+
+static struct {
+  uint32_t *_Atomic starts;
+  atomic_size_t count;
+  size_t capacity;
+  uint32_t *retired[LOCATION_MAX_RETIRED];
+  size_t retired_count;
+} location_table;
+
+/*
+ * location_start_source - forget the lines of the previous source
+ *
+ * The first line begins at offset 0.
+ */
+void location_start_source(void) {
+  size_t i;
+
+  for (i = 0; i < location_table.retired_count; i++) {
+    free(location_table.retired[i]);
+  }
+  location_table.retired_count = 0;
+  atomic_store_explicit(&location_table.count, 0, memory_order_relaxed);
+  location_add_line(0);
+}
+
+/*
+ * location_add_line - record that a line begins at offset
+ *
+ * Lines are added in the order they appear.
+ */
+void location_add_line(uint32_t offset) {
+  size_t count = atomic_load_explicit(&location_table.count, memory_order_relaxed);
+  uint32_t *starts = atomic_load_explicit(&location_table.starts, memory_order_relaxed), *grown;
+
+  assert(0 == count || offset > starts[count - 1]);
+  if (count == location_table.capacity) {
+    location_table.capacity = location_table.capacity ? location_table.capacity * 2 : 1024;
+    grown = malloc(location_table.capacity * sizeof(uint32_t));
+    assert(NULL != grown);
+    if (NULL != starts) {
+      memcpy(grown, starts, count * sizeof(uint32_t));
+      assert(location_table.retired_count < LOCATION_MAX_RETIRED);
+      location_table.retired[location_table.retired_count++] = starts;
+    }
+    atomic_store_explicit(&location_table.starts, grown, memory_order_release);
+    starts = grown;
+  }
+  starts[count] = offset;
+  atomic_store_explicit(&location_table.count, count + 1, memory_order_release);
+}
+
+/* The line, counted from 0, that holds offset. */
+static size_t location_find_line(uint32_t const *starts, size_t count, uint32_t offset) {
+  size_t low = 0, high = count, middle;
+
+  /* Find the last line that begins at or before offset. */
+  while (high - low > 1) {
+    middle = low + (high - low) / 2;
+    if (starts[middle] <= offset) {
+      low = middle;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+/*
+ * location_find_lines - the lines and columns of the first and last
+ * characters of a location
+ *
+ * A location with no text, like the one before the first token is read, is
+ * on no line: every field is 0. Without a source, as when the compiler
+ * resumes from an image, the whole input is taken to be one line.
+ */
+struct location_lines location_find_lines(YYLTYPE location) {
+  struct location_lines lines = { 0, 0, 0, 0 };
+  uint32_t last = location.offset + location.length - 1;
+  uint32_t const *starts;
+  size_t count, line;
+
+  if (0 == location.length) {
+    return lines;
+  }
+  if (0 == atomic_load_explicit(&location_table.count, memory_order_relaxed)) {
+    location_start_source();
+  }
+
+  /* The count first: any array published after it holds as many lines. */
+  count = atomic_load_explicit(&location_table.count, memory_order_acquire);
+  starts = atomic_load_explicit(&location_table.starts, memory_order_acquire);
+
+  line = location_find_line(starts, count, location.offset);
+  lines.first_line = (int)line + 1;
+  lines.first_column = (int)(location.offset - starts[line]) + 1;
+
+  /* Nearly every location is a token, on one line. */
+  if (line + 1 < count && starts[line + 1] <= last) {
+    line = location_find_line(starts, count, last);
+  }
+  lines.last_line = (int)line + 1;
+  lines.last_column = (int)(last - starts[line]) + 1;
+  return lines;
+}
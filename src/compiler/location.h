@@ -0,0 +1,20 @@
+#ifndef _LOCATION_H
+#define _LOCATION_H
+
+#include <stdint.h>
+
+#include "compiler.h"
+
+/* The lines and columns of a location, counted from 1. */
+struct location_lines {
+  int first_line;
+  int first_column;
+  int last_line;
+  int last_column;
+};
+
+void location_start_source(void);
+void location_add_line(uint32_t offset);
+struct location_lines location_find_lines(YYLTYPE location);
+
+#endif /* _LOCATION_H */
@@ -1,102 +1,510 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdarg.h>
+#include <stdbool.h>
 #include <assert.h>
 #include <string.h>
 
+#include "node.h"
 #include "type.h"
 #include "symbol.h"
 #include "ir.h"
+#include "emit.h"
 #include "mips.h"
+#include "profile.h"
 
 #define REG_EXHAUSTED   -1
 
-#define FIRST_USABLE_REGISTER  8
-#define LAST_USABLE_REGISTER  23
 #define NUM_REGISTERS         32
 
+/* The most text any one instruction turns into. */
+#define MIPS_MAX_INSTRUCTION_LENGTH 512
+
+#define MIPS_MAX_TEXT_LENGTH 128
+
+/*
+ * Printing a number is a call to print_number, a routine at the end of every
+ * program that formats the number in $a0 into the print buffer, in the same
+ * form as spim's print_int syscall followed by a newline. The buffer is
+ * written with one write syscall when it is full and when main returns, so
+ * a program makes one syscall per MIPS_PRINT_BUFFER_SIZE bytes of output
+ * instead of two per number.
+ *
+ * The routine uses only $v0, $v1, $a0 to $a3 and $ra, none of which hold
+ * temporaries. main saves its return address on the stack around the calls.
+ */
+#define MIPS_PRINT_WRITE_FD 1
+
+/*
+ * A profiling program writes its counts with spim's open syscall, which
+ * passes its flags and mode on to the host. These are O_WRONLY | O_CREAT |
+ * O_TRUNC on Linux, and 0644.
+ */
+#define MIPS_PROFILE_OPEN_FLAGS 0x241
+#define MIPS_PROFILE_OPEN_MODE  0644
+
+
+/*****************
+ * OUTPUT LAYOUT *
+ *****************/
+
+/*
+ * Every piece of text an instruction of main's body is made of, other than
+ * its numbers, is formatted once when the layout is chosen, along with the
+ * names of the registers. Printing an instruction then only copies strings
+ * into the output buffer. The text is kept until another layout is chosen,
+ * so the workers of a compile server format it once. The code around the
+ * body is printed an instruction at a time, padding its fields as it goes.
+ *
+ * The padded layout right-aligns every field in a column ten characters
+ * wide. The compact one indents instructions with a tab and leaves the
+ * fields unpadded.
+ */
+struct mips_text {
+  char text[MIPS_MAX_TEXT_LENGTH];
+  size_t length;
+};
+
+struct mips_register_name {
+  char text[16];
+  size_t length;
+};
+
+static struct {
+  bool ready;
+  enum mips_layout layout;
+  int width;
+  struct mips_text indent;
+  struct mips_register_name register_names[NUM_REGISTERS];
+  struct mips_text opcodes[IR_PROFILE_COUNT + 1];
+  struct mips_text separator;
+  struct mips_text end_of_line;
+  struct mips_text copy_end;
+  struct mips_text divide_nonzero_middle;
+  struct mips_text print_number_start;
+  struct mips_text print_number_end;
+  struct mips_text profile_count_start;
+  struct mips_text profile_count_middle;
+  struct mips_text load;
+  struct mips_text store;
+  struct mips_text variable_address;
+  struct mips_text temporary_address;
+  struct mips_text spill_start;
+  struct mips_text spill_end;
+  struct mips_text reload_end;
+} mips_layout;
+
+static void mips_format_text(struct mips_text *text, char const *format, ...) {
+  va_list arguments;
+  int length;
+
+  va_start(arguments, format);
+  length = vsnprintf(text->text, sizeof(text->text), format, arguments);
+  va_end(arguments);
+  assert(length >= 0 && (size_t)length < sizeof(text->text));
+  text->length = (size_t)length;
+}
+
+/*
+ * mips_set_layout - choose how the instructions are laid out
+ *
+ * This must be called before anything is printed.
+ */
+void mips_set_layout(enum mips_layout layout) {
+  static char const *opcodes[] = {
+    [IR_MULTIPLY] = "mulu",
+    [IR_DIVIDE] = "divu",
+    [IR_ADD] = "addu",
+    [IR_SUBTRACT] = "subu",
+    [IR_LOAD_IMMEDIATE] = "li",
+    [IR_COPY] = "or",
+    [IR_PRINT_NUMBER] = NULL,
+    [IR_ADD_IMMEDIATE] = "addiu",
+    [IR_SHIFT_LEFT] = "sllv",
+    [IR_SHIFT_RIGHT] = "srlv",
+    [IR_SHIFT_LEFT_IMMEDIATE] = "sll",
+    [IR_SHIFT_RIGHT_IMMEDIATE] = "srl",
+    [IR_AND] = "and",
+    [IR_XOR] = "xor",
+    [IR_OR] = "or",
+    [IR_DIVIDE_NONZERO] = "divu",
+    [IR_PROFILE_COUNT] = NULL
+  };
+  char const *indent = MIPS_LAYOUT_COMPACT == layout ? "\t" : "";
+  int width = MIPS_LAYOUT_COMPACT == layout ? 0 : 10;
+  int register_width = width > 2 ? width - 2 : 0, register_digits = width > 2 ? 2 : 1;
+  int i;
+
+  if (mips_layout.ready && layout == mips_layout.layout) {
+    return;
+  }
+  mips_layout.layout = layout;
+  mips_format_text(&mips_layout.indent, "%s", indent);
+  mips_layout.width = width;
+
+  /* A temporary is the register $N, padded as %8s%02d. */
+  for (i = 0; i < NUM_REGISTERS; i++) {
+    struct mips_register_name *name = &mips_layout.register_names[i];
+    int length = snprintf(name->text, sizeof(name->text), "%*s%0*d", register_width, "$", register_digits, i);
+    assert(length > 0 && (size_t)length < sizeof(name->text));
+    name->length = (size_t)length;
+  }
+
+  for (i = 0; i <= IR_PROFILE_COUNT; i++) {
+    if (NULL != opcodes[i]) {
+      mips_format_text(&mips_layout.opcodes[i], "%s%*s ", indent, width, opcodes[i]);
+    }
+  }
+  mips_format_text(&mips_layout.separator, ", ");
+  mips_format_text(&mips_layout.end_of_line, "\n");
+  mips_format_text(&mips_layout.copy_end, ", %*s\n", width, "$0");
+  mips_format_text(&mips_layout.divide_nonzero_middle, "\n%s%*s ", indent, width, "mflo");
+
+  /* Print the number, then a newline. */
+  mips_format_text(&mips_layout.print_number_start, "%s%*s %*s, %*s, ",
+                   indent, width, "or", width, "$a0", width, "$0");
+  mips_format_text(&mips_layout.print_number_end, "\n%s%*s %*s\n",
+                   indent, width, "jal", width, "print_number");
+
+  /* Count a statement. */
+  mips_format_text(&mips_layout.profile_count_start, "%s%*s %*s, profile_counts+",
+                   indent, width, "lw", width, "$v1");
+  mips_format_text(&mips_layout.profile_count_middle, "\n%s%*s %*s, %*s, %*d\n%s%*s %*s, profile_counts+",
+                   indent, width, "addiu", width, "$v1", width, "$v1", width, 1,
+                   indent, width, "sw", width, "$v1");
+  /*
+   * Code generated from the tree keeps variables in memory, and pushes the
+   * registers it spills onto the stack.
+   */
+  mips_format_text(&mips_layout.load, "%s%*s ", indent, width, "lw");
+  mips_format_text(&mips_layout.store, "%s%*s ", indent, width, "sw");
+  mips_format_text(&mips_layout.variable_address, ", variables+");
+  mips_format_text(&mips_layout.temporary_address, ", temporaries+");
+  mips_format_text(&mips_layout.spill_start, "%s%*s %*s, %*s, %*d\n%s%*s ",
+                   indent, width, "addiu", width, "$sp", width, "$sp", width, -4,
+                   indent, width, "sw");
+  mips_format_text(&mips_layout.spill_end, ", %*s\n", width, "0($sp)");
+  mips_format_text(&mips_layout.reload_end, ", %*s\n%s%*s %*s, %*s, %*d\n",
+                   width, "0($sp)",
+                   indent, width, "addiu", width, "$sp", width, "$sp", width, 4);
+
+
+  mips_layout.ready = true;
+}
+
 
 /****************************
  * MIPS TEXT SECTION OUTPUT *
  ****************************/
 
-void mips_print_temporary_operand(FILE *output, struct ir_operand *operand) {
-  assert(OPERAND_TEMPORARY == operand->kind);
+static char *mips_copy_text(char *cursor, struct mips_text *text) {
+  memcpy(cursor, text->text, text->length);
+  return cursor + text->length;
+}
+
+static char *mips_print_register(char *cursor, unsigned long number) {
+  assert(number < NUM_REGISTERS);
+  memcpy(cursor, mips_layout.register_names[number].text, mips_layout.register_names[number].length);
+  return cursor + mips_layout.register_names[number].length;
+}
+
+/* Right-align text in a field as wide as the layout's. */
+static char *mips_print_field(char *cursor, char const *text, size_t length) {
+  if ((int)length < mips_layout.width) {
+    memset(cursor, ' ', (size_t)mips_layout.width - length);
+    cursor += (size_t)mips_layout.width - length;
+  }
+  memcpy(cursor, text, length);
+  return cursor + length;
+}
+
+/* Immediates are 16 bits, sign-extended; the IR holds them as 32-bit values. */
+static char *mips_print_immediate(char *cursor, unsigned long value) {
+  char digits[16], *end;
+
+  value &= 0xFFFFFFFFul;
+  if (value < 0x80000000ul) {
+    return emit_format_unsigned(cursor, value, mips_layout.width);
+  }
+  digits[0] = '-';
+  end = emit_format_unsigned(digits + 1, 0x100000000ul - value, 0);
+  return mips_print_field(cursor, digits, (size_t)(end - digits));
+}
+
+/* The opcode and the named operands of an instruction printed outside main's body. */
+static char *mips_print_names(char *cursor, char const *opcode, char const *first, char const *second,
+                              char const *third) {
+  char const *operands[3] = { first, second, third };
+  int i;
+
+  cursor = mips_print_field(mips_copy_text(cursor, &mips_layout.indent), opcode, strlen(opcode));
+  for (i = 0; i < 3 && NULL != operands[i]; i++) {
+    if (0 == i) {
+      *cursor++ = ' ';
+    } else {
+      cursor = mips_copy_text(cursor, &mips_layout.separator);
+    }
+    cursor = mips_print_field(cursor, operands[i], strlen(operands[i]));
+  }
+  return cursor;
+}
+
+/* Print an instruction whose operands, up to three, are registers or labels. */
+static void mips_print_line(struct emit_buffer *output, char const *opcode, char const *first, char const *second,
+                            char const *third) {
+  char *cursor = emit_reserve(output, MIPS_MAX_INSTRUCTION_LENGTH);
+
+  cursor = mips_print_names(cursor, opcode, first, second, third);
+  emit_commit(output, mips_copy_text(cursor, &mips_layout.end_of_line));
+}
+
+/* Print an instruction whose last operand is the number immediate, after one or two registers. */
+static void mips_print_line_immediate(struct emit_buffer *output, char const *opcode, char const *first,
+                                      char const *second, long immediate) {
+  char *cursor = emit_reserve(output, MIPS_MAX_INSTRUCTION_LENGTH);
 
-  fprintf(output, "%8s%02d", "$", operand->data.temporary + FIRST_USABLE_REGISTER);
+  cursor = mips_print_names(cursor, opcode, first, second, NULL);
+  cursor = mips_copy_text(cursor, &mips_layout.separator);
+  cursor = mips_print_immediate(cursor, (unsigned long)immediate);
+  emit_commit(output, mips_copy_text(cursor, &mips_layout.end_of_line));
 }
 
-void mips_print_number_operand(FILE *output, struct ir_operand *operand) {
+/*
+ * The IR numbers its temporaries without reusing them, and only the first
+ * MIPS_TEMPORARY_REGISTERS fit in the registers from FIRST_USABLE_REGISTER
+ * to LAST_USABLE_REGISTER. The registers past those include the stack
+ * pointer and the return address, which main needs, so each later temporary
+ * is a word of the temporaries area instead. An instruction that uses one
+ * loads it into $v0 or $v1 first, and stores it from there when it sets it:
+ * print_number is free to change those two, so nothing else keeps a value
+ * in them from one instruction to the next.
+ */
+static struct {
+  /* The registers of the instruction being printed. */
+  struct mips_registers registers;
+
+  /* How many words the temporaries area needs. */
+  unsigned long words;
+} mips_temporaries;
+
+/* The register of a temporary, or a scratch register for one in memory, which is loaded when load is set. */
+static unsigned long mips_place_temporary(struct mips_registers *registers, int temporary, bool load) {
+  int i;
+
+  if (temporary < MIPS_TEMPORARY_REGISTERS) {
+    return (unsigned long)temporary + FIRST_USABLE_REGISTER;
+  }
+  for (i = 0; i < registers->load_count; i++) {
+    if (registers->loads[i] == temporary) {
+      return MIPS_SCRATCH_REGISTER + (unsigned long)i;
+    }
+  }
+  if (!load) {
+    return MIPS_SCRATCH_REGISTER;
+  }
+  registers->loads[registers->load_count] = temporary;
+  return MIPS_SCRATCH_REGISTER + (unsigned long)registers->load_count++;
+}
+
+/*
+ * mips_assign_registers - find the register of each temporary of an
+ * instruction, and the temporaries in memory to load before it and store
+ * after it
+ *
+ * The ones it reads are loaded into $v0 and $v1. The one it sets, when that
+ * is in memory too, is given $v0 unless it was loaded: every machine
+ * instruction it turns into reads its operands before it writes its result.
+ * The text output and objects both place temporaries with this.
+ */
+void mips_assign_registers(struct ir_instruction const *instruction, struct mips_registers *registers) {
+  int first = 1, last = 2, i, temporary;
+  bool sets = true;
+
+  memset(registers, 0, sizeof(struct mips_registers));
+  registers->store = -1;
+  switch (instruction->kind) {
+    case IR_NO_OPERATION:
+    case IR_PROFILE_COUNT:
+      return;
+    case IR_PRINT_NUMBER:
+      first = last = 0;
+      sets = false;
+      break;
+    case IR_LOAD_IMMEDIATE:
+      last = 0;
+      break;
+    case IR_COPY:
+      last = 1;
+      break;
+    default:
+      break;
+  }
+
+  for (i = first; i <= last; i++) {
+    if (OPERAND_TEMPORARY == instruction->operands[i].kind) {
+      registers->operands[i] = mips_place_temporary(registers, instruction->operands[i].data.temporary, true);
+    }
+  }
+  if (sets) {
+    temporary = instruction->operands[0].data.temporary;
+    assert(OPERAND_TEMPORARY == instruction->operands[0].kind);
+    registers->operands[0] = mips_place_temporary(registers, temporary, false);
+    registers->store = temporary < MIPS_TEMPORARY_REGISTERS ? -1 : temporary;
+  }
+}
+
+static char *mips_print_temporary_operand(char *cursor, struct ir_instruction *instruction, int operand) {
+  assert(OPERAND_TEMPORARY == instruction->operands[operand].kind);
+
+  return mips_print_register(cursor, mips_temporaries.registers.operands[operand]);
+}
+
+static char *mips_print_number_operand(char *cursor, struct ir_operand *operand) {
   assert(OPERAND_NUMBER == operand->kind);
 
-  fprintf(output, "%10lu", operand->data.number);
+  return emit_format_unsigned(cursor, operand->data.number, mips_layout.width);
 }
 
-void mips_print_arithmetic(FILE *output, struct ir_instruction *instruction) {
-  static char *opcodes[] = {
-    NULL,
-    "mulu",
-    "divu",
-    "addu",
-    "subu",
-    NULL
-  };
-  fprintf(output, "%10s ", opcodes[instruction->kind]);
-  mips_print_temporary_operand(output, &instruction->operands[0]);
-  fputs(", ", output);
-  mips_print_temporary_operand(output, &instruction->operands[1]);
-  fputs(", ", output);
-  mips_print_temporary_operand(output, &instruction->operands[2]);
-  fputs("\n", output);
+static char *mips_print_immediate_operand(char *cursor, struct ir_operand *operand) {
+  assert(OPERAND_NUMBER == operand->kind);
+
+  return mips_print_immediate(cursor, operand->data.number);
+}
+
+static char *mips_print_arithmetic(char *cursor, struct ir_instruction *instruction) {
+  cursor = mips_copy_text(cursor, &mips_layout.opcodes[instruction->kind]);
+  cursor = mips_print_temporary_operand(cursor, instruction, 0);
+  cursor = mips_copy_text(cursor, &mips_layout.separator);
+  cursor = mips_print_temporary_operand(cursor, instruction, 1);
+  cursor = mips_copy_text(cursor, &mips_layout.separator);
+  if (OPERAND_NUMBER == instruction->operands[2].kind) {
+    cursor = mips_print_immediate_operand(cursor, &instruction->operands[2]);
+  } else {
+    cursor = mips_print_temporary_operand(cursor, instruction, 2);
+  }
+  return mips_copy_text(cursor, &mips_layout.end_of_line);
 }
 
-void mips_print_copy(FILE *output, struct ir_instruction *instruction) {
-  fprintf(output, "%10s ", "or");
-  mips_print_temporary_operand(output, &instruction->operands[0]);
-  fputs(", ", output);
-  mips_print_temporary_operand(output, &instruction->operands[1]);
-  fprintf(output, ", %10s\n", "$0");
+static char *mips_print_copy(char *cursor, struct ir_instruction *instruction) {
+  cursor = mips_copy_text(cursor, &mips_layout.opcodes[IR_COPY]);
+  cursor = mips_print_temporary_operand(cursor, instruction, 0);
+  cursor = mips_copy_text(cursor, &mips_layout.separator);
+  cursor = mips_print_temporary_operand(cursor, instruction, 1);
+  return mips_copy_text(cursor, &mips_layout.copy_end);
 }
 
-void mips_print_load_immediate(FILE *output, struct ir_instruction *instruction) {
-  fprintf(output, "%10s ", "li");
-  mips_print_temporary_operand(output, &instruction->operands[0]);
-  fputs(", ", output);
-  mips_print_number_operand(output, &instruction->operands[1]);
-  fputs("\n", output);
+/* A divide that cannot be by zero is the machine instruction, without the zero check of the pseudo-op. */
+static char *mips_print_divide_nonzero(char *cursor, struct ir_instruction *instruction) {
+  cursor = mips_copy_text(cursor, &mips_layout.opcodes[IR_DIVIDE_NONZERO]);
+  cursor = mips_print_temporary_operand(cursor, instruction, 1);
+  cursor = mips_copy_text(cursor, &mips_layout.separator);
+  cursor = mips_print_temporary_operand(cursor, instruction, 2);
+  cursor = mips_copy_text(cursor, &mips_layout.divide_nonzero_middle);
+  cursor = mips_print_temporary_operand(cursor, instruction, 0);
+  return mips_copy_text(cursor, &mips_layout.end_of_line);
 }
 
-void mips_print_print_number(FILE *output, struct ir_instruction *instruction) {
-  /* Print the number. */
-  fprintf(output, "%10s %10s, %10s, %10d\n", "ori", "$v0", "$0", 1);
-  fprintf(output, "%10s %10s, %10s, ", "or", "$a0", "$0");
-  mips_print_temporary_operand(output, &instruction->operands[0]);
-  fprintf(output, "\n%10s\n", "syscall");
+static char *mips_print_load_immediate(char *cursor, struct ir_instruction *instruction) {
+  cursor = mips_copy_text(cursor, &mips_layout.opcodes[IR_LOAD_IMMEDIATE]);
+  cursor = mips_print_temporary_operand(cursor, instruction, 0);
+  cursor = mips_copy_text(cursor, &mips_layout.separator);
+  cursor = mips_print_number_operand(cursor, &instruction->operands[1]);
+  return mips_copy_text(cursor, &mips_layout.end_of_line);
+}
 
-  /* Print a newline. */
-  fprintf(output, "%10s %10s, %10s, %10d\n", "ori", "$v0", "$0", 4);
-  fprintf(output, "%10s %10s, %10s", "la", "$a0", "newline");
-  fprintf(output, "\n%10s\n", "syscall");
+static char *mips_print_print_number(char *cursor, struct ir_instruction *instruction) {
+  cursor = mips_copy_text(cursor, &mips_layout.print_number_start);
+  cursor = mips_print_temporary_operand(cursor, instruction, 0);
+  return mips_copy_text(cursor, &mips_layout.print_number_end);
 }
 
-void mips_print_instruction(FILE *output, struct ir_instruction *instruction) {
+/*
+ * Each counter is a word of profile_counts, at four times the number of its
+ * statement. The counters used are tracked so that the epilogue can make
+ * room for them.
+ */
+static struct {
+  char const *name;
+  unsigned long counters;
+} mips_profile = { MIPS_PROFILE_DEFAULT_NAME, 0 };
+
+static char *mips_print_profile_count(char *cursor, struct ir_instruction *instruction) {
+  unsigned long statement = instruction->operands[0].data.number;
+
+  assert(OPERAND_NUMBER == instruction->operands[0].kind);
+  if (statement >= mips_profile.counters) {
+    mips_profile.counters = statement + 1;
+  }
+  cursor = mips_copy_text(cursor, &mips_layout.profile_count_start);
+  cursor = emit_format_unsigned(cursor, 4 * statement, 0);
+  cursor = mips_copy_text(cursor, &mips_layout.profile_count_middle);
+  cursor = emit_format_unsigned(cursor, 4 * statement, 0);
+  return mips_copy_text(cursor, &mips_layout.end_of_line);
+}
+
+/* Load or store a temporary kept in memory, through the register reg. */
+static void mips_print_temporary_access(struct emit_buffer *output, struct mips_text *opcode, unsigned long reg,
+                                        int temporary) {
+  unsigned long offset = MIPS_TEMPORARY_OFFSET(temporary);
+  char *cursor = emit_reserve(output, MIPS_MAX_INSTRUCTION_LENGTH);
+
+  if (offset / 4 >= mips_temporaries.words) {
+    mips_temporaries.words = offset / 4 + 1;
+  }
+  cursor = mips_copy_text(cursor, opcode);
+  cursor = mips_print_register(cursor, reg);
+  cursor = mips_copy_text(cursor, &mips_layout.temporary_address);
+  cursor = emit_format_unsigned(cursor, offset, 0);
+  cursor = mips_copy_text(cursor, &mips_layout.end_of_line);
+  emit_commit(output, cursor);
+}
+
+static void mips_print_instruction(struct emit_buffer *output, struct ir_instruction *instruction) {
+  struct mips_registers *registers = &mips_temporaries.registers;
+  char *cursor;
+  int i;
+
+  mips_assign_registers(instruction, registers);
+  for (i = 0; i < registers->load_count; i++) {
+    mips_print_temporary_access(output, &mips_layout.load, MIPS_SCRATCH_REGISTER + (unsigned long)i,
+                                registers->loads[i]);
+  }
+  cursor = emit_reserve(output, MIPS_MAX_INSTRUCTION_LENGTH);
+
   switch (instruction->kind) {
     case IR_MULTIPLY:
     case IR_DIVIDE:
     case IR_ADD:
     case IR_SUBTRACT:
-      mips_print_arithmetic(output, instruction);
+    case IR_ADD_IMMEDIATE:
+    case IR_SHIFT_LEFT:
+    case IR_SHIFT_RIGHT:
+    case IR_SHIFT_LEFT_IMMEDIATE:
+    case IR_SHIFT_RIGHT_IMMEDIATE:
+    case IR_AND:
+    case IR_XOR:
+    case IR_OR:
+      cursor = mips_print_arithmetic(cursor, instruction);
+      break;
+
+    case IR_DIVIDE_NONZERO:
+      cursor = mips_print_divide_nonzero(cursor, instruction);
       break;
 
     case IR_COPY:
-      mips_print_copy(output, instruction);
+      cursor = mips_print_copy(cursor, instruction);
       break;
 
     case IR_LOAD_IMMEDIATE:
-      mips_print_load_immediate(output, instruction);
+      cursor = mips_print_load_immediate(cursor, instruction);
       break;
 
     case IR_PRINT_NUMBER:
-      mips_print_print_number(output, instruction);
+      cursor = mips_print_print_number(cursor, instruction);
+      break;
+
+    case IR_PROFILE_COUNT:
+      cursor = mips_print_profile_count(cursor, instruction);
       break;
 
     case IR_NO_OPERATION:
@@ -106,22 +514,552 @@ void mips_print_instruction(FILE *output, struct ir_instruction *instruction) {
       assert(0);
       break;
   }
+  emit_commit(output, cursor);
+
+  if (registers->store >= 0) {
+    mips_print_temporary_access(output, &mips_layout.store, registers->operands[0], registers->store);
+  }
 }
 
-void mips_print_text_section(FILE *output, struct ir_section *section) {
-  struct ir_instruction *instruction;
+/*
+ * mips_set_profile_name - name the file a profiling program writes its
+ * counts to
+ */
+void mips_set_profile_name(char const *name) {
+  mips_profile.name = name;
+}
+
+/*
+ * The counts are written as a header of the word PROFILE_MAGIC and the
+ * number of counters, then the counters, all in the byte order of the
+ * machine that ran the program.
+ */
+static void mips_print_profile_write(struct emit_buffer *output) {
+  char const *name;
+  char *cursor;
+
+  emit_string(output, "\n");
+  mips_print_line_immediate(output, "ori", "$v0", "$0", 13);
+  mips_print_line(output, "la", "$a0", "profile_name", NULL);
+  mips_print_line_immediate(output, "ori", "$a1", "$0", MIPS_PROFILE_OPEN_FLAGS);
+  mips_print_line_immediate(output, "ori", "$a2", "$0", MIPS_PROFILE_OPEN_MODE);
+  mips_print_line(output, "syscall", NULL, NULL, NULL);
+  mips_print_line(output, "or", "$a0", "$v0", "$0");
+  mips_print_line_immediate(output, "ori", "$v0", "$0", 15);
+  mips_print_line(output, "la", "$a1", "profile_header", NULL);
+  mips_print_line_immediate(output, "li", "$a2", NULL, (long)(8 + 4 * mips_profile.counters));
+  mips_print_line(output, "syscall", NULL, NULL, NULL);
+  mips_print_line_immediate(output, "ori", "$v0", "$0", 16);
+  mips_print_line(output, "syscall", NULL, NULL, NULL);
+
+  emit_string(output, "\n.data\nprofile_name: .asciiz \"");
+  for (name = mips_profile.name; '\0' != *name; name++) {
+    if ('"' == *name || '\\' == *name) {
+      emit_bytes(output, "\\", 1);
+    }
+    emit_bytes(output, name, 1);
+  }
+  emit_string(output, "\"\n.align 2\nprofile_header: .word ");
+  cursor = emit_reserve(output, MIPS_MAX_INSTRUCTION_LENGTH);
+  cursor = emit_format_unsigned(cursor, PROFILE_MAGIC, 0);
+  cursor = mips_copy_text(cursor, &mips_layout.separator);
+  cursor = emit_format_unsigned(cursor, mips_profile.counters, 0);
+  emit_commit(output, cursor);
+  emit_string(output, "\nprofile_counts: .space ");
+  cursor = emit_reserve(output, MIPS_MAX_INSTRUCTION_LENGTH);
+  cursor = emit_format_unsigned(cursor, 4 * mips_profile.counters, 0);
+  emit_commit(output, cursor);
+  emit_string(output, "\n.text\n");
+}
 
-  fputs("\n.data\nnewline: .asciiz \"\\n\"", output);
-  fputs("\n.text\nmain:\n", output);
+/*
+ * At -O0 code is generated from the typed tree in one walk, without the IR.
+ * Each variable is a word of the variables area, at four times its symbol's
+ * id, and an expression is evaluated on a stack of the registers from
+ * FIRST_USABLE_REGISTER to LAST_USABLE_REGISTER. Entry N of the stack is
+ * held in register FIRST_USABLE_REGISTER + N % MIPS_STACK_REGISTERS. When a
+ * push finds every register in use, the bottom entry in registers is pushed
+ * onto the machine stack, and it is popped back when the entries above it
+ * have been used, so the spills come back in the order they went out.
+ *
+ * A variable is only loaded when the instruction that uses it is reached,
+ * and the value of an assignment is its variable, so that an expression
+ * computes what the IR of the same tree does: there, a variable's value is
+ * read from its temporary by the instruction that uses it.
+ */
+#define MIPS_STACK_REGISTERS (LAST_USABLE_REGISTER - FIRST_USABLE_REGISTER + 1)
+
+static struct {
+  unsigned int depth;
+  unsigned int spilled;
+  unsigned long variables;
+} mips_stack;
+
+static struct {
+  unsigned long statements;
+  unsigned int max_depth;
+  unsigned long spills;
+} mips_statistics;
+
+/*
+ * print_number writes out the buffer first when the number might not fit.
+ * It then counts the digits, so that it can write them from the last one
+ * back, and ends the number with a newline.
+ */
+static void mips_print_runtime(struct emit_buffer *output) {
+  emit_string(output, "\nprint_number:\n");
+  mips_print_line(output, "la", "$a1", "print_length", NULL);
+  mips_print_line(output, "lw", "$v1", "0($a1)", NULL);
+  mips_print_line_immediate(output, "sltiu", "$a2", "$v1", MIPS_PRINT_BUFFER_SIZE - MIPS_PRINT_MAX_LENGTH + 1);
+  mips_print_line(output, "bne", "$a2", "$0", "print_sign");
+  mips_print_line(output, "or", "$a3", "$a0", "$0");
+  mips_print_line_immediate(output, "ori", "$v0", "$0", 15);
+  mips_print_line_immediate(output, "ori", "$a0", "$0", MIPS_PRINT_WRITE_FD);
+  mips_print_line(output, "or", "$a2", "$v1", "$0");
+  mips_print_line_immediate(output, "addiu", "$a1", "$a1", 4);
+  mips_print_line(output, "syscall", NULL, NULL, NULL);
+  mips_print_line_immediate(output, "addiu", "$a1", "$a1", -4);
+  mips_print_line(output, "or", "$a0", "$a3", "$0");
+  mips_print_line(output, "or", "$v1", "$0", "$0");
+
+  emit_string(output, "print_sign:\n");
+  mips_print_line(output, "addu", "$v1", "$a1", "$v1");
+  mips_print_line(output, "bgez", "$a0", "print_digits", NULL);
+  mips_print_line_immediate(output, "ori", "$a2", "$0", '-');
+  mips_print_line(output, "sb", "$a2", "4($v1)", NULL);
+  mips_print_line_immediate(output, "addiu", "$v1", "$v1", 1);
+  mips_print_line(output, "subu", "$a0", "$0", "$a0");
+
+  emit_string(output, "print_digits:\n");
+  mips_print_line(output, "or", "$a2", "$a0", "$0");
+  mips_print_line_immediate(output, "ori", "$a3", "$0", 10);
+
+  emit_string(output, "print_count:\n");
+  mips_print_line_immediate(output, "addiu", "$v1", "$v1", 1);
+  mips_print_line(output, "divu", "$a2", "$a3", NULL);
+  mips_print_line(output, "mflo", "$a2", NULL, NULL);
+  mips_print_line(output, "bne", "$a2", "$0", "print_count");
+  mips_print_line_immediate(output, "ori", "$a2", "$0", '\n');
+  mips_print_line(output, "sb", "$a2", "4($v1)", NULL);
+  mips_print_line(output, "subu", "$a2", "$v1", "$a1");
+  mips_print_line_immediate(output, "addiu", "$a2", "$a2", 1);
+  mips_print_line(output, "sw", "$a2", "0($a1)", NULL);
+
+  emit_string(output, "print_digit:\n");
+  mips_print_line(output, "divu", "$a0", "$a3", NULL);
+  mips_print_line(output, "mfhi", "$a2", NULL, NULL);
+  mips_print_line(output, "mflo", "$a0", NULL, NULL);
+  mips_print_line_immediate(output, "addiu", "$a2", "$a2", '0');
+  mips_print_line(output, "sb", "$a2", "3($v1)", NULL);
+  mips_print_line_immediate(output, "addiu", "$v1", "$v1", -1);
+  mips_print_line(output, "bne", "$a0", "$0", "print_digit");
+  mips_print_line(output, "jr", "$ra", NULL, NULL);
+}
+
+void mips_print_prologue(struct emit_buffer *output) {
+  char *cursor;
+
+  assert(mips_layout.ready);
+
+  mips_profile.counters = 0;
+  memset(&mips_temporaries, 0, sizeof(mips_temporaries));
+  memset(&mips_stack, 0, sizeof(mips_stack));
+  memset(&mips_statistics, 0, sizeof(mips_statistics));
+  emit_string(output, "\n.data\nprint_length: .word 0\nprint_buffer: .space ");
+  cursor = emit_reserve(output, MIPS_MAX_INSTRUCTION_LENGTH);
+  cursor = emit_format_unsigned(cursor, MIPS_PRINT_BUFFER_SIZE, 0);
+  emit_commit(output, cursor);
+  emit_string(output, "\n.text\nmain:\n");
+
+  /* main keeps its return address on the stack, since print_number is called with jal. */
+  mips_print_line_immediate(output, "addiu", "$sp", "$sp", -4);
+  mips_print_line(output, "sw", "$ra", "0($sp)", NULL);
+}
+
+void mips_print_section(struct emit_buffer *output, struct ir_section *section) {
+  struct ir_instruction *instruction;
 
   for (instruction = section->first; instruction != section->last->next; instruction = instruction->next) {
     mips_print_instruction(output, instruction);
   }
+}
+
+void mips_print_epilogue(struct emit_buffer *output) {
+  char *cursor;
 
-  /* Return from main. */
-  fprintf(output, "\n%10s %10s\n", "jr", "$ra");
+  if (mips_profile.counters > 0) {
+    mips_print_profile_write(output);
+  }
+  if (mips_stack.variables > 0) {
+    emit_string(output, "\n.data\n.align 2\nvariables: .space ");
+    cursor = emit_reserve(output, MIPS_MAX_INSTRUCTION_LENGTH);
+    cursor = emit_format_unsigned(cursor, 4 * mips_stack.variables, 0);
+    emit_commit(output, cursor);
+    emit_string(output, "\n.text\n");
+  }
+  if (mips_temporaries.words > 0) {
+    emit_string(output, "\n.data\n.align 2\ntemporaries: .space ");
+    cursor = emit_reserve(output, MIPS_MAX_INSTRUCTION_LENGTH);
+    cursor = emit_format_unsigned(cursor, 4 * mips_temporaries.words, 0);
+    emit_commit(output, cursor);
+    emit_string(output, "\n.text\n");
+  }
+
+  /* Write out the print buffer, write(1, print_buffer, print_length), and return. */
+  emit_string(output, "\n");
+  mips_print_line(output, "la", "$a1", "print_length", NULL);
+  mips_print_line(output, "lw", "$a2", "0($a1)", NULL);
+  mips_print_line_immediate(output, "ori", "$v0", "$0", 15);
+  mips_print_line_immediate(output, "ori", "$a0", "$0", MIPS_PRINT_WRITE_FD);
+  mips_print_line_immediate(output, "addiu", "$a1", "$a1", 4);
+  mips_print_line(output, "syscall", NULL, NULL, NULL);
+  mips_print_line(output, "lw", "$ra", "0($sp)", NULL);
+  mips_print_line_immediate(output, "addiu", "$sp", "$sp", 4);
+  mips_print_line(output, "jr", "$ra", NULL, NULL);
+
+  mips_print_runtime(output);
+}
+
+void mips_print_text_section(struct emit_buffer *output, struct ir_section *section) {
+  mips_print_prologue(output);
+  mips_print_section(output, section);
+  mips_print_epilogue(output);
 }
 
-void mips_print_program(FILE *output, struct ir_section *section) {
+void mips_print_program(struct emit_buffer *output, struct ir_section *section) {
   mips_print_text_section(output, section);
 }
+
+
+/*******************************
+ * MIPS DIRECTLY FROM THE TREE *
+ *******************************/
+
+/* The value of an expression: the top entry of the register stack, or a variable. */
+struct mips_value {
+  bool is_variable;
+  unsigned int id;
+};
+
+struct mips_generation {
+  struct emit_buffer *output;
+  struct mips_value *values;
+  size_t count;
+  size_t capacity;
+};
+
+static unsigned long mips_stack_register(unsigned int entry) {
+  return FIRST_USABLE_REGISTER + entry % MIPS_STACK_REGISTERS;
+}
+
+/* mips_push - add an entry to the register stack, spilling the bottom one held in a register if need be */
+static unsigned long mips_push(struct emit_buffer *output) {
+  char *cursor;
+
+  if (mips_stack.depth - mips_stack.spilled == MIPS_STACK_REGISTERS) {
+    cursor = emit_reserve(output, MIPS_MAX_INSTRUCTION_LENGTH);
+    cursor = mips_copy_text(cursor, &mips_layout.spill_start);
+    cursor = mips_print_register(cursor, mips_stack_register(mips_stack.spilled));
+    cursor = mips_copy_text(cursor, &mips_layout.spill_end);
+    emit_commit(output, cursor);
+    mips_stack.spilled++;
+    mips_statistics.spills++;
+  }
+  if (++mips_stack.depth > mips_statistics.max_depth) {
+    mips_statistics.max_depth = mips_stack.depth;
+  }
+  return mips_stack_register(mips_stack.depth - 1);
+}
+
+/* mips_reload - bring the top count entries of the register stack back into registers */
+static void mips_reload(struct emit_buffer *output, unsigned int count) {
+  char *cursor;
+
+  assert(mips_stack.depth >= count);
+  while (mips_stack.spilled > mips_stack.depth - count) {
+    mips_stack.spilled--;
+    cursor = emit_reserve(output, MIPS_MAX_INSTRUCTION_LENGTH);
+    cursor = mips_copy_text(cursor, &mips_layout.load);
+    cursor = mips_print_register(cursor, mips_stack_register(mips_stack.spilled));
+    cursor = mips_copy_text(cursor, &mips_layout.reload_end);
+    emit_commit(output, cursor);
+  }
+}
+
+static void mips_pop(void) {
+  assert(mips_stack.depth > mips_stack.spilled);
+  mips_stack.depth--;
+}
+
+/* Load or store register from or to the word of variable id. */
+static void mips_print_variable_access(struct emit_buffer *output, struct mips_text *opcode, unsigned long reg,
+                                       unsigned int id) {
+  char *cursor = emit_reserve(output, MIPS_MAX_INSTRUCTION_LENGTH);
+
+  if (id >= mips_stack.variables) {
+    mips_stack.variables = id + 1;
+  }
+  cursor = mips_copy_text(cursor, opcode);
+  cursor = mips_print_register(cursor, reg);
+  cursor = mips_copy_text(cursor, &mips_layout.variable_address);
+  cursor = emit_format_unsigned(cursor, 4 * (unsigned long)id, 0);
+  cursor = mips_copy_text(cursor, &mips_layout.end_of_line);
+  emit_commit(output, cursor);
+}
+
+/* mips_materialize - make value the top entry of the register stack, loading it if it is a variable */
+static unsigned long mips_materialize(struct emit_buffer *output, struct mips_value value) {
+  unsigned long reg;
+
+  if (value.is_variable) {
+    reg = mips_push(output);
+    mips_print_variable_access(output, &mips_layout.load, reg, value.id);
+    return reg;
+  }
+  mips_reload(output, 1);
+  return mips_stack_register(mips_stack.depth - 1);
+}
+
+static void mips_print_copy_register(struct emit_buffer *output, unsigned long target, unsigned long source) {
+  char *cursor = emit_reserve(output, MIPS_MAX_INSTRUCTION_LENGTH);
+
+  cursor = mips_copy_text(cursor, &mips_layout.opcodes[IR_COPY]);
+  cursor = mips_print_register(cursor, target);
+  cursor = mips_copy_text(cursor, &mips_layout.separator);
+  cursor = mips_print_register(cursor, source);
+  cursor = mips_copy_text(cursor, &mips_layout.copy_end);
+  emit_commit(output, cursor);
+}
+
+static enum ir_instruction_kind mips_instruction_kind_for(int operation, bool immediate) {
+  switch (operation) {
+    case BINOP_MULTIPLICATION:
+      return IR_MULTIPLY;
+    case BINOP_DIVISION:
+      return IR_DIVIDE;
+    case BINOP_ADDITION:
+      return immediate ? IR_ADD_IMMEDIATE : IR_ADD;
+    case BINOP_SUBTRACTION:
+      return immediate ? IR_ADD_IMMEDIATE : IR_SUBTRACT;
+    case BINOP_LEFT_SHIFT:
+      return immediate ? IR_SHIFT_LEFT_IMMEDIATE : IR_SHIFT_LEFT;
+    case BINOP_RIGHT_SHIFT:
+      return immediate ? IR_SHIFT_RIGHT_IMMEDIATE : IR_SHIFT_RIGHT;
+    case BINOP_BITWISE_AND:
+      return IR_AND;
+    case BINOP_BITWISE_XOR:
+      return IR_XOR;
+    case BINOP_BITWISE_OR:
+      return IR_OR;
+    default:
+      assert(0);
+      return IR_NO_OPERATION;
+  }
+}
+
+/*
+ * mips_operate - perform operation on left and right, leaving the result
+ * as the top entry of the register stack
+ *
+ * When the right operand is held by the instruction, right is not used.
+ */
+static void mips_operate(struct emit_buffer *output, struct node *binary_operation, int operation,
+                         struct mips_value left, struct mips_value right) {
+  struct ir_operand immediate;
+  unsigned long target, first, second = 0;
+  bool is_immediate;
+  char *cursor;
+
+  immediate.kind = OPERAND_NUMBER;
+  is_immediate = ir_immediate(binary_operation, &immediate.data.number);
+  if (is_immediate) {
+    target = first = mips_materialize(output, left);
+  } else if (!left.is_variable) {
+    /* The left operand was evaluated first, so it is below the right one. */
+    mips_reload(output, right.is_variable ? 1 : 2);
+    target = first = mips_stack_register(mips_stack.depth - (right.is_variable ? 1 : 2));
+    second = mips_materialize(output, right);
+  } else if (!right.is_variable) {
+    mips_reload(output, 1);
+    target = second = mips_stack_register(mips_stack.depth - 1);
+    first = mips_materialize(output, left);
+  } else {
+    target = first = mips_materialize(output, left);
+    second = mips_materialize(output, right);
+  }
+
+  cursor = emit_reserve(output, MIPS_MAX_INSTRUCTION_LENGTH);
+  cursor = mips_copy_text(cursor, &mips_layout.opcodes[mips_instruction_kind_for(operation, is_immediate)]);
+  cursor = mips_print_register(cursor, target);
+  cursor = mips_copy_text(cursor, &mips_layout.separator);
+  cursor = mips_print_register(cursor, first);
+  cursor = mips_copy_text(cursor, &mips_layout.separator);
+  if (is_immediate) {
+    cursor = mips_print_immediate_operand(cursor, &immediate);
+  } else {
+    cursor = mips_print_register(cursor, second);
+  }
+  cursor = mips_copy_text(cursor, &mips_layout.end_of_line);
+  emit_commit(output, cursor);
+
+  if (!is_immediate) {
+    mips_pop();
+  }
+}
+
+static void mips_push_value(struct mips_generation *generation, bool is_variable, unsigned int id) {
+  if (generation->count == generation->capacity) {
+    generation->capacity = generation->capacity ? generation->capacity * 2 : 64;
+    generation->values = realloc(generation->values, generation->capacity * sizeof(struct mips_value));
+    assert(NULL != generation->values);
+  }
+  generation->values[generation->count].is_variable = is_variable;
+  generation->values[generation->count].id = id;
+  generation->count++;
+}
+
+static void mips_generate_for_binary_operation(struct mips_generation *generation, struct node *binary_operation) {
+  struct emit_buffer *output = generation->output;
+  int operation = binary_operation->data.binary_operation.operation;
+  struct node *left = binary_operation->data.binary_operation.left_operand;
+  struct mips_value left_value, right_value, stacked = { false, 0 };
+  unsigned long old, reg;
+  unsigned int id;
+
+  right_value.is_variable = false;
+  right_value.id = 0;
+  if (!ir_immediate(binary_operation, NULL)) {
+    right_value = generation->values[--generation->count];
+  }
+  if (BINOP_ASSIGN == operation) {
+    assert(NODE_IDENTIFIER == left->kind);
+    id = left->data.identifier.symbol->id;
+    reg = mips_materialize(output, right_value);
+    mips_print_variable_access(output, &mips_layout.store, reg, id);
+    mips_pop();
+    mips_push_value(generation, true, id);
+    return;
+  }
+
+  left_value = generation->values[--generation->count];
+  if (BINOP_POST_INCREMENT == operation || BINOP_POST_DECREMENT == operation) {
+    /* The old value stays on the stack, under the new one, which is stored. */
+    assert(left_value.is_variable);
+    old = mips_materialize(output, left_value);
+    reg = mips_push(output);
+    mips_print_copy_register(output, reg, old);
+    mips_operate(output, binary_operation, node_assigned_operation(operation), stacked, right_value);
+    mips_print_variable_access(output, &mips_layout.store, reg, left_value.id);
+    mips_pop();
+    mips_push_value(generation, false, 0);
+  } else if (node_is_assignment(operation)) {
+    assert(left_value.is_variable);
+    mips_operate(output, binary_operation, node_assigned_operation(operation), left_value, right_value);
+    mips_print_variable_access(output, &mips_layout.store, mips_stack_register(mips_stack.depth - 1), left_value.id);
+    mips_pop();
+    mips_push_value(generation, true, left_value.id);
+  } else {
+    mips_operate(output, binary_operation, operation, left_value, right_value);
+    mips_push_value(generation, false, 0);
+  }
+}
+
+/*
+ * Operands are generated before the operations that use them, left first,
+ * except for the left operand of an assignment and constants held by the
+ * instruction, which need no code of their own.
+ */
+static enum node_walk mips_generate_for_expression(struct node *expression, enum node_visit visit, void *context) {
+  struct mips_generation *generation = context;
+  unsigned long reg;
+  char *cursor;
+
+  if (NODE_VISIT_PRE == visit) {
+    if (BINOP_ASSIGN == expression->data.binary_operation.operation) {
+      return NODE_WALK_RIGHT_OPERAND;
+    } else if (ir_immediate(expression, NULL)) {
+      return NODE_WALK_LEFT_OPERAND;
+    }
+    return NODE_WALK_OPERANDS;
+  } else if (NODE_VISIT_IN == visit) {
+    return NODE_WALK_OPERANDS;
+  }
+
+  switch (expression->kind) {
+    case NODE_IDENTIFIER:
+      mips_push_value(generation, true, expression->data.identifier.symbol->id);
+      break;
+
+    case NODE_NUMBER:
+      reg = mips_push(generation->output);
+      cursor = emit_reserve(generation->output, MIPS_MAX_INSTRUCTION_LENGTH);
+      cursor = mips_copy_text(cursor, &mips_layout.opcodes[IR_LOAD_IMMEDIATE]);
+      cursor = mips_print_register(cursor, reg);
+      cursor = mips_copy_text(cursor, &mips_layout.separator);
+      cursor = emit_format_unsigned(cursor, expression->data.number.value, mips_layout.width);
+      cursor = mips_copy_text(cursor, &mips_layout.end_of_line);
+      emit_commit(generation->output, cursor);
+      mips_push_value(generation, false, 0);
+      break;
+
+    case NODE_BINARY_OPERATION:
+      mips_generate_for_binary_operation(generation, expression);
+      break;
+
+    default:
+      assert(0);
+      break;
+  }
+  return NODE_WALK_OPERANDS;
+}
+
+/*
+ * mips_print_expression_statement - print the code of a statement directly
+ * from its tree, which must have been through symbol and type checking
+ */
+void mips_print_expression_statement(struct emit_buffer *output, struct node *expression_statement) {
+  struct mips_generation generation;
+  struct mips_value value;
+  char *cursor;
+  unsigned long reg;
+  assert(NODE_EXPRESSION_STATEMENT == expression_statement->kind);
+
+  memset(&generation, 0, sizeof(generation));
+  generation.output = output;
+  node_walk_expression(expression_statement->data.expression_statement.expression, mips_generate_for_expression,
+                       &generation);
+  assert(1 == generation.count);
+  value = generation.values[0];
+  free(generation.values);
+
+  reg = mips_materialize(output, value);
+  cursor = emit_reserve(output, MIPS_MAX_INSTRUCTION_LENGTH);
+  cursor = mips_copy_text(cursor, &mips_layout.print_number_start);
+  cursor = mips_print_register(cursor, reg);
+  cursor = mips_copy_text(cursor, &mips_layout.print_number_end);
+  emit_commit(output, cursor);
+  mips_pop();
+
+  assert(0 == mips_stack.depth && 0 == mips_stack.spilled);
+  mips_statistics.statements++;
+}
+
+static enum node_walk mips_print_statement(struct node *statement_list, enum node_visit visit, void *context) {
+  (void)visit;
+  mips_print_expression_statement(context, statement_list->data.statement_list.statement);
+  return NODE_WALK_OPERANDS;
+}
+
+/* mips_print_tree - print the program of a statement list without going through the IR */
+void mips_print_tree(struct emit_buffer *output, struct node *statement_list) {
+  assert(NODE_STATEMENT_LIST == statement_list->kind);
+
+  mips_print_prologue(output);
+  node_walk_statement_list(statement_list, mips_print_statement, output);
+  mips_print_epilogue(output);
+}
+
+void mips_print_statistics(FILE *output) {
+  fprintf(output, "mips: %lu statements from the tree, %lu variables, register stack at most %u deep, %lu spills\n",
+          mips_statistics.statements, mips_stack.variables, mips_statistics.max_depth, mips_statistics.spills);
+}
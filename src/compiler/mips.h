@@ -3,6 +3,72 @@
 
 #include <stdio.h>
 
-void mips_print_program(FILE *output, struct ir_section *section);
+struct emit_buffer;
+struct ir_instruction;
+struct ir_section;
+struct node;
+
+/*
+ * Temporary N is held in register $N + FIRST_USABLE_REGISTER, up to
+ * LAST_USABLE_REGISTER. The later ones are words of the temporaries area,
+ * at MIPS_TEMPORARY_OFFSET, which an instruction that uses them loads into
+ * and stores from the scratch registers $v0 and $v1.
+ */
+#define FIRST_USABLE_REGISTER  8
+#define LAST_USABLE_REGISTER  23
+#define MIPS_TEMPORARY_REGISTERS (LAST_USABLE_REGISTER - FIRST_USABLE_REGISTER + 1)
+#define MIPS_SCRATCH_REGISTER    2
+#define MIPS_TEMPORARY_OFFSET(temporary) (4 * (unsigned long)((temporary) - MIPS_TEMPORARY_REGISTERS))
+
+/* The registers of one instruction, and the temporaries in memory it loads and stores. */
+struct mips_registers {
+  /* The register of each operand that is a temporary, and 0 for the others. */
+  unsigned long operands[3];
+
+  /* Loaded into MIPS_SCRATCH_REGISTER and the one after it, in order. */
+  int loads[2];
+  int load_count;
+
+  /* Stored from the register of operand 0 after the instruction, or -1. */
+  int store;
+};
+
+void mips_assign_registers(struct ir_instruction const *instruction, struct mips_registers *registers);
+
+/*
+ * A program prints into a buffer of MIPS_PRINT_BUFFER_SIZE bytes, which is
+ * written out when the next number might not fit and when the program ends.
+ * A number takes at most MIPS_PRINT_MAX_LENGTH bytes: a sign, ten digits and
+ * a newline.
+ */
+#define MIPS_PRINT_BUFFER_SIZE 4096
+#define MIPS_PRINT_MAX_LENGTH    12
+
+/* Where a profiling program writes its counts unless told otherwise. */
+#define MIPS_PROFILE_DEFAULT_NAME "mips.profile"
+
+enum mips_layout {
+  MIPS_LAYOUT_PADDED,
+  MIPS_LAYOUT_COMPACT
+};
+
+void mips_set_layout(enum mips_layout layout);
+void mips_set_profile_name(char const *name);
+
+void mips_print_program(struct emit_buffer *output, struct ir_section *section);
+
+/* Print a program a section at a time, as the sections are generated. */
+void mips_print_prologue(struct emit_buffer *output);
+void mips_print_section(struct emit_buffer *output, struct ir_section *section);
+void mips_print_epilogue(struct emit_buffer *output);
+
+/*
+ * Print code straight from the typed tree, skipping the IR, as -O0 does.
+ * The statements go between a prologue and an epilogue like sections do.
+ */
+void mips_print_tree(struct emit_buffer *output, struct node *statement_list);
+void mips_print_expression_statement(struct emit_buffer *output, struct node *expression_statement);
+
+void mips_print_statistics(FILE *output);
 
 #endif
@@ -3,12 +3,11 @@
 #include <string.h>
 #include <ctype.h>
 #include <assert.h>
-#include <errno.h>
-#include <limits.h>
 
 #include "node.h"
 #include "symbol.h"
 #include "type.h"
+#include "arena.h"
 
 /***************************
  * CREATE PARSE TREE NODES *
@@ -18,8 +17,7 @@
 static struct node *node_create(enum node_kind kind, YYLTYPE location) {
   struct node *n;
 
-  n = malloc(sizeof(struct node));
-  assert(NULL != n);
+  n = arena_allocate(sizeof(struct node));
 
   n->kind = kind;
   n->location = location;
@@ -48,6 +46,39 @@ struct node *node_identifier(YYLTYPE location, char *text, int length)
   return node;
 }
 
+/*
+ * Literals are decoded here, from the span of the token, rather than with
+ * strtoul, which needs a terminated string and errno, and knows nothing of
+ * suffixes or of the types C89 gives to constants. The scanner only passes
+ * well-formed literals: a decimal, octal (leading 0) or hexadecimal (leading
+ * 0x) constant, then at most one u and one l suffix, in either order.
+ *
+ * The value is kept modulo 2^32, the size of unsigned long on the target.
+ */
+#define NODE_NUMBER_MAX 0xFFFFFFFFul
+#define NODE_NUMBER_SIGNED_MAX 0x7FFFFFFFul
+
+static unsigned int node_digit_value(char c) {
+  if (c <= '9') {
+    return c - '0';
+  }
+  return (c | 0x20) - 'a' + 10;
+}
+
+/*
+ * The first type of the list C89 gives the constant that can represent it.
+ * Int and long are both 32 bits here, so the lists shorten.
+ */
+static struct type *node_number_type(unsigned long value, int base, bool is_unsigned, bool is_long) {
+  if (value <= NODE_NUMBER_SIGNED_MAX && !is_unsigned) {
+    return type_basic(false, is_long ? TYPE_BASIC_LONG : TYPE_BASIC_INT);
+  } else if (is_long || (10 == base && !is_unsigned)) {
+    return type_basic(true, TYPE_BASIC_LONG);
+  } else {
+    return type_basic(true, TYPE_BASIC_INT);
+  }
+}
+
 /*
  * node_number - allocate a node to represent a number
  *
@@ -58,22 +89,46 @@ struct node *node_identifier(YYLTYPE location, char *text, int length)
  * Side-effects:
  *   Memory may be allocated on the heap.
  */
-struct node *node_number(YYLTYPE location, char *text)
+struct node *node_number(YYLTYPE location, char *text, int length)
 {
   struct node *node = node_create(NODE_NUMBER, location);
-  errno = 0;
-  node->data.number.value = strtoul(text, NULL, 10);
-  if (node->data.number.value == ULONG_MAX && ERANGE == errno) {
-    /* Strtoul indicated overflow. */
-    node->data.number.overflow = true;
-    node->data.number.result.type = type_basic(false, TYPE_BASIC_LONG);
-  } else if (node->data.number.value > 0xFFFFFFFFul) {
-    /* Value is too large for 32-bit unsigned long type. */
-    node->data.number.overflow = true;
-    node->data.number.result.type = type_basic(false, TYPE_BASIC_LONG);
+  char const *digit = text, *end = text + length;
+  bool is_unsigned = false, is_long = false, overflow = false;
+  /* Wider than the target, so a digit can be added before checking for overflow. */
+  unsigned long long value = 0;
+  int base = 10;
+
+  if ('0' == digit[0] && length > 1 && 'x' == (digit[1] | 0x20)) {
+    base = 16;
+    digit += 2;
+  } else if ('0' == digit[0]) {
+    base = 8;
+  }
+
+  /* Suffixes are found from the end: [uU][lL]? or [lL][uU]?. */
+  while ('u' == (end[-1] | 0x20) || 'l' == (end[-1] | 0x20)) {
+    end--;
+    if ('u' == (*end | 0x20)) {
+      is_unsigned = true;
+    } else {
+      is_long = true;
+    }
+  }
+
+  for (; digit < end; digit++) {
+    value = value * base + node_digit_value(*digit);
+    if (value > NODE_NUMBER_MAX) {
+      overflow = true;
+      value &= NODE_NUMBER_MAX;
+    }
+  }
+
+  node->data.number.value = (unsigned long)value;
+  node->data.number.overflow = overflow;
+  if (overflow) {
+    node->data.number.result.type = type_basic(true, TYPE_BASIC_LONG);
   } else {
-    node->data.number.overflow = false;
-    node->data.number.result.type = type_basic(false, TYPE_BASIC_LONG);
+    node->data.number.result.type = node_number_type((unsigned long)value, base, is_unsigned, is_long);
   }
 
   node->data.number.result.ir_operand = NULL;
@@ -91,9 +146,26 @@ struct node *node_binary_operation(YYLTYPE location,
   node->data.binary_operation.right_operand = right_operand;
   node->data.binary_operation.result.type = NULL;
   node->data.binary_operation.result.ir_operand = NULL;
+  node->data.binary_operation.evaluate_right_first = false;
   return node;
 }
 
+/*
+ * node_increment - allocate a node for ++ or --, which adds or subtracts 1
+ *
+ * Parameters:
+ *   operator_location - the location of the ++ or --, which the 1 takes
+ *   operation - BINOP_ASSIGN_ADDITION or BINOP_ASSIGN_SUBTRACTION for the
+ *               prefix forms, BINOP_POST_INCREMENT or BINOP_POST_DECREMENT
+ *               for the postfix ones
+ */
+struct node *node_increment(YYLTYPE location, YYLTYPE operator_location, enum node_binary_operation operation,
+                            struct node *operand)
+{
+  char one[] = "1";
+  return node_binary_operation(location, operation, operand, node_number(operator_location, one, 1));
+}
+
 struct node *node_expression_statement(YYLTYPE location, struct node *expression)
 {
   struct node *node = node_create(NODE_EXPRESSION_STATEMENT, location);
@@ -116,6 +188,179 @@ struct node *node_null_statement(YYLTYPE location)
   return node_create(NODE_NULL_STATEMENT, location);
 }
 
+static enum node_walk node_destroy_expression(struct node *node, enum node_visit visit, void *context) {
+  (void)context;
+  if (NODE_VISIT_POST == visit) {
+    arena_free(node->ir);
+    arena_free(node);
+  }
+  return NODE_WALK_OPERANDS;
+}
+
+/*
+ * node_destroy - free a parse tree
+ *
+ * The IR sections attached to the nodes are freed, but not the IR
+ * instructions they describe, which are shared between sections. Types
+ * and symbols are not owned by the tree.
+ */
+void node_destroy(struct node *node) {
+  struct node *init;
+
+  while (NULL != node) {
+    init = NULL;
+    switch (node->kind) {
+      case NODE_BINARY_OPERATION:
+      case NODE_NUMBER:
+      case NODE_IDENTIFIER:
+        node_walk_expression(node, node_destroy_expression, NULL);
+        return;
+      case NODE_EXPRESSION_STATEMENT:
+        node_destroy(node->data.expression_statement.expression);
+        break;
+      case NODE_STATEMENT_LIST:
+        init = node->data.statement_list.init;
+        node_destroy(node->data.statement_list.statement);
+        break;
+      default:
+        break;
+    }
+    arena_free(node->ir);
+    arena_free(node);
+    node = init;
+  }
+}
+
+/*
+ * A copy is built bottom up: each node is copied once its operands have
+ * been, from the copies on top of the stack.
+ */
+struct node_copy {
+  int32_t delta;
+  struct node **stack;
+  size_t depth;
+  size_t capacity;
+};
+
+static enum node_walk node_copy_expression(struct node *node, enum node_visit visit, void *context) {
+  struct node_copy *copy = context;
+  struct node *result;
+
+  if (NODE_VISIT_POST != visit) {
+    return NODE_WALK_OPERANDS;
+  }
+
+  result = arena_allocate(sizeof(struct node));
+  *result = *node;
+  result->location.offset += copy->delta;
+  if (NODE_BINARY_OPERATION == node->kind) {
+    result->data.binary_operation.right_operand = copy->stack[--copy->depth];
+    result->data.binary_operation.left_operand = copy->stack[--copy->depth];
+  }
+
+  if (copy->depth == copy->capacity) {
+    copy->capacity = copy->capacity ? copy->capacity * 2 : 32;
+    copy->stack = realloc(copy->stack, copy->capacity * sizeof(struct node *));
+    assert(NULL != copy->stack);
+  }
+  copy->stack[copy->depth++] = result;
+  return NODE_WALK_OPERANDS;
+}
+
+/*
+ * node_copy_statement - copy an expression statement as the parser built it
+ *
+ * Parameters:
+ *   delta - integer - the distance the statement has moved in the source,
+ *           which is added to the offset of every location
+ *
+ * Only a statement no later stage has run over can be copied: the copy
+ * shares nothing with it, and has no symbols, types or IR.
+ */
+struct node *node_copy_statement(struct node *statement, int32_t delta) {
+  struct node_copy copy;
+  YYLTYPE location = statement->location;
+
+  assert(NODE_EXPRESSION_STATEMENT == statement->kind && NULL == statement->ir);
+  copy.delta = delta;
+  copy.stack = NULL;
+  copy.depth = copy.capacity = 0;
+  node_walk_expression(statement->data.expression_statement.expression, node_copy_expression, &copy);
+  assert(1 == copy.depth);
+
+  location.offset += delta;
+  statement = node_expression_statement(location, copy.stack[0]);
+  free(copy.stack);
+  return statement;
+}
+
+/* Whether the operation assigns its left operand. */
+bool node_is_assignment(int operation) {
+  return BINOP_ASSIGN == operation || (operation >= BINOP_ASSIGN_MULTIPLICATION && operation <= BINOP_POST_DECREMENT);
+}
+
+/*
+ * node_assigned_operation - the operation whose result a compound
+ * assignment, increment or decrement stores
+ */
+int node_assigned_operation(int operation) {
+  switch (operation) {
+    case BINOP_ASSIGN_MULTIPLICATION:
+      return BINOP_MULTIPLICATION;
+    case BINOP_ASSIGN_DIVISION:
+      return BINOP_DIVISION;
+    case BINOP_ASSIGN_ADDITION:
+    case BINOP_POST_INCREMENT:
+      return BINOP_ADDITION;
+    case BINOP_ASSIGN_SUBTRACTION:
+    case BINOP_POST_DECREMENT:
+      return BINOP_SUBTRACTION;
+    case BINOP_ASSIGN_LEFT_SHIFT:
+      return BINOP_LEFT_SHIFT;
+    case BINOP_ASSIGN_RIGHT_SHIFT:
+      return BINOP_RIGHT_SHIFT;
+    case BINOP_ASSIGN_BITWISE_AND:
+      return BINOP_BITWISE_AND;
+    case BINOP_ASSIGN_BITWISE_XOR:
+      return BINOP_BITWISE_XOR;
+    case BINOP_ASSIGN_BITWISE_OR:
+      return BINOP_BITWISE_OR;
+    default:
+      assert(0);
+      return operation;
+  }
+}
+
+/* The operator as written in the source. The postfix ones follow their operand only. */
+char const *node_binary_operator(int operation) {
+  static const char *binary_operators[] = {
+    "*",    /*  0 = BINOP_MULTIPLICATION */
+    "/",    /*  1 = BINOP_DIVISION */
+    "+",    /*  2 = BINOP_ADDITION */
+    "-",    /*  3 = BINOP_SUBTRACTION */
+    "=",    /*  4 = BINOP_ASSIGN */
+    "<<",   /*  5 = BINOP_LEFT_SHIFT */
+    ">>",   /*  6 = BINOP_RIGHT_SHIFT */
+    "&",    /*  7 = BINOP_BITWISE_AND */
+    "^",    /*  8 = BINOP_BITWISE_XOR */
+    "|",    /*  9 = BINOP_BITWISE_OR */
+    "*=",   /* 10 = BINOP_ASSIGN_MULTIPLICATION */
+    "/=",   /* 11 = BINOP_ASSIGN_DIVISION */
+    "+=",   /* 12 = BINOP_ASSIGN_ADDITION */
+    "-=",   /* 13 = BINOP_ASSIGN_SUBTRACTION */
+    "<<=",  /* 14 = BINOP_ASSIGN_LEFT_SHIFT */
+    ">>=",  /* 15 = BINOP_ASSIGN_RIGHT_SHIFT */
+    "&=",   /* 16 = BINOP_ASSIGN_BITWISE_AND */
+    "^=",   /* 17 = BINOP_ASSIGN_BITWISE_XOR */
+    "|=",   /* 18 = BINOP_ASSIGN_BITWISE_OR */
+    "++",   /* 19 = BINOP_POST_INCREMENT */
+    "--",   /* 20 = BINOP_POST_DECREMENT */
+    NULL
+  };
+
+  return binary_operators[operation];
+}
+
 struct result *node_get_result(struct node *expression) {
   switch (expression->kind) {
     case NODE_NUMBER:
@@ -130,31 +375,150 @@ struct result *node_get_result(struct node *expression) {
   }
 }
 
+/*************************
+ * WALK PARSE TREE NODES *
+ *************************/
+
+#define NODE_WALK_INITIAL_DEPTH 32
+
+struct node_walk_frame {
+  struct node *node;
+  enum node_visit next;
+  enum node_walk walk;
+};
+
+/*
+ * node_walk_expression - visit the nodes of an expression in depth-first order
+ *
+ * Parameters:
+ *   expression - node - the root of the expression
+ *   visitor - function - called for each visit to a node
+ *   context - pointer - passed on to the visitor
+ *
+ * The walk keeps its own stack of the binary operations it is inside of,
+ * rather than recursing, so the depth of an expression is limited only by
+ * memory. A node is not used again after its NODE_VISIT_POST visit.
+ */
+void node_walk_expression(struct node *expression, node_visitor visitor, void *context) {
+  struct node_walk_frame initial[NODE_WALK_INITIAL_DEPTH], *stack = initial, *frame;
+  size_t depth = 0, capacity = NODE_WALK_INITIAL_DEPTH;
+  struct node *node;
+
+  stack[depth].node = expression;
+  stack[depth++].next = NODE_VISIT_PRE;
+
+  while (depth > 0) {
+    if (depth == capacity) {
+      capacity *= 2;
+      if (initial == stack) {
+        stack = malloc(capacity * sizeof(struct node_walk_frame));
+        assert(NULL != stack);
+        memcpy(stack, initial, sizeof(initial));
+      } else {
+        stack = realloc(stack, capacity * sizeof(struct node_walk_frame));
+        assert(NULL != stack);
+      }
+    }
+
+    frame = &stack[depth - 1];
+    node = frame->node;
+    if (NODE_BINARY_OPERATION != node->kind) {
+      visitor(node, NODE_VISIT_POST, context);
+      depth--;
+      continue;
+    }
+
+    switch (frame->next) {
+      case NODE_VISIT_PRE:
+        frame->next = NODE_VISIT_IN;
+        frame->walk = visitor(node, NODE_VISIT_PRE, context);
+        if (NODE_WALK_RIGHT_OPERAND != frame->walk) {
+          stack[depth].node = NODE_WALK_OPERANDS_REVERSED == frame->walk
+                            ? node->data.binary_operation.right_operand
+                            : node->data.binary_operation.left_operand;
+          stack[depth++].next = NODE_VISIT_PRE;
+        }
+        break;
+
+      case NODE_VISIT_IN:
+        frame->next = NODE_VISIT_POST;
+        visitor(node, NODE_VISIT_IN, context);
+        if (NODE_WALK_LEFT_OPERAND == frame->walk) {
+          break;
+        }
+        stack[depth].node = NODE_WALK_OPERANDS_REVERSED == frame->walk
+                          ? node->data.binary_operation.left_operand
+                          : node->data.binary_operation.right_operand;
+        stack[depth++].next = NODE_VISIT_PRE;
+        break;
+
+      case NODE_VISIT_POST:
+        depth--;
+        visitor(node, NODE_VISIT_POST, context);
+        break;
+    }
+  }
+
+  if (initial != stack) {
+    free(stack);
+  }
+}
+
+/*
+ * node_walk_statement_list - visit each statement list node, first statement first
+ *
+ * Each node of the init chain is visited once, with NODE_VISIT_POST, after
+ * the nodes before it. The chain is as long as the program, so it is walked
+ * from an array rather than by recursion.
+ */
+void node_walk_statement_list(struct node *statement_list, node_visitor visitor, void *context) {
+  struct node **lists, *iter;
+  size_t count = 0, i;
+
+  for (iter = statement_list; NULL != iter; iter = iter->data.statement_list.init) {
+    assert(NODE_STATEMENT_LIST == iter->kind);
+    count++;
+  }
+  lists = malloc(count * sizeof(struct node *));
+  assert(NULL != lists);
+  for (iter = statement_list, i = count; NULL != iter; iter = iter->data.statement_list.init) {
+    lists[--i] = iter;
+  }
+
+  for (i = 0; i < count; i++) {
+    visitor(lists[i], NODE_VISIT_POST, context);
+  }
+  free(lists);
+}
+
 /**************************
  * PRINT PARSE TREE NODES *
  **************************/
 
-static void node_print_expression(FILE *output, struct node *expression);
-
-static void node_print_binary_operation(FILE *output, struct node *binary_operation) {
-  static const char *binary_operators[] = {
-    "*",    /*  0 = BINOP_MULTIPLICATION */
-    "/",    /*  1 = BINOP_DIVISION */
-    "+",    /*  2 = BINOP_ADDITION */
-    "-",    /*  3 = BINOP_SUBTRACTION */
-    "=",    /*  4 = BINOP_ASSIGN */
-    NULL
-  };
+static enum node_walk node_print_binary_operation(FILE *output, struct node *binary_operation, enum node_visit visit) {
+  int operation = binary_operation->data.binary_operation.operation;
+  bool postfix = BINOP_POST_INCREMENT == operation || BINOP_POST_DECREMENT == operation;
 
   assert(NODE_BINARY_OPERATION == binary_operation->kind);
 
-  fputs("(", output);
-  node_print_expression(output, binary_operation->data.binary_operation.left_operand);
-  fputs(" ", output);
-  fputs(binary_operators[binary_operation->data.binary_operation.operation], output);
-  fputs(" ", output);
-  node_print_expression(output, binary_operation->data.binary_operation.right_operand);
-  fputs(")", output);
+  switch (visit) {
+    case NODE_VISIT_PRE:
+      fputs("(", output);
+      return postfix ? NODE_WALK_LEFT_OPERAND : NODE_WALK_OPERANDS;
+    case NODE_VISIT_IN:
+      if (!postfix) {
+        fputs(" ", output);
+      }
+      fputs(node_binary_operator(operation), output);
+      if (!postfix) {
+        fputs(" ", output);
+      }
+      break;
+    case NODE_VISIT_POST:
+      fputs(")", output);
+      break;
+  }
+  return NODE_WALK_OPERANDS;
 }
 
 static void node_print_number(FILE *output, struct node *number) {
@@ -179,13 +543,12 @@ static void node_print_identifier(FILE *output, struct node *identifier) {
   }
 }
 
-static void node_print_expression(FILE *output, struct node *expression) {
-  assert(NULL != expression);
+static enum node_walk node_print_expression(struct node *expression, enum node_visit visit, void *context) {
+  FILE *output = context;
 
   switch (expression->kind) {
     case NODE_BINARY_OPERATION:
-      node_print_binary_operation(output, expression);
-      break;
+      return node_print_binary_operation(output, expression, visit);
     case NODE_IDENTIFIER:
       node_print_identifier(output, expression);
       break;
@@ -196,22 +559,27 @@ static void node_print_expression(FILE *output, struct node *expression) {
       assert(0);
       break;
   }
+  return NODE_WALK_OPERANDS;
 }
 
 static void node_print_expression_statement(FILE *output, struct node *expression_statement) {
   assert(NODE_EXPRESSION_STATEMENT == expression_statement->kind);
 
-  node_print_expression(output, expression_statement->data.expression_statement.expression);
-
+  node_walk_expression(expression_statement->data.expression_statement.expression,
+                       node_print_expression, output);
 }
 
-void node_print_statement_list(FILE *output, struct node *statement_list) {
-  assert(NODE_STATEMENT_LIST == statement_list->kind);
+static enum node_walk node_print_statement(struct node *statement_list, enum node_visit visit, void *context) {
+  FILE *output = context;
+  (void)visit;
 
-  if (NULL != statement_list->data.statement_list.init) {
-    node_print_statement_list(output, statement_list->data.statement_list.init);
-  }
   node_print_expression_statement(output, statement_list->data.statement_list.statement);
   fputs(";\n", output);
+  return NODE_WALK_OPERANDS;
 }
 
+void node_print_statement_list(FILE *output, struct node *statement_list) {
+  assert(NODE_STATEMENT_LIST == statement_list->kind);
+
+  node_walk_statement_list(statement_list, node_print_statement, output);
+}
@@ -8,6 +8,7 @@ typedef void* yyscan_t;
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "compiler.h"
 #include "parser.tab.h"
@@ -40,6 +41,7 @@ struct node {
       struct node *left_operand;
       struct node *right_operand;
       struct result result;
+      bool evaluate_right_first;
     } binary_operation;
     struct {
       struct node *expression;
@@ -56,18 +58,69 @@ enum node_binary_operation {
   BINOP_DIVISION,
   BINOP_ADDITION,
   BINOP_SUBTRACTION,
-  BINOP_ASSIGN
+  BINOP_ASSIGN,
+  BINOP_LEFT_SHIFT,
+  BINOP_RIGHT_SHIFT,
+  BINOP_BITWISE_AND,
+  BINOP_BITWISE_XOR,
+  BINOP_BITWISE_OR,
+
+  /* Assign the left operand the result of the operation. ++x is x += 1. */
+  BINOP_ASSIGN_MULTIPLICATION,
+  BINOP_ASSIGN_DIVISION,
+  BINOP_ASSIGN_ADDITION,
+  BINOP_ASSIGN_SUBTRACTION,
+  BINOP_ASSIGN_LEFT_SHIFT,
+  BINOP_ASSIGN_RIGHT_SHIFT,
+  BINOP_ASSIGN_BITWISE_AND,
+  BINOP_ASSIGN_BITWISE_XOR,
+  BINOP_ASSIGN_BITWISE_OR,
+
+  /* x++ and x--: the right operand is the 1 added, and the value is x's old one. */
+  BINOP_POST_INCREMENT,
+  BINOP_POST_DECREMENT
 };
 
+bool node_is_assignment(int operation);
+int node_assigned_operation(int operation);
+char const *node_binary_operator(int operation);
+
 /* Constructors */
-struct node *node_number(YYLTYPE location, char *text);
+struct node *node_number(YYLTYPE location, char *text, int length);
 struct node *node_identifier(YYLTYPE location, char *text, int length);
 struct node *node_binary_operation(YYLTYPE location, enum node_binary_operation operation,
                                    struct node *left_operand, struct node *right_operand);
+struct node *node_increment(YYLTYPE location, YYLTYPE operator_location, enum node_binary_operation operation,
+                            struct node *operand);
 struct node *node_expression_statement(YYLTYPE location, struct node *expression);
 struct node *node_statement_list(YYLTYPE location, struct node *init, struct node *statement);
 struct node *node_null_statement(YYLTYPE location);
 
+void node_destroy(struct node *node);
+struct node *node_copy_statement(struct node *statement, int32_t delta);
+
+/*
+ * Walks visit a binary operation before, between and after its operands,
+ * and any other node once, with NODE_VISIT_POST. The value returned from
+ * NODE_VISIT_PRE picks the operands to walk and their order; it is ignored
+ * for the other visits.
+ */
+enum node_visit {
+  NODE_VISIT_PRE,
+  NODE_VISIT_IN,
+  NODE_VISIT_POST
+};
+enum node_walk {
+  NODE_WALK_OPERANDS,
+  NODE_WALK_OPERANDS_REVERSED,
+  NODE_WALK_LEFT_OPERAND,
+  NODE_WALK_RIGHT_OPERAND
+};
+typedef enum node_walk (*node_visitor)(struct node *node, enum node_visit visit, void *context);
+
+void node_walk_expression(struct node *expression, node_visitor visitor, void *context);
+void node_walk_statement_list(struct node *statement_list, node_visitor visitor, void *context);
+
 struct result *node_get_result(struct node *expression);
 
 void node_print_statement_list(FILE *output, struct node *statement_list);
@@ -1,8 +1,23 @@
 #ifndef _PARSER_H
 #define _PARSER_H
 
+#ifdef SCANNER_SIMD
+#include "lexer.h"
+#else
 #include "scanner.yy.h"
+#endif
+
+struct node;
+
+typedef void (*parser_statement_handler)(struct node *statement, void *context);
+
+struct parser_stream {
+  parser_statement_handler handler;
+  void *context;
+};
 
 struct node *parser_create_tree(int *error_count, yyscan_t scanner);
+int parser_stream_statements(int *error_count, yyscan_t scanner,
+                             parser_statement_handler handler, void *context);
 
 #endif
@@ -1,5 +1,3 @@
-%verbose
-%debug
 %defines
 %locations
 %define api.pure
@@ -7,8 +5,13 @@
 %parse-param {YYSTYPE *root}
 %parse-param {int *error_count}
 %parse-param {yyscan_t scanner}
+%parse-param {struct parser_stream *stream}
 %token-table
 
+%code requires {
+  struct parser_stream;
+}
+
 %{
 
   #ifndef YY_TYPEDEF_YY_SCANNER_T
@@ -20,13 +23,35 @@
 
   #include "compiler.h"
   #include "parser.tab.h"
+  #ifdef SCANNER_SIMD
+  #include "lexer.h"
+  #else
   #include "scanner.yy.h"
+  #endif
   #include "node.h"
 
   #define YYERROR_VERBOSE
+  #include "parser.h"
+
+  /* A construct spans from the start of its first symbol to the end of its last. */
+  #define YYLLOC_DEFAULT(Current, Rhs, N)                                        \
+    do {                                                                         \
+      if (N) {                                                                   \
+        (Current).offset = YYRHSLOC(Rhs, 1).offset;                              \
+        (Current).length = YYRHSLOC(Rhs, N).offset + YYRHSLOC(Rhs, N).length     \
+                         - YYRHSLOC(Rhs, 1).offset;                              \
+      } else {                                                                   \
+        (Current).offset = YYRHSLOC(Rhs, 0).offset + YYRHSLOC(Rhs, 0).length;    \
+        (Current).length = 0;                                                    \
+      }                                                                          \
+    } while (0)
+
   static void yyerror(YYLTYPE *loc, YYSTYPE *root,
                       int *error_count, yyscan_t scanner,
+                      struct parser_stream *stream,
                       char const *s);
+  static struct node *parser_add_statement(struct parser_stream *stream, YYLTYPE location,
+                                           struct node *init, struct node *statement);
 %}
 
 %token IDENTIFIER NUMBER STRING
@@ -59,11 +84,52 @@ additive_expr
           { $$ = node_binary_operation(yylloc, BINOP_SUBTRACTION, $1, $3); }
 ;
 
+and_expr
+  : shift_expr
+
+  | and_expr AMPERSAND shift_expr
+          { $$ = node_binary_operation(yylloc, BINOP_BITWISE_AND, $1, $3); }
+;
+
 assignment_expr
-  : additive_expr
+  : inclusive_or_expr
 
-  | primary_expr EQUAL additive_expr
+  | unary_expr EQUAL inclusive_or_expr
           { $$ = node_binary_operation(yylloc, BINOP_ASSIGN, $1, $3); }
+
+  | unary_expr ASTERISK_EQUAL inclusive_or_expr
+          { $$ = node_binary_operation(yylloc, BINOP_ASSIGN_MULTIPLICATION, $1, $3); }
+
+  | unary_expr SLASH_EQUAL inclusive_or_expr
+          { $$ = node_binary_operation(yylloc, BINOP_ASSIGN_DIVISION, $1, $3); }
+
+  | unary_expr PLUS_EQUAL inclusive_or_expr
+          { $$ = node_binary_operation(yylloc, BINOP_ASSIGN_ADDITION, $1, $3); }
+
+  | unary_expr MINUS_EQUAL inclusive_or_expr
+          { $$ = node_binary_operation(yylloc, BINOP_ASSIGN_SUBTRACTION, $1, $3); }
+
+  | unary_expr LESS_LESS_EQUAL inclusive_or_expr
+          { $$ = node_binary_operation(yylloc, BINOP_ASSIGN_LEFT_SHIFT, $1, $3); }
+
+  | unary_expr GREATER_GREATER_EQUAL inclusive_or_expr
+          { $$ = node_binary_operation(yylloc, BINOP_ASSIGN_RIGHT_SHIFT, $1, $3); }
+
+  | unary_expr AMPERSAND_EQUAL inclusive_or_expr
+          { $$ = node_binary_operation(yylloc, BINOP_ASSIGN_BITWISE_AND, $1, $3); }
+
+  | unary_expr CARET_EQUAL inclusive_or_expr
+          { $$ = node_binary_operation(yylloc, BINOP_ASSIGN_BITWISE_XOR, $1, $3); }
+
+  | unary_expr VBAR_EQUAL inclusive_or_expr
+          { $$ = node_binary_operation(yylloc, BINOP_ASSIGN_BITWISE_OR, $1, $3); }
+;
+
+exclusive_or_expr
+  : and_expr
+
+  | exclusive_or_expr CARET and_expr
+          { $$ = node_binary_operation(yylloc, BINOP_BITWISE_XOR, $1, $3); }
 ;
 
 expr
@@ -74,16 +140,33 @@ identifier
   : IDENTIFIER
 ;
 
+inclusive_or_expr
+  : exclusive_or_expr
+
+  | inclusive_or_expr VBAR exclusive_or_expr
+          { $$ = node_binary_operation(yylloc, BINOP_BITWISE_OR, $1, $3); }
+;
+
 multiplicative_expr
-  : primary_expr
+  : unary_expr
 
-  | multiplicative_expr ASTERISK primary_expr
+  | multiplicative_expr ASTERISK unary_expr
           { $$ = node_binary_operation(yylloc, BINOP_MULTIPLICATION, $1, $3); }
 
-  | multiplicative_expr SLASH primary_expr
+  | multiplicative_expr SLASH unary_expr
           { $$ = node_binary_operation(yylloc, BINOP_DIVISION, $1, $3); }
 ;
 
+postfix_expr
+  : primary_expr
+
+  | postfix_expr PLUS_PLUS
+          { $$ = node_increment(yylloc, @2, BINOP_POST_INCREMENT, $1); }
+
+  | postfix_expr MINUS_MINUS
+          { $$ = node_increment(yylloc, @2, BINOP_POST_DECREMENT, $1); }
+;
+
 primary_expr
   : identifier
 
@@ -98,6 +181,16 @@ program
           { *root = $1; }
 ;
 
+shift_expr
+  : additive_expr
+
+  | shift_expr LESS_LESS additive_expr
+          { $$ = node_binary_operation(yylloc, BINOP_LEFT_SHIFT, $1, $3); }
+
+  | shift_expr GREATER_GREATER additive_expr
+          { $$ = node_binary_operation(yylloc, BINOP_RIGHT_SHIFT, $1, $3); }
+;
+
 statement
   : expr SEMICOLON
           { $$ = node_expression_statement(yylloc, $1); }
@@ -108,9 +201,19 @@ statement
 
 statement_list
   : statement
-          { $$ = node_statement_list(yylloc, NULL, $1); }
+          { $$ = parser_add_statement(stream, yylloc, NULL, $1); }
   | statement_list statement
-          { $$ = node_statement_list(yylloc, $1, $2); }
+          { $$ = parser_add_statement(stream, yylloc, $1, $2); }
+;
+
+unary_expr
+  : postfix_expr
+
+  | PLUS_PLUS unary_expr
+          { $$ = node_increment(yylloc, @1, BINOP_ASSIGN_ADDITION, $2); }
+
+  | MINUS_MINUS unary_expr
+          { $$ = node_increment(yylloc, @1, BINOP_ASSIGN_SUBTRACTION, $2); }
 ;
 
 %%
@@ -119,15 +222,34 @@ static void yyerror(YYLTYPE *loc,
                     YYSTYPE *root __attribute__((unused)),
                     int *error_count,
                     yyscan_t scanner __attribute__((unused)),
+                    struct parser_stream *stream __attribute__((unused)),
                     char const *s)
 {
   compiler_print_error(*loc, s);
   (*error_count)++;
 }
 
+/*
+ * When streaming, each statement is handed off as soon as it is reduced and
+ * no statement list is built.
+ */
+static struct node *parser_add_statement(struct parser_stream *stream, YYLTYPE location,
+                                         struct node *init, struct node *statement) {
+  if (NULL == stream) {
+    return node_statement_list(location, init, statement);
+  }
+  stream->handler(statement, stream->context);
+  return NULL;
+}
+
+/*
+ * When built with the precedence-climbing parser in climb.c, only the token
+ * table is used from this file.
+ */
+#ifndef PARSER_PRECEDENCE_CLIMBING
 struct node *parser_create_tree(int *error_count, yyscan_t scanner) {
   struct node *parse_tree;
-  int result = yyparse(&parse_tree, error_count, scanner);
+  int result = yyparse(&parse_tree, error_count, scanner, NULL);
   if (result == 1 || *error_count > 0) {
     return NULL;
   } else if (result == 2) {
@@ -138,6 +260,22 @@ struct node *parser_create_tree(int *error_count, yyscan_t scanner) {
   }
 }
 
+int parser_stream_statements(int *error_count, yyscan_t scanner,
+                             parser_statement_handler handler, void *context) {
+  struct parser_stream stream;
+  struct node *parse_tree;
+  int result;
+
+  stream.handler = handler;
+  stream.context = context;
+  result = yyparse(&parse_tree, error_count, scanner, &stream);
+  if (result == 2) {
+    fprintf(stdout, "Parser ran out of memory.\n");
+  }
+  return result;
+}
+#endif
+
 char const *parser_token_name(int token) {
   return yytname[token - 255];
 }
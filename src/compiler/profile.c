@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "profile.h"
+
+/*
+ * A profile is the header word PROFILE_MAGIC, the number of counters, and
+ * then the counters, as the program wrote them from memory. Its byte order
+ * is that of the machine that ran the program, which is found from the
+ * magic word.
+ */
+
+static uint32_t profile_word(uint8_t const *bytes, bool big_endian) {
+  if (big_endian) {
+    return (uint32_t)bytes[0] << 24 | (uint32_t)bytes[1] << 16 | (uint32_t)bytes[2] << 8 | bytes[3];
+  }
+  return (uint32_t)bytes[3] << 24 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[1] << 8 | bytes[0];
+}
+
+/*
+ * profile_load - read the counts in the file name
+ *
+ * Prints an error and returns false when the file cannot be read or is not
+ * a profile.
+ */
+bool profile_load(struct profile *profile, char const *name) {
+  uint8_t header[8], *bytes;
+  bool big_endian;
+  uint32_t i;
+  FILE *input;
+
+  memset(profile, 0, sizeof(*profile));
+  input = fopen(name, "rb");
+  if (NULL == input) {
+    fprintf(stdout, "Could not open profile %s: %s\n", name, strerror(errno));
+    return false;
+  }
+
+  if (sizeof(header) != fread(header, 1, sizeof(header), input)
+      || (PROFILE_MAGIC != profile_word(header, true) && PROFILE_MAGIC != profile_word(header, false))) {
+    fprintf(stdout, "Could not read profile %s: it was not written by -fprofile-generate.\n", name);
+    fclose(input);
+    return false;
+  }
+  big_endian = PROFILE_MAGIC == profile_word(header, true);
+  profile->count = profile_word(header + 4, big_endian);
+
+  /* A complete profile ends just after its last counter. */
+  if (0 != fseek(input, 0, SEEK_END) || (long)(sizeof(header) + 4 * (uint64_t)profile->count) != ftell(input)
+      || 0 != fseek(input, (long)sizeof(header), SEEK_SET)) {
+    fprintf(stdout, "Could not read profile %s: it does not hold the %lu counters its header gives.\n",
+            name, (unsigned long)profile->count);
+    fclose(input);
+    return false;
+  }
+  bytes = malloc(4 * (size_t)profile->count + 1);
+  profile->counts = malloc(sizeof(uint32_t) * ((size_t)profile->count + 1));
+  assert(NULL != bytes && NULL != profile->counts);
+  if (4 * (size_t)profile->count != fread(bytes, 1, 4 * (size_t)profile->count, input)) {
+    fprintf(stdout, "Could not read profile %s: %s\n", name, strerror(errno));
+    fclose(input);
+    free(bytes);
+    profile_destroy(profile);
+    return false;
+  }
+  fclose(input);
+
+  for (i = 0; i < profile->count; i++) {
+    profile->counts[i] = profile_word(bytes + 4 * i, big_endian);
+    if (profile->counts[i] > profile->max) {
+      profile->max = profile->counts[i];
+    }
+  }
+  free(bytes);
+  return true;
+}
+
+void profile_destroy(struct profile *profile) {
+  free(profile->counts);
+  profile->counts = NULL;
+  profile->count = 0;
+}
+
+/*
+ * profile_heat - how hot the statement numbered statement ran
+ *
+ * A statement is hot when it ran at least half as often as the hottest one,
+ * and cold when it never ran.
+ */
+enum profile_heat profile_heat(struct profile *profile, unsigned long statement) {
+  enum profile_heat heat;
+  uint32_t count;
+
+  if (statement >= profile->count) {
+    heat = PROFILE_UNKNOWN;
+  } else if (0 == (count = profile->counts[statement])) {
+    heat = PROFILE_COLD;
+  } else if (2 * (uint64_t)count >= profile->max) {
+    heat = PROFILE_HOT;
+  } else {
+    heat = PROFILE_WARM;
+  }
+  profile->lookups[heat]++;
+  return heat;
+}
+
+/*
+ * profile_print_statistics - print how the statements looked up were found
+ *
+ * Statements missing from the profile mean it was written for a different
+ * program.
+ */
+void profile_print_statistics(FILE *output, struct profile *profile) {
+  fprintf(output, "profile: %lu counters, hottest ran %lu times; statements %lu hot, %lu warm, %lu cold, %lu missing\n",
+          (unsigned long)profile->count, (unsigned long)profile->max,
+          profile->lookups[PROFILE_HOT], profile->lookups[PROFILE_WARM],
+          profile->lookups[PROFILE_COLD], profile->lookups[PROFILE_UNKNOWN]);
+}
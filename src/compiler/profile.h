@@ -0,0 +1,37 @@
+#ifndef _PROFILE_H
+#define _PROFILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* The first word of a profile, "PROF" when written big-endian. */
+#define PROFILE_MAGIC 0x50524f46ul
+
+/*
+ * How often a statement ran in the profile, relative to the statement that
+ * ran most often. Statements past the end of the profile are unknown.
+ */
+enum profile_heat {
+  PROFILE_UNKNOWN,
+  PROFILE_COLD,
+  PROFILE_WARM,
+  PROFILE_HOT
+};
+
+/* The counts written by a program compiled with -fprofile-generate. */
+struct profile {
+  uint32_t *counts;
+  uint32_t count;
+  uint32_t max;
+  unsigned long lookups[PROFILE_HOT + 1];
+};
+
+bool profile_load(struct profile *profile, char const *name);
+void profile_destroy(struct profile *profile);
+
+enum profile_heat profile_heat(struct profile *profile, unsigned long statement);
+
+void profile_print_statistics(FILE *output, struct profile *profile);
+
+#endif /* _PROFILE_H */
@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <sched.h>
+#include <time.h>
+#include <stdatomic.h>
+
+#include "queue.h"
+
+/*
+ * The head and tail only ever grow; an item's slot is its index masked by
+ * the capacity, which is a power of two. Each side keeps a copy of the
+ * other's index and only reloads it when the copy says the queue is full
+ * (or empty), so in the steady state a push or pop touches no cache line
+ * the other thread writes.
+ *
+ * The depth of the queue is sampled by the producer every
+ * QUEUE_DEPTH_SAMPLE_INTERVAL pushes, since reading the head on every push
+ * would bring back the sharing the copies avoid.
+ *
+ * A side that has to wait yields the processor between attempts, and the
+ * time it spends waiting is recorded for the statistics.
+ */
+
+static unsigned long long queue_now_ns(void) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * 1000000000ull + (unsigned long long)now.tv_nsec;
+}
+
+/*
+ * queue_initialize - create an empty queue of at least capacity items
+ */
+void queue_initialize(struct queue *queue, size_t capacity) {
+  size_t size = 1;
+
+  while (size < capacity) {
+    size *= 2;
+  }
+  queue->items = malloc(size * sizeof(void *));
+  assert(NULL != queue->items);
+  queue->mask = size - 1;
+
+  atomic_init(&queue->tail, 0);
+  queue->cached_head = 0;
+  queue->pushes = 0;
+  queue->depth_samples = 0;
+  queue->total_depth = 0;
+  queue->max_depth = 0;
+  queue->producer_stall_ns = 0;
+
+  atomic_init(&queue->head, 0);
+  queue->cached_tail = 0;
+  queue->consumer_stall_ns = 0;
+}
+
+void queue_destroy(struct queue *queue) {
+  free(queue->items);
+}
+
+/*
+ * queue_push - add item at the tail, waiting while the queue is full
+ *
+ * Only the producer may call this.
+ */
+void queue_push(struct queue *queue, void *item) {
+  size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+  unsigned long long start;
+  size_t depth;
+
+  if (tail - queue->cached_head > queue->mask) {
+    queue->cached_head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    if (tail - queue->cached_head > queue->mask) {
+      start = queue_now_ns();
+      do {
+        sched_yield();
+        queue->cached_head = atomic_load_explicit(&queue->head, memory_order_acquire);
+      } while (tail - queue->cached_head > queue->mask);
+      queue->producer_stall_ns += queue_now_ns() - start;
+    }
+  }
+
+  queue->items[tail & queue->mask] = item;
+  atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+
+  /* Sample the depth now and then, which also refreshes the copy of head. */
+  if (0 == queue->pushes++ % QUEUE_DEPTH_SAMPLE_INTERVAL) {
+    queue->cached_head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    depth = tail + 1 - queue->cached_head;
+    queue->depth_samples++;
+    queue->total_depth += depth;
+    if (depth > queue->max_depth) {
+      queue->max_depth = depth;
+    }
+  }
+}
+
+/*
+ * queue_pop - take the item at the head, waiting while the queue is empty
+ *
+ * Only the consumer may call this.
+ */
+void *queue_pop(struct queue *queue) {
+  size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+  unsigned long long start;
+  void *item;
+
+  if (head == queue->cached_tail) {
+    queue->cached_tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    if (head == queue->cached_tail) {
+      start = queue_now_ns();
+      do {
+        sched_yield();
+        queue->cached_tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+      } while (head == queue->cached_tail);
+      queue->consumer_stall_ns += queue_now_ns() - start;
+    }
+  }
+
+  item = queue->items[head & queue->mask];
+  atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+  return item;
+}
+
+/*
+ * queue_print_statistics - print how full the queue ran and how long each
+ * side waited
+ *
+ * Call this once both threads are done with the queue.
+ */
+void queue_print_statistics(FILE *output, struct queue *queue) {
+  fprintf(output, "queue: %lu items, depth max %lu mean %.2f of %lu\n",
+          queue->pushes, (unsigned long)queue->max_depth,
+          queue->depth_samples > 0 ? (double)queue->total_depth / (double)queue->depth_samples : 0.0,
+          (unsigned long)(queue->mask + 1));
+  fprintf(output, "queue: producer stalled %.3f ms on a full queue, consumer stalled %.3f ms on an empty queue\n",
+          (double)queue->producer_stall_ns / 1e6, (double)queue->consumer_stall_ns / 1e6);
+}
@@ -0,0 +1,41 @@
+#ifndef _QUEUE_H
+#define _QUEUE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#define QUEUE_CACHE_LINE 64
+#define QUEUE_DEPTH_SAMPLE_INTERVAL 64
+
+/*
+ * A bounded queue of pointers between exactly one producer thread and one
+ * consumer thread. Each index is written by one side only and lives on its
+ * own cache line, next to the fields only that side touches.
+ */
+struct queue {
+  void **items;
+  size_t mask;
+
+  _Alignas(QUEUE_CACHE_LINE) atomic_size_t tail;
+  size_t cached_head;
+  unsigned long pushes;
+  unsigned long depth_samples;
+  unsigned long long total_depth;
+  size_t max_depth;
+  unsigned long long producer_stall_ns;
+
+  _Alignas(QUEUE_CACHE_LINE) atomic_size_t head;
+  size_t cached_tail;
+  unsigned long long consumer_stall_ns;
+};
+
+void queue_initialize(struct queue *queue, size_t capacity);
+void queue_destroy(struct queue *queue);
+
+void queue_push(struct queue *queue, void *item);
+void *queue_pop(struct queue *queue);
+
+void queue_print_statistics(FILE *output, struct queue *queue);
+
+#endif /* _QUEUE_H */
@@ -0,0 +1,322 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+
+#include "ir.h"
+#include "range.h"
+
+/*
+ * Value-range analysis of the IR, run after IR generation at -O1 and above.
+ *
+ * Every value is a 32-bit unsigned number, and the range of a temporary is
+ * an interval [low, high] of them, with [0, 2^32 - 1] standing for nothing
+ * known. A program has no branches, so a single pass over its instructions
+ * in order knows the range every temporary holds at each one, even though
+ * x += k and the like update a variable's temporary in place. An operation
+ * whose result might wrap around 2^32 partway through its range gives the
+ * full range.
+ *
+ * The ranges are used to rewrite divides:
+ *
+ *   d = s / t, every quotient the same    li d, q
+ *   d = s / t, t a power of two 2^k       srl d, s, k (or a copy when k is 0)
+ *   d = s / t, t never zero               divu s, t; mflo d, without the
+ *                                         zero check of the divu pseudo-op
+ *
+ * A divide whose divisor might be zero keeps its check, so a program that
+ * divides by zero still breaks where it did.
+ *
+ * A streaming compile hands over its sections a statement at a time, so the
+ * ranges carry over from one section to the next, in a direct-mapped table
+ * of RANGE_TABLE_SIZE temporaries that keeps its memory flat. A temporary
+ * whose entry has been taken over by a later one is no longer known, which
+ * can only cost a divide its rewrite.
+ */
+
+#define RANGE_MASK 0xFFFFFFFFul
+
+/* The amount of a variable shift is the low five bits of its operand. */
+#define RANGE_SHIFT_MASK 31ul
+
+struct range {
+  unsigned long low;
+  unsigned long high;
+};
+
+struct range_entry {
+  bool known;
+  int temporary;
+  struct range range;
+};
+
+static struct range_entry range_table[RANGE_TABLE_SIZE];
+
+static struct {
+  unsigned long divides;
+  unsigned long unchecked;
+  unsigned long shifts;
+  unsigned long constants;
+} range_statistics;
+
+/*
+ * range_reset - forget the ranges and statistics of the last compile
+ *
+ * Temporaries are numbered from zero again by every compile.
+ */
+void range_reset(void) {
+  memset(range_table, 0, sizeof(range_table));
+  memset(&range_statistics, 0, sizeof(range_statistics));
+}
+
+static struct range range_of(unsigned long low, unsigned long high) {
+  struct range range;
+
+  range.low = low & RANGE_MASK;
+  range.high = high & RANGE_MASK;
+  return range;
+}
+
+static struct range range_of_operand(struct ir_operand *operand) {
+  struct range_entry *entry;
+
+  if (OPERAND_NUMBER == operand->kind) {
+    return range_of(operand->data.number, operand->data.number);
+  }
+  entry = &range_table[operand->data.temporary & (RANGE_TABLE_SIZE - 1)];
+  if (entry->known && entry->temporary == operand->data.temporary) {
+    return entry->range;
+  }
+  return range_of(0, RANGE_MASK);
+}
+
+static void range_set(struct ir_operand *operand, struct range range) {
+  struct range_entry *entry;
+
+  assert(OPERAND_TEMPORARY == operand->kind);
+  entry = &range_table[operand->data.temporary & (RANGE_TABLE_SIZE - 1)];
+  entry->known = true;
+  entry->temporary = operand->data.temporary;
+  entry->range = range;
+}
+
+static bool range_is_constant(struct range range) {
+  return range.low == range.high;
+}
+
+/* The smallest number of the form 2^k - 1 that is at least value. */
+static unsigned long range_fill(unsigned long value) {
+  value |= value >> 1;
+  value |= value >> 2;
+  value |= value >> 4;
+  value |= value >> 8;
+  value |= value >> 16;
+  return value;
+}
+
+static struct range range_sum(struct range left, struct range right) {
+  /* Either no sum wraps around or they all do. */
+  if ((left.low > RANGE_MASK - right.low) != (left.high > RANGE_MASK - right.high)) {
+    return range_of(0, RANGE_MASK);
+  }
+  return range_of(left.low + right.low, left.high + right.high);
+}
+
+static struct range range_difference(struct range left, struct range right) {
+  if (left.low < right.high && left.high >= right.low) {
+    return range_of(0, RANGE_MASK);
+  }
+  return range_of(left.low - right.high, left.high - right.low);
+}
+
+static struct range range_product(struct range left, struct range right) {
+  if (0 != left.high && right.high > RANGE_MASK / left.high) {
+    return range_of(0, RANGE_MASK);
+  }
+  return range_of(left.low * right.low, left.high * right.high);
+}
+
+/* A divisor of zero breaks; the value left behind is unknown. */
+static struct range range_quotient(struct range left, struct range right) {
+  if (0 == right.low) {
+    return range_of(0, RANGE_MASK);
+  }
+  return range_of(left.low / right.high, left.high / right.low);
+}
+
+static struct range range_shift_amount(struct range amount) {
+  if (amount.high > RANGE_SHIFT_MASK) {
+    return range_of(0, RANGE_SHIFT_MASK);
+  }
+  return amount;
+}
+
+static struct range range_shift_left(struct range left, struct range amount) {
+  amount = range_shift_amount(amount);
+  if (left.high > RANGE_MASK >> amount.high) {
+    return range_of(0, RANGE_MASK);
+  }
+  return range_of(left.low << amount.low, left.high << amount.high);
+}
+
+static struct range range_shift_right(struct range left, struct range amount) {
+  amount = range_shift_amount(amount);
+  return range_of(left.low >> amount.high, left.high >> amount.low);
+}
+
+static struct range range_bitwise(enum ir_instruction_kind kind, struct range left, struct range right) {
+  if (range_is_constant(left) && range_is_constant(right)) {
+    switch (kind) {
+      case IR_AND:
+        return range_of(left.low & right.low, left.low & right.low);
+      case IR_XOR:
+        return range_of(left.low ^ right.low, left.low ^ right.low);
+      default:
+        return range_of(left.low | right.low, left.low | right.low);
+    }
+  }
+
+  switch (kind) {
+    case IR_AND:
+      return range_of(0, left.high < right.high ? left.high : right.high);
+    case IR_XOR:
+      return range_of(0, range_fill(left.high | right.high));
+    default:
+      return range_of(left.low > right.low ? left.low : right.low, range_fill(left.high | right.high));
+  }
+}
+
+/*
+ * range_narrow_divide - rewrite a divide as the cheapest instruction the
+ * ranges of its operands allow
+ */
+static void range_narrow_divide(struct ir_instruction *instruction, struct range dividend, struct range divisor) {
+  struct range quotient = range_quotient(dividend, divisor);
+  unsigned long shift;
+
+  range_statistics.divides++;
+  if (0 == divisor.low) {
+    return;
+  }
+
+  if (range_is_constant(quotient)) {
+    instruction->kind = IR_LOAD_IMMEDIATE;
+    instruction->operands[1].kind = OPERAND_NUMBER;
+    instruction->operands[1].data.number = quotient.low;
+    range_statistics.constants++;
+  } else if (range_is_constant(divisor) && 0 == (divisor.low & (divisor.low - 1))) {
+    for (shift = 0; (1ul << shift) < divisor.low; shift++) {
+    }
+    if (0 == shift) {
+      instruction->kind = IR_COPY;
+    } else {
+      instruction->kind = IR_SHIFT_RIGHT_IMMEDIATE;
+      instruction->operands[2].kind = OPERAND_NUMBER;
+      instruction->operands[2].data.number = shift;
+    }
+    range_statistics.shifts++;
+  } else {
+    instruction->kind = IR_DIVIDE_NONZERO;
+    range_statistics.unchecked++;
+  }
+}
+
+/*
+ * range_walk_section - follow the ranges through the instructions of
+ * section, and rewrite its divides when narrow is set
+ */
+static void range_walk_section(struct ir_section *section, bool narrow) {
+  struct ir_instruction *instruction;
+  struct range left, right, result;
+
+  for (instruction = section->first; instruction != section->last->next; instruction = instruction->next) {
+    if (IR_NO_OPERATION == instruction->kind || IR_PRINT_NUMBER == instruction->kind
+        || IR_PROFILE_COUNT == instruction->kind) {
+      continue;
+    }
+
+    left = range_of_operand(&instruction->operands[1]);
+    switch (instruction->kind) {
+      case IR_LOAD_IMMEDIATE:
+      case IR_COPY:
+        result = left;
+        break;
+
+      case IR_ADD:
+      case IR_ADD_IMMEDIATE:
+        result = range_sum(left, range_of_operand(&instruction->operands[2]));
+        break;
+
+      case IR_SUBTRACT:
+        result = range_difference(left, range_of_operand(&instruction->operands[2]));
+        break;
+
+      case IR_MULTIPLY:
+        result = range_product(left, range_of_operand(&instruction->operands[2]));
+        break;
+
+      case IR_DIVIDE:
+        right = range_of_operand(&instruction->operands[2]);
+        result = range_quotient(left, right);
+        if (narrow) {
+          range_narrow_divide(instruction, left, right);
+        }
+        break;
+
+      case IR_DIVIDE_NONZERO:
+        result = range_quotient(left, range_of_operand(&instruction->operands[2]));
+        break;
+
+      case IR_SHIFT_LEFT:
+      case IR_SHIFT_LEFT_IMMEDIATE:
+        result = range_shift_left(left, range_of_operand(&instruction->operands[2]));
+        break;
+
+      case IR_SHIFT_RIGHT:
+      case IR_SHIFT_RIGHT_IMMEDIATE:
+        result = range_shift_right(left, range_of_operand(&instruction->operands[2]));
+        break;
+
+      case IR_AND:
+      case IR_XOR:
+      case IR_OR:
+        result = range_bitwise(instruction->kind, left, range_of_operand(&instruction->operands[2]));
+        break;
+
+      default:
+        assert(0);
+        result = range_of(0, RANGE_MASK);
+        break;
+    }
+    range_set(&instruction->operands[0], result);
+  }
+}
+
+/*
+ * range_narrow_section - follow the ranges through the instructions of
+ * section, and rewrite its divides
+ *
+ * The sections of a program must be narrowed in the order they run.
+ */
+void range_narrow_section(struct ir_section *section) {
+  range_walk_section(section, true);
+}
+
+/*
+ * range_follow_section - follow the ranges through a section that was
+ * narrowed before, without counting or rewriting anything
+ *
+ * Following the sections of a program narrowed in an earlier compile leaves
+ * the ranges as narrowing them did, since each rewrite gives its temporary
+ * the range of the divide it replaced. An incremental compile uses this to
+ * pick up after the statements it keeps.
+ */
+void range_follow_section(struct ir_section *section) {
+  range_walk_section(section, false);
+}
+
+void range_print_statistics(FILE *output) {
+  fprintf(output, "range: %lu divides, %lu to constants, %lu to shifts, %lu without a zero check\n",
+          range_statistics.divides, range_statistics.constants, range_statistics.shifts,
+          range_statistics.unchecked);
+}
@@ -0,0 +1,17 @@
+#ifndef _RANGE_H
+#define _RANGE_H
+
+#include <stdio.h>
+
+struct ir_section;
+
+/* The temporaries whose ranges are remembered at once. A power of two. */
+#define RANGE_TABLE_SIZE 4096
+
+void range_reset(void);
+void range_narrow_section(struct ir_section *section);
+void range_follow_section(struct ir_section *section);
+
+void range_print_statistics(FILE *output);
+
+#endif /* _RANGE_H */
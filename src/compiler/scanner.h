@@ -2,9 +2,15 @@
 #define _SCANNER_H
 
 #include "parser.h"
+#ifdef SCANNER_SIMD
+#include "lexer.h"
+#else
 #include "scanner.yy.h"
+#endif
 
 void scanner_initialize(yyscan_t *scanner, FILE *input);
+void scanner_restart(yyscan_t scanner, FILE *input);
+void scanner_start_at(yyscan_t scanner, uint32_t offset);
 void scanner_destroy(yyscan_t *scanner);
 void scanner_print_tokens(FILE *output, int *error_count, yyscan_t scanner);
 
@@ -0,0 +1,583 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+#include "server.h"
+
+/*
+ * Most compiles are small enough that setting up for them costs more than
+ * the compile. A compile server listens on a Unix domain socket and keeps a
+ * set of worker processes running, each of which compiles one request at a
+ * time and keeps its scanner, its memory and the text of the MIPS layout
+ * from one request to the next. The client still starts a process, so it
+ * only reads the source and sends it.
+ *
+ * A client sends its command line, its working directory and its source,
+ * and passes its stdout and stderr along with them, so the worker writes the
+ * stage dumps, the diagnostics and the statistics straight to the client's.
+ * The worker changes to the client's directory, so the output file and any
+ * other files named on the command line are the client's. When the compile
+ * is done the worker sends back its exit status.
+ *
+ * The workers all accept on the listening socket, so the kernel hands each
+ * connection to a worker that is free, and connections wait in the backlog
+ * while all of them are busy. A worker that dies is replaced.
+ *
+ * Each worker times its requests from accepting the connection to sending
+ * the status, and writes the time to a pipe the server reads. The server
+ * prints the percentiles of the times when it gets SIGUSR1, and when it is
+ * stopped with SIGINT or SIGTERM. The same pipe wakes the server up when it
+ * gets a signal: a time of 0 stands for a signal.
+ */
+
+#define SERVER_MAGIC 0x45393553u
+
+struct server_request {
+  uint32_t magic;
+  uint32_t argc;
+
+  /* The arguments and then the working directory, each ending in a NUL. */
+  uint32_t strings_length;
+  uint32_t has_source;
+  uint64_t source_length;
+};
+
+/* What a worker keeps between requests. */
+struct server_worker {
+  int listener;
+  int times;
+  server_compile_function *compile;
+  int saved_stdout;
+  int saved_stderr;
+
+  char strings[SERVER_MAX_STRINGS];
+  char *arguments[SERVER_MAX_ARGUMENTS + 1];
+  char *source;
+  size_t source_capacity;
+};
+
+struct server_times {
+  uint64_t *times;
+  size_t count;
+  size_t capacity;
+};
+
+static volatile sig_atomic_t server_stopping;
+static volatile sig_atomic_t server_reporting;
+static int server_wakeup_fd = -1;
+
+static unsigned long long server_now_ns(void) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * 1000000000ull + (unsigned long long)now.tv_nsec;
+}
+
+static bool server_write_all(int fd, void const *bytes, size_t length) {
+  ssize_t count;
+
+  while (length > 0) {
+    count = send(fd, bytes, length, MSG_NOSIGNAL);
+    if (count < 0 && EINTR == errno) {
+      continue;
+    } else if (count <= 0) {
+      return false;
+    }
+    bytes = (char const *)bytes + count;
+    length -= (size_t)count;
+  }
+  return true;
+}
+
+static bool server_read_all(int fd, void *bytes, size_t length) {
+  ssize_t count;
+
+  while (length > 0) {
+    count = read(fd, bytes, length);
+    if (count < 0 && EINTR == errno) {
+      continue;
+    } else if (count <= 0) {
+      return false;
+    }
+    bytes = (char *)bytes + count;
+    length -= (size_t)count;
+  }
+  return true;
+}
+
+static bool server_set_address(struct sockaddr_un *address, char const *path) {
+  if (strlen(path) >= sizeof(address->sun_path)) {
+    fprintf(stdout, "Socket path %s is too long.\n", path);
+    return false;
+  }
+  memset(address, 0, sizeof(struct sockaddr_un));
+  address->sun_family = AF_UNIX;
+  strcpy(address->sun_path, path);
+  return true;
+}
+
+static int server_connect(struct sockaddr_un *address) {
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+  if (fd >= 0 && 0 != connect(fd, (struct sockaddr *)address, sizeof(struct sockaddr_un))) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/*************
+ * A REQUEST *
+ *************/
+
+/*
+ * server_receive - read a request, and take the client's stdout and stderr
+ * into fds
+ *
+ * Returns the number of arguments, or 0 when the request is malformed.
+ */
+static int server_receive(struct server_worker *worker, int connection, struct server_request *request, int fds[2]) {
+  union {
+    struct cmsghdr header;
+    char bytes[CMSG_SPACE(2 * sizeof(int))];
+  } control;
+  struct msghdr message;
+  struct cmsghdr *header;
+  struct iovec vector;
+  ssize_t count;
+  uint32_t i;
+  int argc = 0;
+
+  vector.iov_base = request;
+  vector.iov_len = sizeof(struct server_request);
+  memset(&message, 0, sizeof(message));
+  message.msg_iov = &vector;
+  message.msg_iovlen = 1;
+  message.msg_control = control.bytes;
+  message.msg_controllen = sizeof(control.bytes);
+  do {
+    count = recvmsg(connection, &message, 0);
+  } while (count < 0 && EINTR == errno);
+
+  header = count > 0 ? CMSG_FIRSTHDR(&message) : NULL;
+  if (NULL == header || SOL_SOCKET != header->cmsg_level || SCM_RIGHTS != header->cmsg_type
+      || CMSG_LEN(2 * sizeof(int)) != header->cmsg_len) {
+    return 0;
+  }
+  memcpy(fds, CMSG_DATA(header), 2 * sizeof(int));
+
+  if (!server_read_all(connection, (char *)request + count, sizeof(struct server_request) - (size_t)count)
+      || SERVER_MAGIC != request->magic
+      || request->argc < 1 || request->argc > SERVER_MAX_ARGUMENTS
+      || request->strings_length < 1 || request->strings_length > SERVER_MAX_STRINGS
+      || !server_read_all(connection, worker->strings, request->strings_length)
+      || '\0' != worker->strings[request->strings_length - 1]) {
+    goto malformed;
+  }
+
+  /* Split the strings into the arguments and the directory. */
+  worker->arguments[argc++] = worker->strings;
+  for (i = 0; i + 1 < request->strings_length; i++) {
+    if ('\0' == worker->strings[i]) {
+      if ((uint32_t)argc > request->argc) {
+        goto malformed;
+      }
+      worker->arguments[argc++] = worker->strings + i + 1;
+    }
+  }
+  if ((uint32_t)argc != request->argc + 1) {
+    goto malformed;
+  }
+
+  if (request->has_source) {
+    if (request->source_length + 1 > worker->source_capacity) {
+      free(worker->source);
+      worker->source_capacity = request->source_length + 1;
+      worker->source = malloc(worker->source_capacity);
+      assert(NULL != worker->source);
+    }
+    if (!server_read_all(connection, worker->source, request->source_length)) {
+      goto malformed;
+    }
+    worker->source[request->source_length] = '\0';
+  }
+  return (int)request->argc;
+
+malformed:
+  close(fds[0]);
+  close(fds[1]);
+  return 0;
+}
+
+/* Compile one request on the connection, with the client's stdout and stderr in place of the worker's. */
+static void server_serve(struct server_worker *worker, int connection) {
+  struct server_request request;
+  unsigned long long start = server_now_ns();
+  uint64_t time;
+  int32_t status = 1;
+  int fds[2], argc;
+  char *directory;
+
+  argc = server_receive(worker, connection, &request, fds);
+  if (0 == argc) {
+    close(connection);
+    return;
+  }
+  directory = worker->arguments[argc];
+  worker->arguments[argc] = NULL;
+
+  fflush(stdout);
+  fflush(stderr);
+  dup2(fds[0], STDOUT_FILENO);
+  dup2(fds[1], STDERR_FILENO);
+  close(fds[0]);
+  close(fds[1]);
+
+  if (0 != chdir(directory)) {
+    fprintf(stdout, "Could not change to directory %s: %s\n", directory, strerror(errno));
+  } else {
+    status = worker->compile(argc, worker->arguments, request.has_source ? worker->source : NULL,
+                             (size_t)request.source_length);
+  }
+
+  fflush(stdout);
+  fflush(stderr);
+  clearerr(stdout);
+  clearerr(stderr);
+  dup2(worker->saved_stdout, STDOUT_FILENO);
+  dup2(worker->saved_stderr, STDERR_FILENO);
+
+  server_write_all(connection, &status, sizeof(status));
+  close(connection);
+
+  time = server_now_ns() - start;
+  if (0 == time) {
+    time = 1;
+  }
+  if (sizeof(time) != write(worker->times, &time, sizeof(time))) {
+    /* The server is behind on reading the times; this one is lost. */
+  }
+}
+
+/* A worker process never returns. */
+static void server_work(struct server_worker *worker) {
+  int connection, null;
+
+  signal(SIGINT, SIG_DFL);
+  signal(SIGTERM, SIG_DFL);
+  signal(SIGCHLD, SIG_DFL);
+  signal(SIGUSR1, SIG_IGN);
+  signal(SIGPIPE, SIG_IGN);
+#ifdef __linux__
+  prctl(PR_SET_PDEATHSIG, SIGTERM);
+#endif
+
+  null = open("/dev/null", O_RDONLY);
+  if (null >= 0) {
+    dup2(null, STDIN_FILENO);
+    close(null);
+  }
+  worker->saved_stdout = dup(STDOUT_FILENO);
+  worker->saved_stderr = dup(STDERR_FILENO);
+  worker->source = NULL;
+  worker->source_capacity = 0;
+
+  for (;;) {
+    connection = accept(worker->listener, NULL, NULL);
+    if (connection >= 0) {
+      server_serve(worker, connection);
+    } else if (EINTR != errno && ECONNABORTED != errno) {
+      _exit(1);
+    }
+  }
+}
+
+/**************
+ * THE SERVER *
+ **************/
+
+static void server_signal(int signal) {
+  uint64_t wakeup = 0;
+  int saved_errno = errno;
+
+  if (SIGINT == signal || SIGTERM == signal) {
+    server_stopping = 1;
+  } else if (SIGUSR1 == signal) {
+    server_reporting = 1;
+  }
+  if (sizeof(wakeup) != write(server_wakeup_fd, &wakeup, sizeof(wakeup))) {
+    /* The pipe is full, so the server is awake anyway. */
+  }
+  errno = saved_errno;
+}
+
+static pid_t server_start_worker(struct server_worker *worker, int times) {
+  pid_t pid = fork();
+
+  if (0 == pid) {
+    close(times);
+    server_work(worker);
+  }
+  return pid;
+}
+
+static int server_compare_times(void const *left, void const *right) {
+  uint64_t a = *(uint64_t const *)left, b = *(uint64_t const *)right;
+  return a < b ? -1 : a > b;
+}
+
+/* The time below which the given per mille of the requests finished. */
+static double server_percentile(struct server_times *times, unsigned per_mille) {
+  size_t rank = (times->count * per_mille + 999) / 1000;
+
+  return (double)times->times[rank > 0 ? rank - 1 : 0] / 1e6;
+}
+
+static void server_print_times(FILE *output, struct server_times *times) {
+  if (0 == times->count) {
+    fprintf(output, "server: 0 requests\n");
+    return;
+  }
+  qsort(times->times, times->count, sizeof(uint64_t), server_compare_times);
+  fprintf(output, "server: %lu requests, latency p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, p99.9 %.3f ms, max %.3f ms\n",
+          (unsigned long)times->count, server_percentile(times, 500), server_percentile(times, 900),
+          server_percentile(times, 990), server_percentile(times, 999),
+          (double)times->times[times->count - 1] / 1e6);
+}
+
+static void server_add_times(struct server_times *times, uint64_t const *records, size_t count) {
+  size_t i;
+
+  for (i = 0; i < count; i++) {
+    if (0 == records[i]) {
+      continue;
+    }
+    if (times->count == times->capacity) {
+      times->capacity = times->capacity ? 2 * times->capacity : 1024;
+      times->times = realloc(times->times, times->capacity * sizeof(uint64_t));
+      assert(NULL != times->times);
+    }
+    times->times[times->count++] = records[i];
+  }
+}
+
+/*
+ * server_run - serve compiles on the Unix domain socket path with workers
+ * worker processes, until SIGINT or SIGTERM
+ *
+ * Returns the exit status of the server.
+ */
+int server_run(char const *path, int workers, server_compile_function *compile) {
+  struct sockaddr_un address;
+  struct server_worker *worker;
+  struct server_times times;
+  struct sigaction action;
+  uint64_t records[512];
+  ssize_t count;
+  pid_t *pids, pid;
+  int pipe_fds[2], fd, i, status;
+
+  if (!server_set_address(&address, path)) {
+    return 1;
+  }
+  fd = server_connect(&address);
+  if (fd >= 0) {
+    close(fd);
+    fprintf(stdout, "A compile server is already listening on %s.\n", path);
+    return 1;
+  }
+
+  worker = malloc(sizeof(struct server_worker));
+  assert(NULL != worker);
+  worker->compile = compile;
+  worker->listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  unlink(path);
+  if (worker->listener < 0
+      || 0 != bind(worker->listener, (struct sockaddr *)&address, sizeof(address))
+      || 0 != listen(worker->listener, SERVER_BACKLOG)) {
+    fprintf(stdout, "Could not listen on %s: %s\n", path, strerror(errno));
+    free(worker);
+    return 1;
+  }
+  if (0 != pipe(pipe_fds)) {
+    fprintf(stdout, "Could not create the server's pipe: %s\n", strerror(errno));
+    unlink(path);
+    free(worker);
+    return 1;
+  }
+  fcntl(pipe_fds[1], F_SETFL, O_NONBLOCK);
+  worker->times = server_wakeup_fd = pipe_fds[1];
+
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = server_signal;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+  sigaction(SIGUSR1, &action, NULL);
+  sigaction(SIGCHLD, &action, NULL);
+
+  fflush(stdout);
+  fflush(stderr);
+  pids = malloc((size_t)workers * sizeof(pid_t));
+  assert(NULL != pids);
+  for (i = 0; i < workers; i++) {
+    pids[i] = server_start_worker(worker, pipe_fds[0]);
+  }
+
+  times.times = NULL;
+  times.count = times.capacity = 0;
+  while (!server_stopping) {
+    count = read(pipe_fds[0], records, sizeof(records));
+    if (count > 0) {
+      server_add_times(&times, records, (size_t)count / sizeof(uint64_t));
+    }
+
+    /* Replace the workers that died. */
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+      for (i = 0; i < workers; i++) {
+        if (pids[i] == pid && !server_stopping) {
+          pids[i] = server_start_worker(worker, pipe_fds[0]);
+        }
+      }
+    }
+
+    if (server_reporting) {
+      server_reporting = 0;
+      server_print_times(stderr, &times);
+    }
+  }
+
+  for (i = 0; i < workers; i++) {
+    if (pids[i] > 0) {
+      kill(pids[i], SIGTERM);
+      waitpid(pids[i], &status, 0);
+    }
+  }
+  unlink(path);
+  close(worker->listener);
+
+  /* Collect the times written before the workers stopped. */
+  fcntl(pipe_fds[0], F_SETFL, O_NONBLOCK);
+  while ((count = read(pipe_fds[0], records, sizeof(records))) > 0) {
+    server_add_times(&times, records, (size_t)count / sizeof(uint64_t));
+  }
+  server_print_times(stderr, &times);
+
+  close(pipe_fds[0]);
+  close(pipe_fds[1]);
+  free(times.times);
+  free(pids);
+  free(worker);
+  return 0;
+}
+
+/**************
+ * THE CLIENT *
+ **************/
+
+/*
+ * server_send - have the server at path compile with the command line argv
+ * and source, which is NULL when the compile reads no input
+ *
+ * Returns the exit status of the compile.
+ */
+int server_send(char const *path, int argc, char **argv, char const *source, size_t length, bool print_statistics) {
+  union {
+    struct cmsghdr header;
+    char bytes[CMSG_SPACE(2 * sizeof(int))];
+  } control;
+  struct sockaddr_un address;
+  struct server_request request;
+  struct msghdr message;
+  struct cmsghdr *header;
+  struct iovec vector;
+  char directory[PATH_MAX], *strings;
+  unsigned long long start = server_now_ns();
+  int fds[2] = { STDOUT_FILENO, STDERR_FILENO };
+  size_t strings_length = 0, size;
+  int32_t status;
+  int connection, i;
+  bool ok;
+
+  if (argc > SERVER_MAX_ARGUMENTS || NULL == getcwd(directory, sizeof(directory))) {
+    fprintf(stdout, "Could not send the compile to the server: the command line or directory is too long.\n");
+    return 1;
+  }
+  strings = malloc(SERVER_MAX_STRINGS);
+  assert(NULL != strings);
+  for (i = 0; i <= argc; i++) {
+    size = strlen(i < argc ? argv[i] : directory) + 1;
+    if (strings_length + size > SERVER_MAX_STRINGS) {
+      fprintf(stdout, "Could not send the compile to the server: the command line or directory is too long.\n");
+      free(strings);
+      return 1;
+    }
+    memcpy(strings + strings_length, i < argc ? argv[i] : directory, size);
+    strings_length += size;
+  }
+
+  if (!server_set_address(&address, path)) {
+    free(strings);
+    return 1;
+  }
+  connection = server_connect(&address);
+  if (connection < 0) {
+    fprintf(stdout, "Could not connect to the compile server on %s: %s\n", path, strerror(errno));
+    free(strings);
+    return 1;
+  }
+
+  request.magic = SERVER_MAGIC;
+  request.argc = (uint32_t)argc;
+  request.strings_length = (uint32_t)strings_length;
+  request.has_source = NULL != source;
+  request.source_length = NULL != source ? length : 0;
+
+  vector.iov_base = &request;
+  vector.iov_len = sizeof(request);
+  memset(&message, 0, sizeof(message));
+  memset(&control, 0, sizeof(control));
+  message.msg_iov = &vector;
+  message.msg_iovlen = 1;
+  message.msg_control = control.bytes;
+  message.msg_controllen = sizeof(control.bytes);
+  header = CMSG_FIRSTHDR(&message);
+  header->cmsg_level = SOL_SOCKET;
+  header->cmsg_type = SCM_RIGHTS;
+  header->cmsg_len = CMSG_LEN(2 * sizeof(int));
+  memcpy(CMSG_DATA(header), fds, 2 * sizeof(int));
+
+  /* The worker writes to the same stdout and stderr. */
+  fflush(stdout);
+  fflush(stderr);
+  ok = (ssize_t)sizeof(request) == sendmsg(connection, &message, MSG_NOSIGNAL)
+    && server_write_all(connection, strings, strings_length)
+    && (NULL == source || server_write_all(connection, source, length))
+    && server_read_all(connection, &status, sizeof(status));
+  close(connection);
+  free(strings);
+
+  if (!ok) {
+    fprintf(stdout, "The compile server on %s stopped before the compile finished.\n", path);
+    return 1;
+  }
+  if (print_statistics) {
+    fprintf(stderr, "server: compile took %.3f ms, round trip\n", (double)(server_now_ns() - start) / 1e6);
+  }
+  return status;
+}
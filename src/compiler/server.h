@@ -0,0 +1,20 @@
+#ifndef _SERVER_H
+#define _SERVER_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#define SERVER_MAX_ARGUMENTS 256
+#define SERVER_MAX_STRINGS   (64 * 1024)
+#define SERVER_BACKLOG       128
+
+/*
+ * Compile one request: argv is the client's command line, and source the
+ * input it sent, or NULL when it sent none. Returns the exit status.
+ */
+typedef int server_compile_function(int argc, char **argv, char const *source, size_t length);
+
+int server_run(char const *path, int workers, server_compile_function *compile);
+int server_send(char const *path, int argc, char **argv, char const *source, size_t length, bool print_statistics);
+
+#endif /* _SERVER_H */
@@ -0,0 +1,858 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+
+#include "node.h"
+#include "simplify.h"
+#include "profile.h"
+#include "arena.h"
+
+/*
+ * Algebraic simplification of typed parse trees, run before IR generation at
+ * -O1 and above.
+ *
+ * Arithmetic is on 32-bit unsigned values, as the MIPS code computes it, so
+ * constants are combined modulo 2^32. The pass works from the operands up,
+ * and keeps every simplified sum in the form "rest + constant" (and every
+ * product in the form "rest * constant"), so that each operation only has to
+ * look at the roots of its operands to gather the constants of a whole chain:
+ *
+ *   a + 1 + 2 + b + 3   =>   a + b + 6
+ *   2 * a * 3 * b       =>   a * b * 6
+ *
+ * Identities (x + 0, x - 0, x * 1, x / 1) disappear, x - x becomes 0, and so
+ * does 0 * x unless x might divide by zero. The terms that are not constant
+ * keep their order. Shifts and bitwise operations of constants are folded,
+ * and so are the identities x << 0, x >> 0, x | 0 and x ^ 0.
+ *
+ * An operand reads a variable when its operation executes, so moving a term
+ * to another operation could move the read to the other side of an
+ * assignment. Sums and products are only rewritten when neither operand
+ * assigns. An identity is kept when its left operand is a variable and an
+ * assignment runs before its value is used, as in (c * 1) + (c = 5), since
+ * the variable would then be read after the assignment instead of before.
+ *
+ * At -O2, chains of + and of * are then rebalanced, so that a left-deep
+ * a + b + c + d, which must be added one term after another, becomes
+ * (a + b) + (c + d), whose halves can be computed at the same time.
+ */
+
+#define SIMPLIFY_MASK 0xFFFFFFFFul
+
+struct simplify_value {
+  struct node *node;
+  bool pure;
+  bool may_trap;
+};
+
+struct simplify_walk {
+  struct simplify_value *values;
+  size_t count;
+  size_t capacity;
+
+  /*
+   * For each operation being walked, whether an assignment may run after it
+   * and before its value is used. Right operands are walked first, so that
+   * this is known when the left one is reached.
+   */
+  bool *writes_follow;
+  size_t depth;
+  size_t depth_capacity;
+
+  /* Trees loaded from an image live in its mapping and are not freed. */
+  bool free_nodes;
+};
+
+/*
+ * The cap is on how many values a balanced chain keeps live at once, as ir.c
+ * labels them, which grows with the height it is balanced to. It does not
+ * spare MIPS registers, since the IR numbers its temporaries without reusing
+ * them. It does bound what the x86-64 backend must find registers for, which
+ * allocates twelve of them by liveness: a balanced chain leaves at least four
+ * for the values held around it. With a profile, the hot statements may use
+ * sixteen, at the cost of keeping some values in memory there, and the cold
+ * ones are not balanced.
+ */
+#define SIMPLIFY_BALANCE_TEMPORARIES 8
+#define SIMPLIFY_BALANCE_HOT_TEMPORARIES 16
+
+struct simplify_chain {
+  struct node *node;
+  bool pure;
+
+  /* The temporaries needed to evaluate the node and to hold its value, as labelled by ir.c. */
+  int temporaries;
+  int held;
+
+  /* For a chain, the most that any of its terms needs. */
+  int term_temporaries;
+  int term_held;
+};
+
+struct simplify_balance {
+  struct simplify_chain *chains;
+  size_t count;
+  size_t capacity;
+
+  /* The terms and the operations of the chain being balanced, and a stack to find them. */
+  struct node **terms;
+  struct node **operations;
+  struct node **stack;
+  size_t scratch_capacity;
+
+  /* The most temporaries a balanced chain of the statement may need. */
+  int temporaries;
+};
+
+static struct {
+  unsigned long operations;
+  unsigned long removed;
+  unsigned long chains;
+  unsigned long terms;
+  unsigned long limited;
+  unsigned long cold;
+} simplify_statistics;
+
+/*********************
+ * REWRITE THE NODES *
+ *********************/
+
+/* Numbers too large for 32 bits are left alone. */
+static bool simplify_is_constant(struct node *node) {
+  return NODE_NUMBER == node->kind && !node->data.number.overflow;
+}
+
+static unsigned long simplify_constant_value(struct node *number) {
+  return number->data.number.value & SIMPLIFY_MASK;
+}
+
+static void simplify_free(struct simplify_walk *walk, struct node *node) {
+  if (NODE_BINARY_OPERATION == node->kind) {
+    simplify_statistics.removed++;
+  }
+  if (walk->free_nodes) {
+    arena_free(node->ir);
+    arena_free(node);
+  }
+}
+
+static enum node_walk simplify_discard(struct node *node, enum node_visit visit, void *context) {
+  if (NODE_VISIT_POST == visit) {
+    simplify_free(context, node);
+  }
+  return NODE_WALK_OPERANDS;
+}
+
+/*
+ * Constants gathered from operands are merged into one; the first number
+ * node found is kept as a spare to hold the result.
+ */
+static void simplify_keep_spare(struct simplify_walk *walk, struct node *number, struct node **spare) {
+  if (NULL == *spare) {
+    *spare = number;
+  } else {
+    simplify_free(walk, number);
+  }
+}
+
+static struct node *simplify_number(struct node **spare, struct node *model, unsigned long value) {
+  struct node *number;
+  char text[24];
+  int length;
+
+  if (NULL != *spare) {
+    number = *spare;
+    *spare = NULL;
+    number->data.number.value = value & SIMPLIFY_MASK;
+    return number;
+  }
+
+  length = snprintf(text, sizeof(text), "%lu", value & SIMPLIFY_MASK);
+  number = node_number(model->location, text, length);
+  number->data.number.result.type = model->data.binary_operation.result.type;
+  return number;
+}
+
+static struct node *simplify_binary(struct node *model, enum node_binary_operation operation,
+                                    struct node *left, struct node *right) {
+  struct node *binary = node_binary_operation(model->location, operation, left, right);
+  binary->data.binary_operation.result.type = model->data.binary_operation.result.type;
+  simplify_statistics.removed--;
+  return binary;
+}
+
+/* Whether a rewrite may leave the variable core in place of the operation being simplified. */
+static bool simplify_may_read_later(struct simplify_walk *walk, struct node *core) {
+  return NODE_IDENTIFIER != core->kind || 0 == walk->depth || !walk->writes_follow[walk->depth - 1];
+}
+
+static bool simplify_is_same_variable(struct node *left, struct node *right) {
+  return NODE_IDENTIFIER == left->kind && NODE_IDENTIFIER == right->kind
+      && left->data.identifier.symbol == right->data.identifier.symbol;
+}
+
+/*
+ * Separate a simplified sum into the terms that are not constant and its
+ * constant. Returns NULL when the sum is only a constant.
+ */
+static struct node *simplify_split_sum(struct simplify_walk *walk, struct node *sum, unsigned long *constant, struct node **spare) {
+  struct node *rest;
+  int operation;
+
+  *constant = 0;
+  if (simplify_is_constant(sum)) {
+    *constant = simplify_constant_value(sum);
+    simplify_keep_spare(walk, sum, spare);
+    return NULL;
+  }
+  if (NODE_BINARY_OPERATION != sum->kind) {
+    return sum;
+  }
+
+  operation = sum->data.binary_operation.operation;
+  if ((BINOP_ADDITION == operation || BINOP_SUBTRACTION == operation)
+      && simplify_is_constant(sum->data.binary_operation.right_operand)) {
+    *constant = simplify_constant_value(sum->data.binary_operation.right_operand);
+    if (BINOP_SUBTRACTION == operation) {
+      *constant = (0 - *constant) & SIMPLIFY_MASK;
+    }
+    simplify_keep_spare(walk, sum->data.binary_operation.right_operand, spare);
+    rest = sum->data.binary_operation.left_operand;
+    simplify_free(walk, sum);
+    return rest;
+  }
+  return sum;
+}
+
+static struct node *simplify_sum(struct simplify_walk *walk, struct node *sum) {
+  struct node *left, *right, *spare = NULL, *model = sum, *core, *result;
+  unsigned long left_constant, right_constant, constant;
+  bool subtract = BINOP_SUBTRACTION == sum->data.binary_operation.operation;
+
+  left = simplify_split_sum(walk, sum->data.binary_operation.left_operand, &left_constant, &spare);
+  right = simplify_split_sum(walk, sum->data.binary_operation.right_operand, &right_constant, &spare);
+  constant = (subtract ? left_constant - right_constant : left_constant + right_constant) & SIMPLIFY_MASK;
+
+  if (subtract && NULL != left && NULL != right && simplify_is_same_variable(left, right)) {
+    simplify_free(walk, left);
+    simplify_free(walk, right);
+    left = right = NULL;
+  }
+
+  if (NULL != left && NULL != right) {
+    sum->data.binary_operation.left_operand = left;
+    sum->data.binary_operation.right_operand = right;
+    core = sum;
+    sum = NULL;
+  } else if (NULL != left) {
+    core = left;
+  } else if (NULL != right && !subtract) {
+    core = right;
+  } else if (NULL != right) {
+    /* Nothing is left to subtract from but the constant. */
+    sum->data.binary_operation.left_operand = simplify_number(&spare, model, constant);
+    sum->data.binary_operation.right_operand = right;
+    if (NULL != spare) {
+      simplify_free(walk, spare);
+    }
+    return sum;
+  } else {
+    core = NULL;
+  }
+
+  if (NULL == core) {
+    result = simplify_number(&spare, model, constant);
+  } else if (0 == constant && simplify_may_read_later(walk, core)) {
+    result = core;
+  } else {
+    /* Constants above 2^31 read better, and fit immediates, as subtractions. */
+    enum node_binary_operation operation = constant > SIMPLIFY_MASK - constant + 1 ? BINOP_SUBTRACTION : BINOP_ADDITION;
+    if (BINOP_SUBTRACTION == operation) {
+      constant = (0 - constant) & SIMPLIFY_MASK;
+    }
+    if (NULL != sum) {
+      sum->data.binary_operation.operation = operation;
+      sum->data.binary_operation.left_operand = core;
+      sum->data.binary_operation.right_operand = simplify_number(&spare, model, constant);
+      result = sum;
+      sum = NULL;
+    } else {
+      result = simplify_binary(model, operation, core, simplify_number(&spare, model, constant));
+    }
+  }
+
+  if (NULL != sum) {
+    simplify_free(walk, sum);
+  }
+  if (NULL != spare) {
+    simplify_free(walk, spare);
+  }
+  return result;
+}
+
+/* Separate a simplified product into the factors that are not constant and its constant. */
+static struct node *simplify_split_product(struct simplify_walk *walk, struct node *product, unsigned long *constant, struct node **spare) {
+  struct node *rest;
+
+  *constant = 1;
+  if (simplify_is_constant(product)) {
+    *constant = simplify_constant_value(product);
+    simplify_keep_spare(walk, product, spare);
+    return NULL;
+  }
+  if (NODE_BINARY_OPERATION == product->kind
+      && BINOP_MULTIPLICATION == product->data.binary_operation.operation
+      && simplify_is_constant(product->data.binary_operation.right_operand)) {
+    *constant = simplify_constant_value(product->data.binary_operation.right_operand);
+    simplify_keep_spare(walk, product->data.binary_operation.right_operand, spare);
+    rest = product->data.binary_operation.left_operand;
+    simplify_free(walk, product);
+    return rest;
+  }
+  return product;
+}
+
+static struct node *simplify_product(struct simplify_walk *walk, struct node *product, bool may_trap) {
+  struct node *left, *right, *spare = NULL, *model = product, *core, *result;
+  unsigned long left_constant, right_constant, constant;
+
+  left = simplify_split_product(walk, product->data.binary_operation.left_operand, &left_constant, &spare);
+  right = simplify_split_product(walk, product->data.binary_operation.right_operand, &right_constant, &spare);
+  constant = (left_constant * right_constant) & SIMPLIFY_MASK;
+
+  if (0 == constant && !may_trap) {
+    if (NULL != left) {
+      node_walk_expression(left, simplify_discard, walk);
+    }
+    if (NULL != right) {
+      node_walk_expression(right, simplify_discard, walk);
+    }
+    left = right = NULL;
+  }
+
+  if (NULL != left && NULL != right) {
+    product->data.binary_operation.left_operand = left;
+    product->data.binary_operation.right_operand = right;
+    core = product;
+    product = NULL;
+  } else {
+    core = NULL != left ? left : right;
+  }
+
+  if (NULL == core) {
+    result = simplify_number(&spare, model, constant);
+  } else if (1 == constant && simplify_may_read_later(walk, core)) {
+    result = core;
+  } else if (NULL != product) {
+    product->data.binary_operation.left_operand = core;
+    product->data.binary_operation.right_operand = simplify_number(&spare, model, constant);
+    result = product;
+    product = NULL;
+  } else {
+    result = simplify_binary(model, BINOP_MULTIPLICATION, core, simplify_number(&spare, model, constant));
+  }
+
+  if (NULL != product) {
+    simplify_free(walk, product);
+  }
+  if (NULL != spare) {
+    simplify_free(walk, spare);
+  }
+  return result;
+}
+
+/* Division is neither associative nor safe to fold by zero, so only whole constants and x / 1 go. */
+static struct node *simplify_quotient(struct simplify_walk *walk, struct node *quotient) {
+  struct node *left = quotient->data.binary_operation.left_operand;
+  struct node *right = quotient->data.binary_operation.right_operand;
+
+  if (!simplify_is_constant(right) || 0 == simplify_constant_value(right)) {
+    return quotient;
+  }
+  if (simplify_is_constant(left)) {
+    left->data.number.value = simplify_constant_value(left) / simplify_constant_value(right);
+  } else if (1 != simplify_constant_value(right) || !simplify_may_read_later(walk, left)) {
+    return quotient;
+  }
+  simplify_free(walk, right);
+  simplify_free(walk, quotient);
+  return left;
+}
+
+/*
+ * Fold a shift or bitwise operation. As with sllv and srlv, only the low five
+ * bits of a shift amount count.
+ */
+static struct node *simplify_bitwise(struct simplify_walk *walk, struct node *operation) {
+  struct node *left = operation->data.binary_operation.left_operand;
+  struct node *right = operation->data.binary_operation.right_operand;
+  unsigned long value;
+
+  if (!simplify_is_constant(right)) {
+    return operation;
+  }
+  value = simplify_constant_value(right);
+  if (simplify_is_constant(left)) {
+    switch (operation->data.binary_operation.operation) {
+      case BINOP_LEFT_SHIFT:
+        value = simplify_constant_value(left) << (value & 31);
+        break;
+      case BINOP_RIGHT_SHIFT:
+        value = simplify_constant_value(left) >> (value & 31);
+        break;
+      case BINOP_BITWISE_AND:
+        value &= simplify_constant_value(left);
+        break;
+      case BINOP_BITWISE_XOR:
+        value ^= simplify_constant_value(left);
+        break;
+      case BINOP_BITWISE_OR:
+        value |= simplify_constant_value(left);
+        break;
+      default:
+        assert(0);
+        break;
+    }
+    left->data.number.value = value & SIMPLIFY_MASK;
+  } else {
+    if (BINOP_LEFT_SHIFT == operation->data.binary_operation.operation
+        || BINOP_RIGHT_SHIFT == operation->data.binary_operation.operation) {
+      value &= 31;
+    }
+    if (BINOP_BITWISE_AND == operation->data.binary_operation.operation || 0 != value
+        || !simplify_may_read_later(walk, left)) {
+      return operation;
+    }
+  }
+  simplify_free(walk, right);
+  simplify_free(walk, operation);
+  return left;
+}
+
+/*****************************
+ * SIMPLIFY PARSE TREE NODES *
+ *****************************/
+
+/*
+ * Operands are simplified first, right to left, and their results kept on a
+ * stack together with whether they assign or might divide by zero, until
+ * their operation is reached. An assignment may run between the left operand
+ * and its use when one may run after the operation, or the right operand
+ * assigns.
+ */
+static enum node_walk simplify_expression(struct node *expression, enum node_visit visit, void *context) {
+  struct simplify_walk *walk = context;
+  struct simplify_value value, left, right;
+  bool writes_follow;
+
+  if (NODE_VISIT_PRE == visit) {
+    if (walk->depth == walk->depth_capacity) {
+      walk->depth_capacity = walk->depth_capacity ? walk->depth_capacity * 2 : 64;
+      walk->writes_follow = realloc(walk->writes_follow, walk->depth_capacity * sizeof(bool));
+      assert(NULL != walk->writes_follow);
+    }
+    writes_follow = walk->depth > 0 && walk->writes_follow[walk->depth - 1];
+    walk->writes_follow[walk->depth++] = writes_follow;
+    return NODE_WALK_OPERANDS_REVERSED;
+  } else if (NODE_VISIT_IN == visit) {
+    walk->writes_follow[walk->depth - 1] = walk->writes_follow[walk->depth - 1] || !walk->values[walk->count - 1].pure;
+    return NODE_WALK_OPERANDS;
+  }
+
+  value.node = expression;
+  value.pure = true;
+  value.may_trap = false;
+  if (NODE_BINARY_OPERATION == expression->kind) {
+    assert(walk->count >= 2 && walk->depth > 0);
+    walk->depth--;
+    left = walk->values[--walk->count];
+    right = walk->values[--walk->count];
+    expression->data.binary_operation.left_operand = left.node;
+    expression->data.binary_operation.right_operand = right.node;
+    value.pure = left.pure && right.pure;
+    value.may_trap = left.may_trap || right.may_trap
+                  || ((BINOP_DIVISION == expression->data.binary_operation.operation
+                       || BINOP_ASSIGN_DIVISION == expression->data.binary_operation.operation)
+                      && !(simplify_is_constant(right.node) && 0 != simplify_constant_value(right.node)));
+    simplify_statistics.operations++;
+
+    switch (expression->data.binary_operation.operation) {
+      case BINOP_ADDITION:
+      case BINOP_SUBTRACTION:
+        if (value.pure) {
+          value.node = simplify_sum(walk, expression);
+        }
+        break;
+      case BINOP_MULTIPLICATION:
+        if (value.pure) {
+          value.node = simplify_product(walk, expression, value.may_trap);
+        }
+        break;
+      case BINOP_DIVISION:
+        value.node = simplify_quotient(walk, expression);
+        break;
+      case BINOP_LEFT_SHIFT:
+      case BINOP_RIGHT_SHIFT:
+      case BINOP_BITWISE_AND:
+      case BINOP_BITWISE_XOR:
+      case BINOP_BITWISE_OR:
+        value.node = simplify_bitwise(walk, expression);
+        break;
+      default:
+        assert(node_is_assignment(expression->data.binary_operation.operation));
+        value.pure = false;
+        break;
+    }
+  }
+
+  if (walk->count == walk->capacity) {
+    walk->capacity = walk->capacity ? walk->capacity * 2 : 64;
+    walk->values = realloc(walk->values, walk->capacity * sizeof(struct simplify_value));
+    assert(NULL != walk->values);
+  }
+  walk->values[walk->count++] = value;
+  return NODE_WALK_OPERANDS;
+}
+
+/*
+ * simplify_expression_statement - simplify the expression of a statement
+ *
+ * Nodes that are no longer needed are freed only when free_nodes is set.
+ */
+void simplify_expression_statement(struct node *expression_statement, bool free_nodes) {
+  struct simplify_walk walk;
+  assert(NODE_EXPRESSION_STATEMENT == expression_statement->kind);
+
+  walk.values = NULL;
+  walk.count = walk.capacity = 0;
+  walk.writes_follow = NULL;
+  walk.depth = walk.depth_capacity = 0;
+  walk.free_nodes = free_nodes;
+  node_walk_expression(expression_statement->data.expression_statement.expression, simplify_expression, &walk);
+  assert(1 == walk.count);
+  expression_statement->data.expression_statement.expression = walk.values[0].node;
+  free(walk.values);
+  free(walk.writes_follow);
+}
+
+static enum node_walk simplify_statement(struct node *statement_list, enum node_visit visit, void *context) {
+  bool *free_nodes = context;
+  (void)visit;
+  simplify_expression_statement(statement_list->data.statement_list.statement, *free_nodes);
+  return NODE_WALK_OPERANDS;
+}
+
+void simplify_statement_list(struct node *statement_list, bool free_nodes) {
+  assert(NODE_STATEMENT_LIST == statement_list->kind);
+  node_walk_statement_list(statement_list, simplify_statement, &free_nodes);
+}
+
+/******************************
+ * BALANCE ASSOCIATIVE CHAINS *
+ ******************************/
+
+static bool simplify_is_chain(struct simplify_chain *chain) {
+  return chain->pure && NODE_BINARY_OPERATION == chain->node->kind
+      && (BINOP_ADDITION == chain->node->data.binary_operation.operation
+          || BINOP_MULTIPLICATION == chain->node->data.binary_operation.operation);
+}
+
+/* The same count as ir_temporaries_for: evaluate first, then second, then the operation. */
+static int simplify_temporaries_for(int first, int first_held, int second) {
+  int temporaries = first_held + second;
+  if (first > temporaries) {
+    temporaries = first;
+  }
+  return temporaries > 1 ? temporaries : 1;
+}
+
+static void simplify_grow_scratch(struct simplify_balance *balance, size_t count) {
+  if (count <= balance->scratch_capacity) {
+    return;
+  }
+  while (balance->scratch_capacity < count) {
+    balance->scratch_capacity = balance->scratch_capacity ? balance->scratch_capacity * 2 : 64;
+  }
+  balance->terms = realloc(balance->terms, balance->scratch_capacity * sizeof(struct node *));
+  balance->operations = realloc(balance->operations, balance->scratch_capacity * sizeof(struct node *));
+  balance->stack = realloc(balance->stack, balance->scratch_capacity * sizeof(struct node *));
+  assert(NULL != balance->terms && NULL != balance->operations && NULL != balance->stack);
+}
+
+/* Gather the terms of a chain from left to right, and the operations that joined them. */
+static size_t simplify_gather_chain(struct simplify_balance *balance, struct node *root) {
+  int operation = root->data.binary_operation.operation;
+  size_t terms = 0, operations = 0, depth = 0;
+  struct node *node;
+
+  simplify_grow_scratch(balance, 1);
+  balance->stack[depth++] = root;
+  while (depth > 0) {
+    /* Each term is the root or an operand of an operation. */
+    simplify_grow_scratch(balance, operations + depth + 2);
+    node = balance->stack[--depth];
+    if (NODE_BINARY_OPERATION == node->kind && operation == node->data.binary_operation.operation) {
+      balance->operations[operations++] = node;
+      balance->stack[depth++] = node->data.binary_operation.right_operand;
+      balance->stack[depth++] = node->data.binary_operation.left_operand;
+    } else {
+      balance->terms[terms++] = node;
+    }
+  }
+  assert(operations + 1 == terms);
+  return terms;
+}
+
+static struct node *simplify_join(struct node **operation, struct node *left, struct node *right) {
+  struct node *joined = *operation;
+  joined->data.binary_operation.left_operand = left;
+  joined->data.binary_operation.right_operand = right;
+  joined->data.binary_operation.evaluate_right_first = false;
+  return joined;
+}
+
+/*
+ * Rebuild a chain as a balanced tree, reusing its operations. The terms keep
+ * their order, which only matters for the order of their side effects, and
+ * chains have none.
+ *
+ * A balanced tree of height h over terms that need t temporaries needs at
+ * most t + h: each level holds one more value. When the whole chain would
+ * need more than the temporaries allowed, it is split into blocks of
+ * balanced trees low enough that the chain of blocks, which holds one more
+ * value again, stays within the limit. Chains that could only be split into
+ * pairs are left as they are.
+ */
+static void simplify_balance_chain(struct simplify_balance *balance, struct simplify_chain *chain) {
+  size_t terms, levels, height, block, start, count, i, next = 0;
+  struct node *result = NULL;
+  int base;
+
+  terms = simplify_gather_chain(balance, chain->node);
+  if (terms < 3) {
+    return;
+  }
+  for (levels = 0; ((size_t)1 << levels) < terms; levels++) {
+    continue;
+  }
+  base = simplify_temporaries_for(chain->term_temporaries, chain->term_held, chain->term_temporaries);
+
+  if (base + (int)levels - 1 <= balance->temporaries) {
+    height = levels;
+  } else if (base + 1 < balance->temporaries) {
+    height = (size_t)(balance->temporaries - base);
+    simplify_statistics.limited++;
+  } else {
+    simplify_statistics.limited++;
+    return;
+  }
+
+  simplify_statistics.chains++;
+  simplify_statistics.terms += terms;
+  block = (size_t)1 << height;
+  for (start = 0; start < terms; start += block) {
+    count = terms - start < block ? terms - start : block;
+    while (count > 1) {
+      for (i = 0; i < count / 2; i++) {
+        balance->terms[start + i] = simplify_join(&balance->operations[next++], balance->terms[start + 2 * i],
+                                                  balance->terms[start + 2 * i + 1]);
+      }
+      if (count % 2) {
+        balance->terms[start + i] = balance->terms[start + count - 1];
+      }
+      count = (count + 1) / 2;
+    }
+    result = NULL == result ? balance->terms[start]
+                            : simplify_join(&balance->operations[next++], result, balance->terms[start]);
+  }
+  assert(next + 1 == terms);
+
+  chain->node = result;
+  chain->temporaries = base + (int)height - 1 + (terms > block ? 1 : 0);
+  chain->held = 1;
+}
+
+/*
+ * Chains are found from the terms up, and balanced once their root is known:
+ * when the operation above them is a different one, or at the top of the
+ * expression.
+ */
+static enum node_walk simplify_balance_expression(struct node *expression, enum node_visit visit, void *context) {
+  struct simplify_balance *balance = context;
+  struct simplify_chain chain, left, right, *operands[2];
+  int left_first, right_first, temporaries, held, i;
+
+  if (NODE_VISIT_POST != visit) {
+    return NODE_WALK_OPERANDS;
+  }
+
+  chain.node = expression;
+  chain.pure = true;
+  chain.term_temporaries = chain.term_held = 0;
+  switch (expression->kind) {
+    case NODE_NUMBER:
+      chain.temporaries = chain.held = 1;
+      break;
+
+    case NODE_IDENTIFIER:
+      chain.temporaries = chain.held = 0;
+      break;
+
+    case NODE_BINARY_OPERATION:
+      assert(balance->count >= 2);
+      right = balance->chains[--balance->count];
+      left = balance->chains[--balance->count];
+      chain.pure = left.pure && right.pure && !node_is_assignment(expression->data.binary_operation.operation);
+
+      operands[0] = &left;
+      operands[1] = &right;
+      for (i = 0; i < 2; i++) {
+        if (simplify_is_chain(operands[i]) && simplify_is_chain(&chain)
+            && expression->data.binary_operation.operation == operands[i]->node->data.binary_operation.operation) {
+          /* Part of this chain, whose terms are its terms. */
+          temporaries = operands[i]->term_temporaries;
+          held = operands[i]->term_held;
+        } else {
+          if (simplify_is_chain(operands[i])) {
+            simplify_balance_chain(balance, operands[i]);
+          }
+          temporaries = operands[i]->temporaries;
+          held = operands[i]->held;
+        }
+        if (temporaries > chain.term_temporaries) {
+          chain.term_temporaries = temporaries;
+        }
+        if (held > chain.term_held) {
+          chain.term_held = held;
+        }
+      }
+      expression->data.binary_operation.left_operand = left.node;
+      expression->data.binary_operation.right_operand = right.node;
+
+      if (BINOP_POST_INCREMENT == expression->data.binary_operation.operation
+          || BINOP_POST_DECREMENT == expression->data.binary_operation.operation) {
+        chain.temporaries = chain.held = 1;
+        break;
+      } else if (node_is_assignment(expression->data.binary_operation.operation)) {
+        chain.temporaries = right.temporaries;
+        chain.held = 0;
+        break;
+      }
+      left_first = simplify_temporaries_for(left.temporaries, left.held, right.temporaries);
+      right_first = simplify_temporaries_for(right.temporaries, right.held, left.temporaries);
+      chain.temporaries = chain.pure && right_first < left_first ? right_first : left_first;
+      chain.held = 1;
+      break;
+
+    default:
+      assert(0);
+      return NODE_WALK_OPERANDS;
+  }
+
+  if (balance->count == balance->capacity) {
+    balance->capacity = balance->capacity ? balance->capacity * 2 : 64;
+    balance->chains = realloc(balance->chains, balance->capacity * sizeof(struct simplify_chain));
+    assert(NULL != balance->chains);
+  }
+  balance->chains[balance->count++] = chain;
+  return NODE_WALK_OPERANDS;
+}
+
+/*
+ * simplify_balance_temporaries - the temporaries the balanced chains of the
+ * statement numbered statement may need
+ *
+ * Without a profile, or for statements it does not cover, this is the usual
+ * share of the registers. Statements that never ran get none, and are left
+ * as they are.
+ */
+int simplify_balance_temporaries(struct profile *profile, unsigned long statement) {
+  if (NULL == profile) {
+    return SIMPLIFY_BALANCE_TEMPORARIES;
+  }
+  switch (profile_heat(profile, statement)) {
+    case PROFILE_HOT:
+      return SIMPLIFY_BALANCE_HOT_TEMPORARIES;
+    case PROFILE_COLD:
+      return 0;
+    default:
+      return SIMPLIFY_BALANCE_TEMPORARIES;
+  }
+}
+
+/*
+ * simplify_balance_expression_statement - balance the chains of + and * in a statement
+ *
+ * No nodes are created or freed, so trees loaded from an image can be
+ * balanced too.
+ */
+void simplify_balance_expression_statement(struct node *expression_statement, int temporaries) {
+  struct simplify_balance balance;
+  assert(NODE_EXPRESSION_STATEMENT == expression_statement->kind);
+
+  if (0 == temporaries) {
+    simplify_statistics.cold++;
+    return;
+  }
+  balance.temporaries = temporaries;
+  balance.chains = NULL;
+  balance.count = balance.capacity = 0;
+  balance.terms = balance.operations = balance.stack = NULL;
+  balance.scratch_capacity = 0;
+  node_walk_expression(expression_statement->data.expression_statement.expression,
+                       simplify_balance_expression, &balance);
+  assert(1 == balance.count);
+  if (simplify_is_chain(&balance.chains[0])) {
+    simplify_balance_chain(&balance, &balance.chains[0]);
+  }
+  expression_statement->data.expression_statement.expression = balance.chains[0].node;
+
+  free(balance.chains);
+  free(balance.terms);
+  free(balance.operations);
+  free(balance.stack);
+}
+
+/* The statements are numbered in order, as ir.c numbers them for profiling. */
+struct simplify_balance_walk {
+  struct profile *profile;
+  unsigned long statement;
+};
+
+static enum node_walk simplify_balance_statement(struct node *statement_list, enum node_visit visit, void *context) {
+  struct simplify_balance_walk *walk = context;
+  (void)visit;
+  simplify_balance_expression_statement(statement_list->data.statement_list.statement,
+                                        simplify_balance_temporaries(walk->profile, walk->statement++));
+  return NODE_WALK_OPERANDS;
+}
+
+/*
+ * simplify_balance_statement_list - balance every statement of a program
+ *
+ * profile may be NULL.
+ */
+void simplify_balance_statement_list(struct node *statement_list, struct profile *profile) {
+  struct simplify_balance_walk walk;
+  assert(NODE_STATEMENT_LIST == statement_list->kind);
+
+  walk.profile = profile;
+  walk.statement = 0;
+  node_walk_statement_list(statement_list, simplify_balance_statement, &walk);
+}
+
+void simplify_reset_statistics(void) {
+  memset(&simplify_statistics, 0, sizeof(simplify_statistics));
+}
+
+void simplify_print_statistics(FILE *output) {
+  fprintf(output, "simplify: %lu operations, %lu after simplification\n",
+          simplify_statistics.operations, simplify_statistics.operations - simplify_statistics.removed);
+}
+
+void simplify_print_balance_statistics(FILE *output) {
+  fprintf(output, "simplify: %lu chains balanced, %lu terms, %lu held to the cap, %lu statements left cold\n",
+          simplify_statistics.chains, simplify_statistics.terms, simplify_statistics.limited, simplify_statistics.cold);
+}
@@ -0,0 +1,20 @@
+#ifndef _SIMPLIFY_H
+#define _SIMPLIFY_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+struct node;
+struct profile;
+
+void simplify_statement_list(struct node *statement_list, bool free_nodes);
+void simplify_expression_statement(struct node *expression_statement, bool free_nodes);
+void simplify_balance_statement_list(struct node *statement_list, struct profile *profile);
+void simplify_balance_expression_statement(struct node *expression_statement, int temporaries);
+int simplify_balance_temporaries(struct profile *profile, unsigned long statement);
+
+void simplify_reset_statistics(void);
+void simplify_print_statistics(FILE *output);
+void simplify_print_balance_statistics(FILE *output);
+
+#endif /* _SIMPLIFY_H */
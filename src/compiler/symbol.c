@@ -5,6 +5,7 @@
 
 #include "node.h"
 #include "symbol.h"
+#include "arena.h"
 
 unsigned int nextSymbolId;
 
@@ -12,8 +13,46 @@ unsigned int nextSymbolId;
  * CREATE SYMBOL TABLES *
  ************************/
 
+/* The symbols of each table are numbered from 0. */
 void symbol_initialize_table(struct symbol_table *table) {
   table->variables = NULL;
+  nextSymbolId = 0;
+}
+
+/*
+ * symbol_destroy_table - free the symbols of a table, and the operands that
+ * IR generation gave them
+ */
+void symbol_destroy_table(struct symbol_table *table) {
+  struct symbol_list *iter, *next;
+
+  for (iter = table->variables; NULL != iter; iter = next) {
+    next = iter->next;
+    arena_free(iter->symbol.result.ir_operand);
+    arena_free(iter);
+  }
+  table->variables = NULL;
+}
+
+/* The symbols of a table are numbered in the order they were added. */
+unsigned int symbol_count(struct symbol_table *table) {
+  return NULL == table->variables ? 0 : table->variables->symbol.id + 1;
+}
+
+/*
+ * symbol_rewind_table - free the symbols added after the first count, so
+ * that the table is as it was when it held count symbols
+ */
+void symbol_rewind_table(struct symbol_table *table, unsigned int count) {
+  struct symbol_list *next;
+
+  while (NULL != table->variables && table->variables->symbol.id >= count) {
+    next = table->variables->next;
+    arena_free(table->variables->symbol.result.ir_operand);
+    arena_free(table->variables);
+    table->variables = next;
+  }
+  nextSymbolId = count;
 }
 
 static struct symbol *symbol_get(struct symbol_table *table, char name[]) {
@@ -29,8 +68,7 @@ static struct symbol *symbol_get(struct symbol_table *table, char name[]) {
 static struct symbol *symbol_put(struct symbol_table *table, char name[]) {
   struct symbol_list *symbol_list;
 
-  symbol_list = malloc(sizeof(struct symbol_list));
-  assert(NULL != symbol_list);
+  symbol_list = arena_allocate(sizeof(struct symbol_list));
 
   strncpy(symbol_list->symbol.name, name, IDENTIFIER_MAX);
   symbol_list->symbol.result.type = NULL;
@@ -59,65 +97,85 @@ static int symbol_add_from_identifier(struct symbol_table *table, struct node *i
 
 }
 
-static int symbol_add_from_expression(struct symbol_table *table, struct node *expression);
-
-static int symbol_add_from_binary_operation(struct symbol_table *table, struct node *binary_operation) {
+struct symbol_walk {
+  struct symbol_table *table;
+  int error_count;
+};
+
+/*
+ * The left operand of an assignment defines its identifier, and is not
+ * walked as an expression. Compound assignments, increments and decrements
+ * read their identifier first, so it must already be defined.
+ */
+static enum node_walk symbol_add_from_binary_operation(struct symbol_walk *walk, struct node *binary_operation) {
+  int operation = binary_operation->data.binary_operation.operation;
   assert(NODE_BINARY_OPERATION == binary_operation->kind);
 
-  switch (binary_operation->data.binary_operation.operation) {
-    case BINOP_MULTIPLICATION:
-    case BINOP_DIVISION:
-    case BINOP_ADDITION:
-    case BINOP_SUBTRACTION:
-      return symbol_add_from_expression(table, binary_operation->data.binary_operation.left_operand)
-           + symbol_add_from_expression(table, binary_operation->data.binary_operation.right_operand);
-    case BINOP_ASSIGN:
-      if (NODE_IDENTIFIER == binary_operation->data.binary_operation.left_operand->kind) {
-        return symbol_add_from_identifier(table, binary_operation->data.binary_operation.left_operand, true)
-             + symbol_add_from_expression(table, binary_operation->data.binary_operation.right_operand);
-      } else {
-        compiler_print_error(binary_operation->data.binary_operation.left_operand->location,
-                             "left operand of assignment must be an identifier");
-        return 1
-             + symbol_add_from_expression(table, binary_operation->data.binary_operation.left_operand)
-             + symbol_add_from_expression(table, binary_operation->data.binary_operation.right_operand);
-      }
-    default:
-      assert(0);
-      return 1;
+  if (!node_is_assignment(operation)) {
+    return NODE_WALK_OPERANDS;
+  } else if (NODE_IDENTIFIER != binary_operation->data.binary_operation.left_operand->kind) {
+    compiler_print_error(binary_operation->data.binary_operation.left_operand->location,
+                         "left operand of assignment must be an identifier");
+    walk->error_count++;
+    return NODE_WALK_OPERANDS;
+  } else if (BINOP_ASSIGN == operation) {
+    walk->error_count +=
+      symbol_add_from_identifier(walk->table, binary_operation->data.binary_operation.left_operand, true);
+    return NODE_WALK_RIGHT_OPERAND;
+  } else {
+    return NODE_WALK_OPERANDS;
   }
 }
 
-static int symbol_add_from_expression(struct symbol_table *table, struct node *expression) {
+static enum node_walk symbol_add_from_expression(struct node *expression, enum node_visit visit, void *context) {
+  struct symbol_walk *walk = context;
+
   switch (expression->kind) {
     case NODE_BINARY_OPERATION:
-      return symbol_add_from_binary_operation(table, expression);
+      if (NODE_VISIT_PRE == visit) {
+        return symbol_add_from_binary_operation(walk, expression);
+      }
+      return NODE_WALK_OPERANDS;
     case NODE_IDENTIFIER:
-      return symbol_add_from_identifier(table, expression, false);
+      walk->error_count += symbol_add_from_identifier(walk->table, expression, false);
+      return NODE_WALK_OPERANDS;
     case NODE_NUMBER:
-      return 0;
+      return NODE_WALK_OPERANDS;
     default:
       assert(0);
-      return 1;
+      walk->error_count++;
+      return NODE_WALK_OPERANDS;
   }
 }
 
-static int symbol_add_from_expression_statement(struct symbol_table *table, struct node *expression_statement) {
+int symbol_add_from_expression_statement(struct symbol_table *table, struct node *expression_statement) {
+  struct symbol_walk walk;
   assert(NODE_EXPRESSION_STATEMENT == expression_statement->kind);
 
-  return symbol_add_from_expression(table, expression_statement->data.expression_statement.expression);
+  walk.table = table;
+  walk.error_count = 0;
+  node_walk_expression(expression_statement->data.expression_statement.expression,
+                       symbol_add_from_expression, &walk);
+  return walk.error_count;
+}
+
+static enum node_walk symbol_add_from_statement(struct node *statement_list, enum node_visit visit, void *context) {
+  struct symbol_walk *walk = context;
+  (void)visit;
+
+  walk->error_count += symbol_add_from_expression_statement(walk->table, statement_list->data.statement_list.statement);
+  return NODE_WALK_OPERANDS;
 }
 
 int symbol_add_from_statement_list(struct symbol_table *table, struct node *statement_list)
 {
-  int error_count = 0;
+  struct symbol_walk walk;
   assert(NODE_STATEMENT_LIST == statement_list->kind);
 
-  if (NULL != statement_list->data.statement_list.init) {
-    error_count += symbol_add_from_statement_list(table, statement_list->data.statement_list.init);
-  }
-  return error_count
-       + symbol_add_from_expression_statement(table, statement_list->data.statement_list.statement);
+  walk.table = table;
+  walk.error_count = 0;
+  node_walk_statement_list(statement_list, symbol_add_from_statement, &walk);
+  return walk.error_count;
 }
 
 /***********************
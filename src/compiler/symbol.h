@@ -23,7 +23,11 @@ struct symbol_table {
 };
 
 void symbol_initialize_table(struct symbol_table *table);
+void symbol_destroy_table(struct symbol_table *table);
+unsigned int symbol_count(struct symbol_table *table);
+void symbol_rewind_table(struct symbol_table *table, unsigned int count);
 int symbol_add_from_statement_list(struct symbol_table *table, struct node *statement_list);
+int symbol_add_from_expression_statement(struct symbol_table *table, struct node *expression_statement);
 void symbol_print_table(FILE *output, struct symbol_table *table);
 
 #endif /* _SYMBOL_H */
@@ -10,22 +10,38 @@
  * CREATE TYPE EXPRESSIONS *
  ***************************/
 
-struct type *type_basic(bool is_unsigned, enum type_basic_kind datatype) {
-  struct type *basic;
+#define TYPE_BASIC_INSTANCE(is_unsigned, datatype) { TYPE_BASIC, { { is_unsigned, datatype } } }
 
-  basic = malloc(sizeof(struct type));
-  assert(NULL != basic);
+/*
+ * Basic types carry no state beyond their kind, so there is one shared,
+ * immutable instance of each. They are filled in at compile time, so the
+ * threads of a pipelined compile can share them without writing to them.
+ */
+struct type *type_basic(bool is_unsigned, enum type_basic_kind datatype) {
+  static struct type basic_types[2][TYPE_BASIC_LONG + 1] = {
+    {
+      TYPE_BASIC_INSTANCE(false, TYPE_BASIC_CHAR),
+      TYPE_BASIC_INSTANCE(false, TYPE_BASIC_SHORT),
+      TYPE_BASIC_INSTANCE(false, TYPE_BASIC_INT),
+      TYPE_BASIC_INSTANCE(false, TYPE_BASIC_LONG)
+    },
+    {
+      TYPE_BASIC_INSTANCE(true, TYPE_BASIC_CHAR),
+      TYPE_BASIC_INSTANCE(true, TYPE_BASIC_SHORT),
+      TYPE_BASIC_INSTANCE(true, TYPE_BASIC_INT),
+      TYPE_BASIC_INSTANCE(true, TYPE_BASIC_LONG)
+    }
+  };
 
-  basic->kind = TYPE_BASIC;
-  basic->data.basic.is_unsigned = is_unsigned;
-  basic->data.basic.datatype = datatype;
-  return basic;
+  return &basic_types[is_unsigned][datatype];
 }
 
 /****************************************
  * TYPE EXPRESSION INFO AND COMPARISONS *
  ****************************************/
 
+/* Only the assertions compare types. */
+#ifndef NDEBUG
 static bool type_is_equal(struct type *left, struct type *right) {
   if (left->kind == right->kind) {
     switch (left->kind) {
@@ -36,10 +52,10 @@ static bool type_is_equal(struct type *left, struct type *right) {
         assert(0);
         break;
     }
-  } else {
-    return false;
   }
+  return false;
 }
+#endif
 
 bool type_is_arithmetic(struct type *t) {
   return TYPE_BASIC == t->kind;
@@ -69,16 +85,15 @@ int type_size(struct type *t) {
     case TYPE_POINTER:
       return 4;
     default:
-      return 0;
+      break;
   }
+  return 0;
 }
 
 /*****************
  * TYPE CHECKING *
  *****************/
 
-static void type_assign_in_expression(struct node *expression);
-
 static void type_convert_usual_binary(struct node *binary_operation) {
   assert(NODE_BINARY_OPERATION == binary_operation->kind);
   assert(type_is_equal(node_get_result(binary_operation->data.binary_operation.left_operand)->type,
@@ -97,29 +112,34 @@ static void type_convert_assignment(struct node *binary_operation) {
 
 static void type_assign_in_binary_operation(struct node *binary_operation) {
   assert(NODE_BINARY_OPERATION == binary_operation->kind);
-  type_assign_in_expression(binary_operation->data.binary_operation.left_operand);
-  type_assign_in_expression(binary_operation->data.binary_operation.right_operand);
 
   switch (binary_operation->data.binary_operation.operation) {
     case BINOP_MULTIPLICATION:
     case BINOP_DIVISION:
     case BINOP_ADDITION:
     case BINOP_SUBTRACTION:
+    case BINOP_LEFT_SHIFT:
+    case BINOP_RIGHT_SHIFT:
+    case BINOP_BITWISE_AND:
+    case BINOP_BITWISE_XOR:
+    case BINOP_BITWISE_OR:
       type_convert_usual_binary(binary_operation);
       break;
 
-    case BINOP_ASSIGN:
-      type_convert_assignment(binary_operation);
-      break;
-
     default:
-      assert(0);
+      assert(node_is_assignment(binary_operation->data.binary_operation.operation));
+      type_convert_assignment(binary_operation);
       break;
   }
 }
 
+/* Operands are typed before the operations that use them. */
+static enum node_walk type_assign_in_expression(struct node *expression, enum node_visit visit, void *context) {
+  (void)context;
+  if (NODE_VISIT_POST != visit) {
+    return NODE_WALK_OPERANDS;
+  }
 
-static void type_assign_in_expression(struct node *expression) {
   switch (expression->kind) {
     case NODE_IDENTIFIER:
       if (NULL == expression->data.identifier.symbol->result.type) {
@@ -138,19 +158,26 @@ static void type_assign_in_expression(struct node *expression) {
       assert(0);
       break;
   }
+  return NODE_WALK_OPERANDS;
 }
 
-static void type_assign_in_expression_statement(struct node *expression_statement) {
+int type_assign_in_expression_statement(struct node *expression_statement) {
   assert(NODE_EXPRESSION_STATEMENT == expression_statement->kind);
-  type_assign_in_expression(expression_statement->data.expression_statement.expression);
+  node_walk_expression(expression_statement->data.expression_statement.expression,
+                       type_assign_in_expression, NULL);
+  return 0;
+}
+
+static enum node_walk type_assign_in_statement(struct node *statement_list, enum node_visit visit, void *context) {
+  (void)visit;
+  (void)context;
+  type_assign_in_expression_statement(statement_list->data.statement_list.statement);
+  return NODE_WALK_OPERANDS;
 }
 
 int type_assign_in_statement_list(struct node *statement_list) {
   assert(NODE_STATEMENT_LIST == statement_list->kind);
-  if (NULL != statement_list->data.statement_list.init) {
-    type_assign_in_statement_list(statement_list->data.statement_list.init);
-  }
-  type_assign_in_expression_statement(statement_list->data.statement_list.statement);
+  node_walk_statement_list(statement_list, type_assign_in_statement, NULL);
   return 0;
 }
 
@@ -34,6 +34,7 @@ struct type {
 struct type *type_basic(bool is_unsigned, enum type_basic_kind datatype);
 
 int type_assign_in_statement_list(struct node *statement_list);
+int type_assign_in_expression_statement(struct node *expression_statement);
 
 void type_print(FILE *output, struct type *type);
 
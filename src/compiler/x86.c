@@ -0,0 +1,765 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <string.h>
+
+#include "ir.h"
+#include "emit.h"
+#include "x86.h"
+#include "profile.h"
+
+/*
+ * The x86-64 back end prints the IR as GNU assembler text for Linux, with
+ * main following the System V ABI, so that the output can be assembled and
+ * linked with gcc and run natively:
+ *   gcc -o program output.s
+ *
+ * The IR works on unsigned 32-bit values, so every temporary is held in the
+ * low half of one of the 64-bit general registers, which the 32-bit forms of
+ * the instructions keep zero-extended:
+ *   li d, n       movl $n, d
+ *   move d, s     movl s, d
+ *   op d, s, t    movl s, d; op t, d
+ *   divu d, s, t  cmpl $0, t; je divide_by_zero;
+ *                 movl s, %eax; xorl %edx, %edx; divl t; movl %eax, d
+ *   sllv d, s, t  movl t, %ecx; movl s, d; shll %cl, d
+ *   print s       movl s, %edi; call print_number
+ * A divide by zero raises SIGFPE, where the MIPS pseudo-op breaks. It jumps
+ * to divide_by_zero first, which writes out the print buffer before it
+ * divides by zero itself, so that every number printed before the fault
+ * comes out, as it does from the MIPS program. Divides the IR knows cannot
+ * be by zero skip the check.
+ *
+ * %eax, %ecx and %edx are kept for the instructions that need them, and
+ * %rsp for the stack, which leaves twelve registers for temporaries. main
+ * saves the six the ABI has it preserve on entry, so that any of them can
+ * be used, and keeps the stack aligned for the calls it makes.
+ *
+ * print_number is a routine at the end of every program that formats the
+ * number in %edi into the print buffer, as a signed number followed by a
+ * newline, as spim's print_int would. The buffer is written with the write
+ * system call when the next number might not fit and when main returns. The
+ * routine only uses registers the ABI lets a call change, so temporaries
+ * that live across a call are kept in the others.
+ */
+
+/* A program prints into a buffer of this many bytes. A number takes at most 12. */
+#define X86_PRINT_BUFFER_SIZE 4096
+#define X86_PRINT_MAX_LENGTH    12
+
+/* The most text any one instruction turns into. */
+#define X86_MAX_INSTRUCTION_LENGTH 512
+
+/* O_WRONLY | O_CREAT | O_TRUNC and 0644, for the profile. */
+#define X86_PROFILE_OPEN_FLAGS 0x241
+#define X86_PROFILE_OPEN_MODE  0644
+
+#define X86_REGISTERS           12
+#define X86_FIRST_CALLEE_SAVED   6
+#define X86_IN_MEMORY           -1
+
+/* The registers free for temporaries; the ones a call may change come first. */
+static char const *x86_register_names[X86_REGISTERS] = {
+  "%esi", "%edi", "%r8d", "%r9d", "%r10d", "%r11d",
+  "%ebx", "%ebp", "%r12d", "%r13d", "%r14d", "%r15d"
+};
+
+
+/***********************
+ * REGISTER ALLOCATION *
+ ***********************/
+
+/*
+ * The temporaries of each section are given registers by linear scan
+ * (Poletto and Sarkar) over their live intervals: the instructions from the
+ * first that names a temporary to the last. An interval that is live across
+ * a call only gets one of the registers a call preserves. When none is
+ * free, the interval that ends last is kept in memory for all of its
+ * length, and the instructions that use it read it from there.
+ *
+ * A program printed in one section is allocated as a whole. A program
+ * printed a section at a time keeps the temporaries of its variables in
+ * memory between sections: each has a home word in the temporaries area, at
+ * four times its number, which is stored to after every instruction that
+ * sets it, and loaded from before its first use in a section. A temporary is
+ * taken to be a variable's when an earlier section named it, or when a copy
+ * sets it, as every assignment to a new variable does.
+ */
+struct x86_interval {
+  int temporary;
+  size_t start;
+  size_t end;
+  bool variable;
+  bool loaded;
+  bool across_call;
+  int location;
+  unsigned long slot;
+};
+
+static struct {
+  bool whole_program;
+
+  /* The interval of each temporary, valid when its stamp is the section's. */
+  size_t *interval_of;
+  unsigned long *stamp_of;
+  bool *named;
+  size_t temporaries;
+  unsigned long stamp;
+
+  struct x86_interval *intervals;
+  size_t count;
+  size_t capacity;
+
+  /* The largest temporary with a home, and the spill slots in use. */
+  unsigned long homes;
+  unsigned long slots;
+  unsigned long max_slots;
+} x86_allocation;
+
+static struct {
+  unsigned long sections;
+  unsigned long intervals;
+  unsigned long in_memory;
+  unsigned long loads;
+  unsigned long stores;
+} x86_statistics;
+
+static void x86_reserve_temporary(int temporary) {
+  size_t size = x86_allocation.temporaries;
+
+  assert(temporary >= 0);
+  if ((size_t)temporary < size) {
+    return;
+  }
+  while (size <= (size_t)temporary) {
+    size = size ? size * 2 : 1024;
+  }
+  x86_allocation.interval_of = realloc(x86_allocation.interval_of, size * sizeof(size_t));
+  x86_allocation.stamp_of = realloc(x86_allocation.stamp_of, size * sizeof(unsigned long));
+  x86_allocation.named = realloc(x86_allocation.named, size * sizeof(bool));
+  assert(NULL != x86_allocation.interval_of && NULL != x86_allocation.stamp_of && NULL != x86_allocation.named);
+  memset(x86_allocation.stamp_of + x86_allocation.temporaries, 0,
+         (size - x86_allocation.temporaries) * sizeof(unsigned long));
+  memset(x86_allocation.named + x86_allocation.temporaries, 0, (size - x86_allocation.temporaries) * sizeof(bool));
+  x86_allocation.temporaries = size;
+}
+
+static struct x86_interval *x86_interval_of(struct ir_operand *operand) {
+  assert(OPERAND_TEMPORARY == operand->kind);
+  assert(x86_allocation.stamp_of[operand->data.temporary] == x86_allocation.stamp);
+  return &x86_allocation.intervals[x86_allocation.interval_of[operand->data.temporary]];
+}
+
+/*
+ * x86_name - extend the interval of the temporary of operand to instruction
+ * index, starting one if this is its first mention in the section
+ */
+static void x86_name(struct ir_operand *operand, size_t index, bool used, size_t last_call) {
+  struct x86_interval *interval;
+  int temporary = operand->data.temporary;
+
+  if (OPERAND_TEMPORARY != operand->kind) {
+    return;
+  }
+  x86_reserve_temporary(temporary);
+  if (x86_allocation.stamp_of[temporary] != x86_allocation.stamp) {
+    if (x86_allocation.count == x86_allocation.capacity) {
+      x86_allocation.capacity = x86_allocation.capacity ? x86_allocation.capacity * 2 : 256;
+      x86_allocation.intervals = realloc(x86_allocation.intervals,
+                                         x86_allocation.capacity * sizeof(struct x86_interval));
+      assert(NULL != x86_allocation.intervals);
+    }
+    x86_allocation.stamp_of[temporary] = x86_allocation.stamp;
+    x86_allocation.interval_of[temporary] = x86_allocation.count;
+    interval = &x86_allocation.intervals[x86_allocation.count++];
+    interval->temporary = temporary;
+    interval->start = index;
+    interval->variable = !x86_allocation.whole_program && x86_allocation.named[temporary];
+    interval->loaded = interval->variable && used;
+    interval->across_call = false;
+  } else {
+    interval = &x86_allocation.intervals[x86_allocation.interval_of[temporary]];
+  }
+  interval->end = index;
+  if ((size_t)-1 != last_call && last_call > interval->start) {
+    interval->across_call = true;
+  }
+}
+
+/* Find the live interval of every temporary the section names. */
+static void x86_find_intervals(struct ir_section *section) {
+  struct ir_instruction *instruction;
+  size_t index = 0, last_call = (size_t)-1, i;
+
+  x86_allocation.stamp++;
+  x86_allocation.count = 0;
+  for (instruction = section->first; instruction != section->last->next; instruction = instruction->next) {
+    switch (instruction->kind) {
+      case IR_NO_OPERATION:
+      case IR_PROFILE_COUNT:
+        break;
+
+      case IR_PRINT_NUMBER:
+        x86_name(&instruction->operands[0], index, true, last_call);
+        last_call = index;
+        break;
+
+      case IR_LOAD_IMMEDIATE:
+        x86_name(&instruction->operands[0], index, false, last_call);
+        break;
+
+      case IR_COPY:
+        x86_name(&instruction->operands[1], index, true, last_call);
+        if (OPERAND_TEMPORARY == instruction->operands[0].kind) {
+          x86_reserve_temporary(instruction->operands[0].data.temporary);
+          x86_allocation.named[instruction->operands[0].data.temporary] = true;
+        }
+        x86_name(&instruction->operands[0], index, false, last_call);
+        break;
+
+      default:
+        x86_name(&instruction->operands[1], index, true, last_call);
+        x86_name(&instruction->operands[2], index, true, last_call);
+        x86_name(&instruction->operands[0], index, false, last_call);
+        break;
+    }
+    index++;
+  }
+
+  /* Every temporary named here is a variable's to the sections after this one. */
+  for (i = 0; i < x86_allocation.count; i++) {
+    x86_allocation.named[x86_allocation.intervals[i].temporary] = true;
+  }
+}
+
+/* Keep interval in memory: its home if it is a variable's, a spill slot otherwise. */
+static void x86_keep_in_memory(struct x86_interval *interval) {
+  interval->location = X86_IN_MEMORY;
+  if (interval->variable) {
+    if ((unsigned long)interval->temporary >= x86_allocation.homes) {
+      x86_allocation.homes = (unsigned long)interval->temporary + 1;
+    }
+  } else {
+    interval->slot = x86_allocation.slots++;
+    if (x86_allocation.slots > x86_allocation.max_slots) {
+      x86_allocation.max_slots = x86_allocation.slots;
+    }
+  }
+  x86_statistics.in_memory++;
+}
+
+/*
+ * x86_allocate_registers - give each interval a register or keep it in
+ * memory
+ *
+ * The intervals are in order of their start. An interval that starts by
+ * setting its temporary can take the register of one that ends at the same
+ * instruction, since every instruction reads its operands before it sets
+ * its result. One that starts with a load cannot.
+ */
+static void x86_allocate_registers(void) {
+  struct x86_interval *active[X86_REGISTERS] = { NULL };
+  struct x86_interval *interval, *victim;
+  size_t i;
+  int reg, first;
+
+  x86_allocation.slots = 0;
+  for (i = 0; i < x86_allocation.count; i++) {
+    interval = &x86_allocation.intervals[i];
+    for (reg = 0; reg < X86_REGISTERS; reg++) {
+      if (NULL != active[reg]
+          && (active[reg]->end < interval->start || (active[reg]->end == interval->start && !interval->loaded))) {
+        active[reg] = NULL;
+      }
+    }
+
+    first = interval->across_call ? X86_FIRST_CALLEE_SAVED : 0;
+    for (reg = first; reg < X86_REGISTERS && NULL != active[reg]; reg++) {
+    }
+    if (reg == X86_REGISTERS) {
+      victim = NULL;
+      for (reg = first; reg < X86_REGISTERS; reg++) {
+        if (NULL == victim || active[reg]->end > victim->end) {
+          victim = active[reg];
+        }
+      }
+      if (victim->end <= interval->end) {
+        x86_keep_in_memory(interval);
+        continue;
+      }
+      reg = victim->location;
+      x86_keep_in_memory(victim);
+    }
+    interval->location = reg;
+    active[reg] = interval;
+  }
+  x86_statistics.intervals += x86_allocation.count;
+}
+
+
+/*****************
+ * X86-64 OUTPUT *
+ *****************/
+
+static char *x86_copy(char *cursor, char const *text) {
+  size_t length = strlen(text);
+
+  memcpy(cursor, text, length);
+  return cursor + length;
+}
+
+/* The home of a variable's temporary, or the spill slot of another, as an operand. */
+static char *x86_print_memory(char *cursor, struct x86_interval *interval) {
+  if (interval->variable) {
+    cursor = x86_copy(cursor, "temporaries+");
+    cursor = emit_format_unsigned(cursor, 4 * (unsigned long)interval->temporary, 0);
+  } else {
+    cursor = x86_copy(cursor, "spills+");
+    cursor = emit_format_unsigned(cursor, 4 * interval->slot, 0);
+  }
+  return x86_copy(cursor, "(%rip)");
+}
+
+static char *x86_print_operand(char *cursor, struct ir_operand *operand) {
+  struct x86_interval *interval = x86_interval_of(operand);
+
+  if (X86_IN_MEMORY == interval->location) {
+    return x86_print_memory(cursor, interval);
+  }
+  return x86_copy(cursor, x86_register_names[interval->location]);
+}
+
+/* Immediates are 32-bit values, printed signed when their top bit is set. */
+static char *x86_print_immediate(char *cursor, unsigned long value) {
+  value &= 0xFFFFFFFFul;
+  *cursor++ = '$';
+  if (value >= 0x80000000ul) {
+    *cursor++ = '-';
+    value = 0x100000000ul - value;
+  }
+  return emit_format_unsigned(cursor, value, 0);
+}
+
+static bool x86_in_memory(struct ir_operand *operand) {
+  return X86_IN_MEMORY == x86_interval_of(operand)->location;
+}
+
+static bool x86_same_place(struct ir_operand *first, struct ir_operand *second) {
+  struct x86_interval *a = x86_interval_of(first), *b = x86_interval_of(second);
+
+  if (X86_IN_MEMORY != a->location || X86_IN_MEMORY != b->location) {
+    return a->location == b->location;
+  }
+  return a == b;
+}
+
+/* Print "\topcode\tsource, target\n"; either may be NULL to print an operand or register name in its place. */
+static char *x86_print_two(char *cursor, char const *opcode, struct ir_operand *source, char const *source_text,
+                           struct ir_operand *target, char const *target_text) {
+  cursor = x86_copy(cursor, "\t");
+  cursor = x86_copy(cursor, opcode);
+  cursor = x86_copy(cursor, "\t");
+  if (NULL != source) {
+    cursor = OPERAND_NUMBER == source->kind ? x86_print_immediate(cursor, source->data.number)
+                                            : x86_print_operand(cursor, source);
+  } else {
+    cursor = x86_copy(cursor, source_text);
+  }
+  cursor = x86_copy(cursor, ", ");
+  if (NULL != target) {
+    cursor = x86_print_operand(cursor, target);
+  } else {
+    cursor = x86_copy(cursor, target_text);
+  }
+  return x86_copy(cursor, "\n");
+}
+
+static char const *x86_opcode_for(enum ir_instruction_kind kind) {
+  switch (kind) {
+    case IR_MULTIPLY:
+      return "imull";
+    case IR_ADD:
+    case IR_ADD_IMMEDIATE:
+      return "addl";
+    case IR_SUBTRACT:
+      return "subl";
+    case IR_SHIFT_LEFT:
+    case IR_SHIFT_LEFT_IMMEDIATE:
+      return "shll";
+    case IR_SHIFT_RIGHT:
+    case IR_SHIFT_RIGHT_IMMEDIATE:
+      return "shrl";
+    case IR_AND:
+      return "andl";
+    case IR_XOR:
+      return "xorl";
+    case IR_OR:
+      return "orl";
+    default:
+      assert(0);
+      return NULL;
+  }
+}
+
+static bool x86_is_commutative(enum ir_instruction_kind kind) {
+  return IR_MULTIPLY == kind || IR_ADD == kind || IR_AND == kind || IR_XOR == kind || IR_OR == kind;
+}
+
+/*
+ * x86_print_arithmetic - print d = s op t in the two-operand form
+ *
+ * The result is computed in %eax when it is kept in memory, since imull
+ * cannot set memory and the other operand may be there too, and when d is
+ * the register of t and the operation does not commute.
+ */
+static char *x86_print_arithmetic(char *cursor, struct ir_instruction *instruction) {
+  struct ir_operand *target = &instruction->operands[0];
+  struct ir_operand *left = &instruction->operands[1];
+  struct ir_operand *right = &instruction->operands[2];
+  char const *opcode = x86_opcode_for(instruction->kind);
+  bool variable_shift = IR_SHIFT_LEFT == instruction->kind || IR_SHIFT_RIGHT == instruction->kind;
+
+  if (variable_shift) {
+    cursor = x86_print_two(cursor, "movl", right, NULL, NULL, "%ecx");
+  }
+  if (!x86_in_memory(target) && x86_same_place(target, left)) {
+    return variable_shift ? x86_print_two(cursor, opcode, NULL, "%cl", target, NULL)
+                          : x86_print_two(cursor, opcode, right, NULL, target, NULL);
+  }
+  if (!x86_in_memory(target) && (variable_shift || OPERAND_NUMBER == right->kind || !x86_same_place(target, right))) {
+    cursor = x86_print_two(cursor, "movl", left, NULL, target, NULL);
+    return variable_shift ? x86_print_two(cursor, opcode, NULL, "%cl", target, NULL)
+                          : x86_print_two(cursor, opcode, right, NULL, target, NULL);
+  }
+  if (!x86_in_memory(target) && x86_is_commutative(instruction->kind)) {
+    return x86_print_two(cursor, opcode, left, NULL, target, NULL);
+  }
+  cursor = x86_print_two(cursor, "movl", left, NULL, NULL, "%eax");
+  cursor = variable_shift ? x86_print_two(cursor, opcode, NULL, "%cl", NULL, "%eax")
+                          : x86_print_two(cursor, opcode, right, NULL, NULL, "%eax");
+  return x86_print_two(cursor, "movl", NULL, "%eax", target, NULL);
+}
+
+static char *x86_print_divide(char *cursor, struct ir_instruction *instruction) {
+  if (IR_DIVIDE == instruction->kind) {
+    cursor = x86_copy(cursor, "\tcmpl\t$0, ");
+    cursor = x86_print_operand(cursor, &instruction->operands[2]);
+    cursor = x86_copy(cursor, "\n\tje\tdivide_by_zero\n");
+  }
+  cursor = x86_print_two(cursor, "movl", &instruction->operands[1], NULL, NULL, "%eax");
+  cursor = x86_copy(cursor, "\txorl\t%edx, %edx\n\tdivl\t");
+  cursor = x86_print_operand(cursor, &instruction->operands[2]);
+  cursor = x86_copy(cursor, "\n");
+  return x86_print_two(cursor, "movl", NULL, "%eax", &instruction->operands[0], NULL);
+}
+
+static char *x86_print_copy(char *cursor, struct ir_instruction *instruction) {
+  struct ir_operand *target = &instruction->operands[0], *source = &instruction->operands[1];
+
+  if (x86_same_place(target, source)) {
+    return cursor;
+  }
+  if (x86_in_memory(target) && x86_in_memory(source)) {
+    cursor = x86_print_two(cursor, "movl", source, NULL, NULL, "%eax");
+    return x86_print_two(cursor, "movl", NULL, "%eax", target, NULL);
+  }
+  return x86_print_two(cursor, "movl", source, NULL, target, NULL);
+}
+
+static char *x86_print_load_immediate(char *cursor, struct ir_instruction *instruction) {
+  return x86_print_two(cursor, "movl", &instruction->operands[1], NULL, &instruction->operands[0], NULL);
+}
+
+static char *x86_print_print_number(char *cursor, struct ir_instruction *instruction) {
+  cursor = x86_print_two(cursor, "movl", &instruction->operands[0], NULL, NULL, "%edi");
+  return x86_copy(cursor, "\tcall\tprint_number\n");
+}
+
+/*
+ * Each counter is a word of profile_counts, at four times the number of its
+ * statement, as in the MIPS output.
+ */
+static struct {
+  char const *name;
+  unsigned long counters;
+} x86_profile = { X86_PROFILE_DEFAULT_NAME, 0 };
+
+static char *x86_print_profile_count(char *cursor, struct ir_instruction *instruction) {
+  unsigned long statement = instruction->operands[0].data.number;
+
+  assert(OPERAND_NUMBER == instruction->operands[0].kind);
+  if (statement >= x86_profile.counters) {
+    x86_profile.counters = statement + 1;
+  }
+  cursor = x86_copy(cursor, "\tincl\tprofile_counts+");
+  cursor = emit_format_unsigned(cursor, 4 * statement, 0);
+  return x86_copy(cursor, "(%rip)\n");
+}
+
+/* Load or store the register of a variable's temporary from or to its home. */
+static char *x86_print_home(char *cursor, struct x86_interval *interval, bool load) {
+  cursor = x86_copy(cursor, "\tmovl\t");
+  if (load) {
+    cursor = x86_print_memory(cursor, interval);
+    cursor = x86_copy(cursor, ", ");
+    cursor = x86_copy(cursor, x86_register_names[interval->location]);
+    x86_statistics.loads++;
+  } else {
+    cursor = x86_copy(cursor, x86_register_names[interval->location]);
+    cursor = x86_copy(cursor, ", ");
+    cursor = x86_print_memory(cursor, interval);
+    x86_statistics.stores++;
+  }
+  if ((unsigned long)interval->temporary >= x86_allocation.homes) {
+    x86_allocation.homes = (unsigned long)interval->temporary + 1;
+  }
+  return x86_copy(cursor, "\n");
+}
+
+static bool x86_sets_temporary(struct ir_instruction *instruction) {
+  return IR_NO_OPERATION != instruction->kind && IR_PRINT_NUMBER != instruction->kind
+         && IR_PROFILE_COUNT != instruction->kind;
+}
+
+static void x86_print_instruction(struct emit_buffer *output, struct ir_instruction *instruction,
+                                  size_t *next_interval, size_t index) {
+  struct x86_interval *interval;
+  char *cursor = emit_reserve(output, X86_MAX_INSTRUCTION_LENGTH);
+
+  /* The variables this instruction is the first to use are loaded first. */
+  while (*next_interval < x86_allocation.count && x86_allocation.intervals[*next_interval].start == index) {
+    interval = &x86_allocation.intervals[(*next_interval)++];
+    if (interval->loaded && X86_IN_MEMORY != interval->location) {
+      cursor = x86_print_home(cursor, interval, true);
+    }
+  }
+
+  switch (instruction->kind) {
+    case IR_MULTIPLY:
+    case IR_ADD:
+    case IR_SUBTRACT:
+    case IR_ADD_IMMEDIATE:
+    case IR_SHIFT_LEFT:
+    case IR_SHIFT_RIGHT:
+    case IR_SHIFT_LEFT_IMMEDIATE:
+    case IR_SHIFT_RIGHT_IMMEDIATE:
+    case IR_AND:
+    case IR_XOR:
+    case IR_OR:
+      cursor = x86_print_arithmetic(cursor, instruction);
+      break;
+
+    case IR_DIVIDE:
+    case IR_DIVIDE_NONZERO:
+      cursor = x86_print_divide(cursor, instruction);
+      break;
+
+    case IR_COPY:
+      cursor = x86_print_copy(cursor, instruction);
+      break;
+
+    case IR_LOAD_IMMEDIATE:
+      cursor = x86_print_load_immediate(cursor, instruction);
+      break;
+
+    case IR_PRINT_NUMBER:
+      cursor = x86_print_print_number(cursor, instruction);
+      break;
+
+    case IR_PROFILE_COUNT:
+      cursor = x86_print_profile_count(cursor, instruction);
+      break;
+
+    case IR_NO_OPERATION:
+      break;
+
+    default:
+      assert(0);
+      break;
+  }
+
+  if (x86_sets_temporary(instruction)) {
+    interval = x86_interval_of(&instruction->operands[0]);
+    if (interval->variable && X86_IN_MEMORY != interval->location) {
+      cursor = x86_print_home(cursor, interval, false);
+    }
+  }
+  emit_commit(output, cursor);
+}
+
+void x86_set_profile_name(char const *name) {
+  x86_profile.name = name;
+}
+
+void x86_print_prologue(struct emit_buffer *output) {
+  x86_allocation.stamp++;
+  x86_allocation.homes = 0;
+  x86_allocation.max_slots = 0;
+  x86_allocation.whole_program = false;
+  if (NULL != x86_allocation.named) {
+    memset(x86_allocation.named, 0, x86_allocation.temporaries * sizeof(bool));
+  }
+  x86_profile.counters = 0;
+  memset(&x86_statistics, 0, sizeof(x86_statistics));
+
+  emit_string(output, "\t.text\n\t.globl\tmain\n\t.type\tmain, @function\nmain:\n"
+                      "\tpushq\t%rbx\n\tpushq\t%rbp\n\tpushq\t%r12\n\tpushq\t%r13\n\tpushq\t%r14\n\tpushq\t%r15\n"
+                      "\tsubq\t$8, %rsp\n");
+}
+
+void x86_print_section(struct emit_buffer *output, struct ir_section *section) {
+  struct ir_instruction *instruction;
+  size_t next_interval = 0, index = 0;
+
+  x86_find_intervals(section);
+  x86_allocate_registers();
+  for (instruction = section->first; instruction != section->last->next; instruction = instruction->next) {
+    x86_print_instruction(output, instruction, &next_interval, index++);
+  }
+  x86_statistics.sections++;
+}
+
+/*
+ * The counts are written as a header of the word PROFILE_MAGIC and the
+ * number of counters, then the counters, in the byte order of the machine:
+ * open, write and close the file with system calls.
+ */
+static void x86_print_profile_write(struct emit_buffer *output) {
+  char const *name;
+  char *cursor;
+
+  emit_string(output, "\tmovl\t$2, %eax\n\tleaq\tprofile_name(%rip), %rdi\n\tmovl\t$");
+  cursor = emit_reserve(output, X86_MAX_INSTRUCTION_LENGTH);
+  cursor = emit_format_unsigned(cursor, X86_PROFILE_OPEN_FLAGS, 0);
+  cursor = x86_copy(cursor, ", %esi\n\tmovl\t$");
+  cursor = emit_format_unsigned(cursor, X86_PROFILE_OPEN_MODE, 0);
+  cursor = x86_copy(cursor, ", %edx\n\tsyscall\n\tmovl\t%eax, %edi\n\tmovl\t$1, %eax\n"
+                            "\tleaq\tprofile_header(%rip), %rsi\n\tmovl\t$");
+  cursor = emit_format_unsigned(cursor, 8 + 4 * x86_profile.counters, 0);
+  cursor = x86_copy(cursor, ", %edx\n\tsyscall\n\tmovl\t$3, %eax\n\tsyscall\n");
+  emit_commit(output, cursor);
+
+  emit_string(output, "\t.section\t.rodata\nprofile_name:\n\t.string\t\"");
+  for (name = x86_profile.name; '\0' != *name; name++) {
+    if ('"' == *name || '\\' == *name) {
+      emit_bytes(output, "\\", 1);
+    }
+    emit_bytes(output, name, 1);
+  }
+  emit_string(output, "\"\n\t.data\n\t.align\t4\nprofile_header:\n\t.long\t");
+  cursor = emit_reserve(output, X86_MAX_INSTRUCTION_LENGTH);
+  cursor = emit_format_unsigned(cursor, PROFILE_MAGIC, 0);
+  cursor = x86_copy(cursor, ", ");
+  cursor = emit_format_unsigned(cursor, x86_profile.counters, 0);
+  cursor = x86_copy(cursor, "\nprofile_counts:\n\t.zero\t");
+  cursor = emit_format_unsigned(cursor, 4 * x86_profile.counters, 0);
+  cursor = x86_copy(cursor, "\n\t.text\n");
+  emit_commit(output, cursor);
+}
+
+/* print_number writes out the buffer first when the number might not fit. */
+static char const x86_print_runtime[] =
+  "\n\t.type\tprint_number, @function\n"
+  "print_number:\n"
+  "\tmovl\tprint_length(%rip), %eax\n"
+  "\tcmpl\t$X86_PRINT_LIMIT, %eax\n"
+  "\tjb\tprint_sign\n"
+  "\tpushq\t%rdi\n"
+  "\tcall\tprint_flush\n"
+  "\tpopq\t%rdi\n"
+  "\txorl\t%eax, %eax\n"
+  "print_sign:\n"
+  "\tleaq\tprint_buffer(%rip), %rsi\n"
+  "\taddq\t%rax, %rsi\n"
+  "\tmovl\t%edi, %eax\n"
+  "\ttestl\t%eax, %eax\n"
+  "\tjns\tprint_digits\n"
+  "\tmovb\t$45, (%rsi)\n"
+  "\tincq\t%rsi\n"
+  "\tnegl\t%eax\n"
+  "print_digits:\n"
+  "\tmovl\t%eax, %r8d\n"
+  "\tmovl\t$10, %r9d\n"
+  "\tmovq\t%rsi, %rcx\n"
+  "print_count:\n"
+  "\tincq\t%rcx\n"
+  "\txorl\t%edx, %edx\n"
+  "\tdivl\t%r9d\n"
+  "\ttestl\t%eax, %eax\n"
+  "\tjnz\tprint_count\n"
+  "\tmovb\t$10, (%rcx)\n"
+  "\tleaq\t1(%rcx), %rdx\n"
+  "\tleaq\tprint_buffer(%rip), %rdi\n"
+  "\tsubq\t%rdi, %rdx\n"
+  "\tmovl\t%edx, print_length(%rip)\n"
+  "\tmovl\t%r8d, %eax\n"
+  "print_digit:\n"
+  "\txorl\t%edx, %edx\n"
+  "\tdivl\t%r9d\n"
+  "\taddl\t$48, %edx\n"
+  "\tdecq\t%rcx\n"
+  "\tmovb\t%dl, (%rcx)\n"
+  "\ttestl\t%eax, %eax\n"
+  "\tjnz\tprint_digit\n"
+  "\tret\n"
+  "\n\t.type\tprint_flush, @function\n"
+  "print_flush:\n"
+  "\tmovl\t$1, %eax\n"
+  "\tmovl\t$1, %edi\n"
+  "\tleaq\tprint_buffer(%rip), %rsi\n"
+  "\tmovl\tprint_length(%rip), %edx\n"
+  "\tsyscall\n"
+  "\tmovl\t$0, print_length(%rip)\n"
+  "\tret\n"
+  "\n\t.type\tdivide_by_zero, @function\n"
+  "divide_by_zero:\n"
+  "\tcall\tprint_flush\n"
+  "\txorl\t%ecx, %ecx\n"
+  "\tdivl\t%ecx\n";
+
+void x86_print_epilogue(struct emit_buffer *output) {
+  char const *limit = strstr(x86_print_runtime, "X86_PRINT_LIMIT");
+  char *cursor;
+
+  emit_string(output, "\tcall\tprint_flush\n");
+  if (x86_profile.counters > 0) {
+    x86_print_profile_write(output);
+  }
+  emit_string(output, "\taddq\t$8, %rsp\n\tpopq\t%r15\n\tpopq\t%r14\n\tpopq\t%r13\n\tpopq\t%r12\n"
+                      "\tpopq\t%rbp\n\tpopq\t%rbx\n\txorl\t%eax, %eax\n\tret\n");
+
+  emit_bytes(output, x86_print_runtime, (size_t)(limit - x86_print_runtime));
+  cursor = emit_reserve(output, X86_MAX_INSTRUCTION_LENGTH);
+  cursor = emit_format_unsigned(cursor, X86_PRINT_BUFFER_SIZE - X86_PRINT_MAX_LENGTH + 1, 0);
+  emit_commit(output, cursor);
+  emit_string(output, limit + strlen("X86_PRINT_LIMIT"));
+
+  emit_string(output, "\n\t.bss\n\t.align\t4\nprint_length:\n\t.zero\t4\nprint_buffer:\n\t.zero\t");
+  cursor = emit_reserve(output, X86_MAX_INSTRUCTION_LENGTH);
+  cursor = emit_format_unsigned(cursor, X86_PRINT_BUFFER_SIZE, 0);
+  if (x86_allocation.homes > 0) {
+    cursor = x86_copy(cursor, "\ntemporaries:\n\t.zero\t");
+    cursor = emit_format_unsigned(cursor, 4 * x86_allocation.homes, 0);
+  }
+  if (x86_allocation.max_slots > 0) {
+    cursor = x86_copy(cursor, "\nspills:\n\t.zero\t");
+    cursor = emit_format_unsigned(cursor, 4 * x86_allocation.max_slots, 0);
+  }
+  cursor = x86_copy(cursor, "\n\t.section\t.note.GNU-stack,\"\",@progbits\n");
+  emit_commit(output, cursor);
+}
+
+/* A whole program in one section keeps its variables in registers throughout. */
+void x86_print_program(struct emit_buffer *output, struct ir_section *section) {
+  x86_print_prologue(output);
+  x86_allocation.whole_program = true;
+  x86_print_section(output, section);
+  x86_print_epilogue(output);
+}
+
+void x86_print_statistics(FILE *output) {
+  fprintf(output, "x86-64: %lu sections, %lu live intervals, %lu kept in memory, %lu loads and %lu stores of variables\n",
+          x86_statistics.sections, x86_statistics.intervals, x86_statistics.in_memory, x86_statistics.loads,
+          x86_statistics.stores);
+}
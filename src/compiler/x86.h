@@ -0,0 +1,23 @@
+#ifndef _X86_H
+#define _X86_H
+
+#include <stdio.h>
+
+struct emit_buffer;
+struct ir_section;
+
+/* Where a profiling program writes its counts unless told otherwise. */
+#define X86_PROFILE_DEFAULT_NAME "x86.profile"
+
+void x86_set_profile_name(char const *name);
+
+void x86_print_program(struct emit_buffer *output, struct ir_section *section);
+
+/* Print a program a section at a time, as the sections are generated. */
+void x86_print_prologue(struct emit_buffer *output);
+void x86_print_section(struct emit_buffer *output, struct ir_section *section);
+void x86_print_epilogue(struct emit_buffer *output);
+
+void x86_print_statistics(FILE *output);
+
+#endif /* _X86_H */
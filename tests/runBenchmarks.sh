@@ -0,0 +1,109 @@
+#!/bin/bash
+
+# Generates a set of large source programs and times the compiler on each.
+# Any arguments are passed on to the compiler, for example:
+#
+#   ./runBenchmarks.sh -s flat -S
+#   ./runBenchmarks.sh -fstream
+#   ./runBenchmarks.sh -s parser
+#   ./runBenchmarks.sh -O2 -S
+#
+# At -O0 the code is printed straight from the tree. Running once with no
+# arguments and once with -fthrough-ir compares that with the IR path, and
+# -fstream leaves out the stage dumps on both sides.
+#
+# Throughput is given in tokens per second, counting the tokens of each input
+# with the scanner stage. Statistics printed by -S are shown after the timing
+# of each input.
+
+PROJECT_ROOT=".."
+COMPILER_EXEC="$PROJECT_ROOT/src/compiler/compiler"
+BENCH_DIR="bench"
+SIZE=${BENCH_SIZE:-100000}
+
+mkdir -p $BENCH_DIR
+
+# Many short statements over a small set of variables.
+awk -v n=$SIZE 'BEGIN {
+  for (i = 0; i < 50; i++) printf "v%d = %d;\n", i, i;
+  for (i = 50; i < n; i++) printf "v%d = %d + v%d * 3;\n", i % 50, i, (i - 1) % 50;
+}' > $BENCH_DIR/statements.txt
+
+# A few statements with long, left-deep expressions.
+awk -v n=$SIZE 'BEGIN {
+  for (s = 0; s < 10; s++) {
+    printf "d%d = 1", s;
+    for (i = 0; i < n / 10; i++) printf " + %d", i % 7;
+    printf ";\n";
+  }
+}' > $BENCH_DIR/deep.txt
+
+# Long expressions mixing every precedence level, with nested parentheses.
+awk -v n=$SIZE 'BEGIN {
+  for (s = 0; s < 10; s++) printf "m%d = %d;\n", s, s;
+  for (s = 0; s < 10; s++) {
+    printf "m%d = 1", s;
+    for (i = 0; i < n / 100; i++) {
+      printf " + (%d * (m%d - %d / (1 + %d * %d)) - %d)", i % 7, s, i % 5, i % 3, i % 11, i % 13;
+    }
+    printf ";\n";
+  }
+}' > $BENCH_DIR/nested.txt
+
+# Statements made mostly of identifiers.
+awk -v n=$SIZE 'BEGIN {
+  for (i = 0; i < 64; i++) printf "identifier%d = %d;\n", i, i;
+  for (i = 0; i < n / 4; i++)
+    printf "identifier%d = identifier%d + identifier%d * identifier%d - identifier%d;\n",
+           i % 64, (i + 1) % 64, (i + 7) % 64, (i + 13) % 64, (i + 29) % 64;
+}' > $BENCH_DIR/identifiers.txt
+
+# Sums and products of many variables, whose critical path -O2 shortens.
+awk -v n=$SIZE 'BEGIN {
+  for (i = 0; i < 16; i++) printf "c%d = %d;\n", i, i + 1;
+  for (s = 0; s < n / 64; s++) {
+    printf "c%d = c0", s % 16;
+    for (i = 1; i < 32; i++) printf " %s c%d", (s % 2 ? "*" : "+"), (s + i) % 16;
+    printf ";\n";
+  }
+}' > $BENCH_DIR/chains.txt
+
+# Statements of short names, many of them close to keywords.
+awk -v n=$SIZE 'BEGIN {
+  split("dot for0 fore goto1 iff ink into lone longs rerun shot sign unit voids whilst x y z", names, " ");
+  for (i = 1; i <= 18; i++) printf "%s = %d;\n", names[i], i;
+  for (i = 0; i < n / 4; i++)
+    printf "%s = %s + %s * %s - %s;\n", names[i % 18 + 1], names[(i + 1) % 18 + 1],
+           names[(i + 5) % 18 + 1], names[(i + 7) % 18 + 1], names[(i + 11) % 18 + 1];
+}' > $BENCH_DIR/names.txt
+
+# Statements laid out over indented lines, so that most of the input is blanks.
+awk -v n=$SIZE 'BEGIN {
+  for (i = 0; i < 8; i++) printf "w%d = %d;\n", i, i;
+  for (i = 0; i < n / 4; i++)
+    printf "\t\t\tw%d  =\n\t\t\t\t\tw%d\n\t\t\t\t\t+ w%d\n\t\t\t\t\t* %d        ;\n\n",
+           i % 8, (i + 3) % 8, (i + 5) % 8, i % 100;
+}' > $BENCH_DIR/indented.txt
+
+# Tables of large constants.
+awk -v n=$SIZE 'BEGIN {
+  for (i = 0; i < n / 4; i++)
+    printf "t = %d + %d + %d + %d;\n", (i * 7919) % 4000000000, (i * 104729) % 4000000000,
+           (i * 1299709) % 4000000000, (i * 15485863) % 4000000000;
+}' > $BENCH_DIR/literals.txt
+
+for f in $BENCH_DIR/*.txt
+do
+  name=${f##*/}
+  tokens=$($COMPILER_EXEC -s scanner $f | wc -l)
+  start=$(date +%s.%N)
+  $COMPILER_EXEC "$@" -o $BENCH_DIR/output.s $f > /dev/null 2> $BENCH_DIR/stats.log
+  status=$?
+  end=$(date +%s.%N)
+  awk -v n=$name -v s=$start -v e=$end -v x=$status -v t=$tokens 'BEGIN {
+    printf "%-20s %8.3fs  %12.0f tokens/s  (exit %d)\n", n, e - s, t / (e - s), x
+  }'
+  sed 's/^/    /' $BENCH_DIR/stats.log
+done
+
+rm -r $BENCH_DIR
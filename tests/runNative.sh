@@ -0,0 +1,107 @@
+#!/bin/bash
+
+# Generates a set of programs, compiles each for -T x86-64 at every
+# optimization level and, written as C, with gcc, then runs all of them
+# natively and times them. Each program must print the same numbers however
+# it was compiled. Needs gcc, which also assembles and links the compiler's
+# output.
+#
+#   ./runNative.sh
+#   BENCH_SIZE=5000 RUNS=50 ./runNative.sh
+#
+# Every binary is run RUNS times, and the time given is the total.
+
+PROJECT_ROOT=".."
+COMPILER_EXEC="$PROJECT_ROOT/src/compiler/compiler"
+BENCH_DIR="native"
+SIZE=${BENCH_SIZE:-20000}
+RUNS=${RUNS:-20}
+
+mkdir -p $BENCH_DIR
+
+# Many short statements over a small set of variables.
+awk -v n=$SIZE 'BEGIN {
+  for (i = 0; i < 50; i++) printf "v%d = %d;\n", i, i;
+  for (i = 50; i < n; i++) printf "v%d = %d + v%d * 3;\n", i % 50, i, (i - 1) % 50;
+}' > $BENCH_DIR/statements.txt
+
+# Long expressions mixing every precedence level, with nested parentheses.
+awk -v n=$SIZE 'BEGIN {
+  for (s = 0; s < 10; s++) printf "m%d = %d;\n", s, s;
+  for (s = 0; s < 10; s++) {
+    printf "m%d = 1", s;
+    for (i = 0; i < n / 100; i++) {
+      printf " + (%d * (m%d - %d / (1 + %d * %d)) - %d)", i % 7, s, i % 5, i % 3, i % 11, i % 13;
+    }
+    printf ";\n";
+  }
+}' > $BENCH_DIR/nested.txt
+
+# Sums and products of many variables.
+awk -v n=$SIZE 'BEGIN {
+  for (i = 0; i < 16; i++) printf "c%d = %d;\n", i, i + 1;
+  for (s = 0; s < n / 64; s++) {
+    printf "c%d = c0", s % 16;
+    for (i = 1; i < 32; i++) printf " %s c%d", (s % 2 ? "*" : "+"), (s + i) % 16;
+    printf ";\n";
+  }
+}' > $BENCH_DIR/chains.txt
+
+# Divides and shifts of variables by variables.
+awk -v n=$SIZE 'BEGIN {
+  for (i = 0; i < 8; i++) printf "d%d = %d;\n", i, 1000003 * (i + 1);
+  for (i = 0; i < n / 4; i++)
+    printf "d%d = d%d / ((d%d & 7) + 1) + (d%d << (d%d & 15)) - (d%d >> 3);\n",
+           i % 8, (i + 1) % 8, (i + 2) % 8, (i + 3) % 8, i % 5, (i + 5) % 8;
+}' > $BENCH_DIR/divides.txt
+
+# The same program in C: unsigned variables, and every statement printed as
+# the compiled programs print it.
+to_c() {
+  echo "#include <stdio.h>"
+  grep -o '[A-Za-z_][A-Za-z0-9_]*' $1 | sort -u | sed 's/.*/static unsigned &;/'
+  echo "int main(void) {"
+  sed 's/\b\([0-9][0-9]*\)\b/\1u/g' $1 | awk 'BEGIN { RS = ";" } /[^ \t\n]/ {
+    gsub(/^[ \t\n]+/, ""); printf "  printf(\"%%d\\n\", (int)(%s));\n", $0
+  }'
+  echo "  return 0;"
+  echo "}"
+}
+
+time_runs() {
+  local start end i
+  start=$(date +%s.%N)
+  for ((i = 0; i < RUNS; i++)); do
+    "$1" > /dev/null
+  done
+  end=$(date +%s.%N)
+  awk -v s=$start -v e=$end 'BEGIN { printf "%8.3fs", e - s }'
+}
+
+for f in $BENCH_DIR/*.txt
+do
+  name=${f##*/}
+  base=$BENCH_DIR/${name%.txt}
+  printf "%-16s" $name
+
+  to_c $f > $base.c
+  for level in 0 1 2
+  do
+    $COMPILER_EXEC -T x86-64 -O$level -fstream -o $base.O$level.s $f > /dev/null
+    gcc -o $base.O$level $base.O$level.s
+  done
+  gcc -O0 -w -o $base.gcc0 $base.c
+  gcc -O2 -w -o $base.gcc2 $base.c
+
+  $base.gcc0 > $base.expected
+  for binary in O0 O1 O2 gcc0 gcc2
+  do
+    printf "  %s %s" $binary "$(time_runs $base.$binary)"
+    if ! $base.$binary | cmp -s - $base.expected; then
+      printf " (differs)"
+    fi
+  done
+  printf "\n"
+done
+
+rm -r $BENCH_DIR
@@ -1,6 +1,6 @@
 #!/bin/bash
 
-TEST_DIRS="scanner parser symbol"
+TEST_DIRS="scanner parser flat symbol"
 
 rm -f error.log
 
@@ -68,3 +68,78 @@ for dir in $TEST_DIRS
     fi
 
 done
+
+# ---------------------------------------------------------
+# Programs that must print the same numbers at every optimization level.
+# They are compiled for -T x86-64, then assembled and run with gcc.
+# ---------------------------------------------------------
+dir=optimize
+errorcount=0
+filecount=0
+OUTPUT_FILES="$dir/$dir-output"
+mkdir -p $OUTPUT_FILES
+
+for f in ../tests/$dir/input/*.txt
+do
+  name=${f##*/}
+  expected="../tests/$dir/expected/$name"
+  ((filecount++))
+  for level in 0 1 2
+  do
+    output="$OUTPUT_FILES/${name%.txt}.O$level"
+    if ../src/compiler/compiler -T x86-64 -O$level -o $output.s $f >/dev/null \
+       && gcc -o $output $output.s && $output >$output.txt && diff $output.txt $expected >/dev/null; then
+      rm -f $output $output.s $output.txt
+    else
+      ((errorcount++))
+      echo "error with $f at -O$level"
+      echo "+++++++++++++++++++++++++++++++++++++++++++++++" >> error.log
+      echo "failed test case $name at -O$level" >> error.log
+      cat $f >> error.log
+    fi
+  done
+done
+echo "$dir has $errorcount errors out of $filecount"
+if test "$errorcount" -eq "0"
+then
+    rm -r $OUTPUT_FILES
+fi
+
+# ---------------------------------------------------------
+# Programs whose objects must disassemble with -d back into the text output
+# of the same compile, in both byte orders.
+# ---------------------------------------------------------
+dir=object
+errorcount=0
+filecount=0
+OUTPUT_FILES="$dir/$dir-output"
+mkdir -p $OUTPUT_FILES
+
+for f in ../tests/$dir/input/*.txt
+do
+  name=${f##*/}
+  ((filecount++))
+  for level in 0 1 2
+  do
+    for order in big little
+    do
+      output="$OUTPUT_FILES/${name%.txt}.O$level-$order"
+      if ../src/compiler/compiler -O$level -fthrough-ir -o $output.s $f >/dev/null \
+         && ../src/compiler/compiler -O$level -felf-$order -o $output.o $f >/dev/null \
+         && ../src/compiler/compiler -d $output.o >$output.d.s && diff $output.d.s $output.s >/dev/null; then
+        rm -f $output.s $output.o $output.d.s
+      else
+        ((errorcount++))
+        echo "error with $f at -O$level -felf-$order"
+        echo "+++++++++++++++++++++++++++++++++++++++++++++++" >> error.log
+        echo "failed test case $name at -O$level -felf-$order" >> error.log
+        cat $f >> error.log
+      fi
+    done
+  done
+done
+echo "$dir has $errorcount errors out of $filecount"
+if test "$errorcount" -eq "0"
+then
+    rm -r $OUTPUT_FILES
+fi